@@ -9,32 +9,79 @@
 
 #define BMM_BUCKETMEMORY_C
 #include <kernel.h>
-#include "BMM_BucketMemory.h"
 
 #include "TMR_Timer.h"
 #include "RTC_RealTimeClock.h"
+#include "BMM_BucketMemory.h"
 
 #define BMM_SIGNATURE         ('BMM')
+#define BMM_TIER_SIGNATURE    ('BMT')
 #define BMM_MAX_EVENTS        (5)
 #define BMM_PTR_INVALID(p)    (p->u24_signature != BMM_SIGNATURE)
+#define BMM_TIER_INVALID(p)   (p->u24_signature != BMM_TIER_SIGNATURE)
+
+#define BMM_BLOCK_SIZE        (64)                        // Bytes of encoded buckets per archive block
+#define BMM_MAX_RUN           (0xFFFF)                    // Longest run of equal buckets in one token
+#define BMM_TOKEN_RUN         (0x01)                      // Token bit 0: run of buckets equal to the previous one
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global Data                                                                //
 ////////////////////////////////////////////////////////////////////////////////
 
+// Archive block. A token is a varint (7 bits per byte, bit 7 set if more
+// follow). An even token holds the zig-zag coded difference with the previous
+// bucket, an odd token a run of buckets equal to the previous one. The first
+// bucket of a block differs from 0, so a block can be dropped whole; the
+// buckets are consecutive periods, so only the start time is stored
+typedef struct
+{
+  unsigned long       u32_serial ;                        // Number of the block since the archive was created
+  unsigned long       u32_startTime ;                     // Start of the block's first bucket
+  unsigned short      u16_nrOfBuckets ;                   // Buckets in the block, including a pending run
+  unsigned char       u8_nrOfBytes ;                      // Bytes of tokens in use
+  unsigned char       au8_token[BMM_BLOCK_SIZE] ;         // Encoded buckets
+} BMM_block_struct ;
+
+typedef struct
+{
+  BMM_block_struct*   at_block ;                          // Ring of blocks
+  unsigned short      u16_nrOfBlocks ;                    // Number of blocks allocated
+  unsigned short      u16_firstBlock ;                    // Oldest block
+  unsigned short      u16_usedBlocks ;                    // Blocks in use, the last one is being filled
+  unsigned long       u32_nextSerial ;                    // Serial for the next new block
+  unsigned long       u32_nextTime ;                      // Start of the bucket that continues the newest block
+  unsigned int        u24_lastValue ;                     // Last bucket in the newest block
+  unsigned short      u16_run ;                           // Buckets equal to the last one, not written yet
+} BMM_archive_struct ;
+
 typedef struct
 {
   unsigned int        u24_signature ;                     // Signature to easily validate pointers
+  volatile unsigned int u24_sequence ;                    // Odd while the tier is being written, increased on each write
   unsigned short      u16_nrOfBuckets ;                   // Number of buckets allocated
   unsigned short      u16_firstBucket ;                   // Number of first (= currently filled) bucket
   unsigned short      u16_lastBucket ;                    // Number of the last filled bucket
-  BMM_bucket*         at_pulseBucket ;                    // Pointer to buckets
-  fetchFunction       func_fetchPulses ;                  // Pointer to the fuction for retrieving received pulses
-  unsigned int        u24_fetchedPulses ;                 // Fetched number of pulses, stored for slave processes
-  PID                 t_pulseProcessId ;                  // Process to send events to if new pulses have been received
-  PID                 t_bucketProcessId ;                 // Process to send events to in order to change the bucket
-  PID                 t_slaveProcessId ;                  // Send an event to this process if new pulses have been fetched
+  unsigned int*       au24_pulseCount ;                   // Pointer to buckets, holding only the counts
+  unsigned long*      au32_pulseTotal ;                   // Optional range index: pulse total at the opening of each bucket
+  unsigned long       u32_pulseTotal ;                    // Pulse total of the range index, including the current bucket
+  BMM_statistics_struct* at_statistics ;                  // Optional load statistics of each bucket
+  BMM_archive_struct* pt_archive ;                        // Optional compressed archive of closed buckets
+  unsigned long       u32_baseTime ;                      // Start of the first (= currently filled) bucket
+  unsigned long       u32_generation ;                    // Number of bucket changes since creation
+  t_event_enum        t_period ;                          // Period of each bucket
+  unsigned char       u8_parent ;                         // Tier whose bucket changes trigger this one, or BMM_NO_PARENT
   PID                 t_clientProcessId[BMM_MAX_EVENTS] ; // Send an event to these processes if measurement data has changed
+} BMM_tier_struct ;
+
+typedef struct
+{
+  unsigned int        u24_signature ;                     // Signature to easily validate pointers
+  unsigned char       u8_nrOfTiers ;                      // Number of tiers in use
+  BMM_tier_struct     at_tier[BMM_MAX_TIERS] ;            // Bucket memories of all resolutions
+  fetchFunction       func_fetchPulses ;                  // Pointer to the fuction for retrieving received pulses
+  fetchFunction       func_fetchRate ;                    // Pointer to the fuction for retrieving the load, for statistics
+  PID                 t_processId ;                       // Process to send pulse and bucket change events to
+  BOOL                b_started ;                         // Root tiers follow the RTC, options are fixed
 } BMM_instance_struct ;
 
 
@@ -42,37 +89,83 @@ typedef struct
 // Local Prototypes                                                           //
 ////////////////////////////////////////////////////////////////////////////////
 
-static PROCESS BMM_pulseProcess  (BMM_handle const pt_instance) ;
-static PROCESS BMM_bucketProcess (BMM_handle const pt_instance) ;
+static PROCESS BMM_Process       (BMM_handle                  const pt_instance) ;
+static void    BMM_ChangeBuckets (BMM_instance_struct       * const pt_this,
+                                  unsigned char               const u8_eventTier) ;
+static void    BMM_NextBucket    (BMM_tier_struct           * const pt_tier,
+                                  unsigned long               const u32_startTime,
+                                  unsigned short              const u16_nrOfPeriods) ;
+static void    BMM_FreeTiers     (BMM_instance_struct       * const pt_this) ;
+static void    BMM_AddSample     (BMM_statistics_struct     * const pt_statistics,
+                                  unsigned int                const u24_rate) ;
+static void    BMM_Archive       (BMM_archive_struct        * const pt_archive,
+                                  t_event_enum                const t_period,
+                                  unsigned long               const u32_timeStamp,
+                                  unsigned int                const u24_value) ;
+static void    BMM_WriteToken    (BMM_block_struct          * const pt_block,
+                                  unsigned long               const u32_token) ;
+static unsigned char BMM_TokenLength (unsigned long           const u32_token) ;
+static unsigned int BMM_ReadBegin (BMM_tier_struct     const * const pt_tier) ;
+static BOOL    BMM_ReadRetry     (BMM_tier_struct     const * const pt_tier,
+                                  unsigned int                const u24_sequence) ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global Implementations                                                     //
 ////////////////////////////////////////////////////////////////////////////////
 
-BMM_status BMM_Create          (BMM_handle     * const ppt_instance,
-                                unsigned short   const u16_nrOfBuckets)
+BMM_status BMM_Create          (BMM_handle             * const ppt_instance,
+                                unsigned char            const u8_nrOfTiers,
+                                BMM_tier_desc    const * const pat_tierDesc)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       Pulse handler construction routine                         //
-//                 - Creates an instance                                      //
+// Function:       Bucket memory construction routine                         //
+//                 - Creates an instance with a bucket memory (tier) for each //
+//                   description: period, number of buckets and parent.       //
+//                 - One process takes the pulses once and adds them to the   //
+//                   current bucket of all tiers                              //
+//                 - Tiers without a parent change bucket on their RTC event  //
+//                   once BMM_Start is called, the others are checked         //
+//                   whenever their parent changes.                           //
+//                   A parent must be described before its children, and its  //
+//                   period boundaries must include those of its children     //
 // History :       24 Jul 2004 by R. Delien:                                  //
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
   BMM_status            result      = BMM_OK ;
   BMM_instance_struct * pt_this ;
+  BMM_tier_struct     * pt_tier ;
+  unsigned char         u8_tier ;
+  unsigned char         u8_index ;
+  unsigned long         u32_currTime ;
 
   if (result == BMM_OK)
   {
     // Do parameter check
-    if ( (ppt_instance    == NULL) ||
-         (u16_nrOfBuckets == 0   )    )
+    if ( (ppt_instance      == NULL         ) ||
+         (u8_nrOfTiers      == 0            ) ||
+         (u8_nrOfTiers      >  BMM_MAX_TIERS) ||
+         (pat_tierDesc      == NULL         )    )
     {
       (void)xc_printf ("BMM_Create: Parameter error.\n") ;
       result = BMM_ERR_PARAM ;
     }
   }
 
+  if (result == BMM_OK)
+  {
+    for (u8_tier = 0; u8_tier < u8_nrOfTiers; u8_tier ++)
+    {
+      if ( (pat_tierDesc[u8_tier].u16_nrOfBuckets == 0          ) ||
+           ( (pat_tierDesc[u8_tier].u8_parent       != BMM_NO_PARENT) &&
+             (pat_tierDesc[u8_tier].u8_parent       >= u8_tier      )    )    )
+      {
+        (void)xc_printf ("BMM_Create: Parameter error.\n") ;
+        result = BMM_ERR_PARAM ;
+      }
+    }
+  }
+
   if (result == BMM_OK)
   {
     // Allocate memory for this instance
@@ -86,114 +179,99 @@ BMM_status BMM_Create          (BMM_handle     * const ppt_instance,
 
   if (result == BMM_OK)
   {
-    unsigned char u8_index ;
-
     // Initialize global variables of this instance
     pt_this->u24_signature        = BMM_SIGNATURE ;
-    pt_this->u16_nrOfBuckets      = u16_nrOfBuckets + 1 ;
-    pt_this->u16_firstBucket      = 0 ;
-    pt_this->u16_lastBucket       = 0 ;
-    pt_this->u24_fetchedPulses    = 0 ;
+    pt_this->u8_nrOfTiers         = u8_nrOfTiers ;
     pt_this->func_fetchPulses     = NULL ;
-    pt_this->t_slaveProcessId     = NULL ;
+    pt_this->func_fetchRate       = NULL ;
+    pt_this->b_started            = FALSE ;
 
-    // Clear all events
-    for (u8_index = 0; u8_index < BMM_MAX_EVENTS; u8_index ++)
+    for (u8_tier = 0; u8_tier < BMM_MAX_TIERS; u8_tier ++)
     {
-      pt_this->t_clientProcessId[u8_index] = NULL ;
-    }
-
-    // Allocate memory for buckets
-    pt_this->at_pulseBucket = getmem (pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
-    if (pt_this->at_pulseBucket == NULL)
-    {
-      // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
-
-      (void)xc_printf ("BMM_Create: Memory error (buckets).\n") ;
-      result = BMM_ERR_MEMORY ;
+      pt_this->at_tier[u8_tier].u24_signature  = 0x000000 ;
+      pt_this->at_tier[u8_tier].au24_pulseCount = NULL ;
+      pt_this->at_tier[u8_tier].au32_pulseTotal = NULL ;
+      pt_this->at_tier[u8_tier].at_statistics   = NULL ;
+      pt_this->at_tier[u8_tier].pt_archive      = NULL ;
     }
-  }
-
-  if (result == BMM_OK)
-  {
-    // Empty the current bucket
-    pt_this->at_pulseBucket[pt_this->u16_firstBucket].u24_value = 0 ;
-    // Timestamp the current bucket
-    RTC_GetTime (&(pt_this->at_pulseBucket[pt_this->u16_firstBucket].u32_timeStamp)) ;
 
-    // Create the pulse process task
-    pt_this->t_pulseProcessId = KE_TaskCreate ( (procptr)BMM_pulseProcess,  // Function
-                                                256,                        // Stack size
-                                                10,                         // Priority
-                                                "BMM_pulseCtr",             // Name
-                                                1,                          // Number of arguments
-                                                pt_this ) ;                 // Arg...
-
-    if (pt_this->t_pulseProcessId == 0)
+    for (u8_tier = 0; (u8_tier < u8_nrOfTiers) && (result == BMM_OK); u8_tier ++)
     {
-      // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)freemem (pt_this->at_pulseBucket, pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
-      (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
-
-      (void)xc_printf ("BMM_Create: Process error (create - pulse).\n") ;
-      result = BMM_ERR_PROCESS ;
-    }
-  }
+      pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+      pt_tier->u16_nrOfBuckets = pat_tierDesc[u8_tier].u16_nrOfBuckets + 1 ;
+      pt_tier->u16_firstBucket = 0 ;
+      pt_tier->u16_lastBucket  = 0 ;
+      pt_tier->t_period        = pat_tierDesc[u8_tier].t_period ;
+      pt_tier->u8_parent       = pat_tierDesc[u8_tier].u8_parent ;
+      pt_tier->u32_generation  = 0 ;
+      pt_tier->u32_pulseTotal  = 0 ;
+      pt_tier->u24_sequence    = 0 ;
+
+      // Clear all events
+      for (u8_index = 0; u8_index < BMM_MAX_EVENTS; u8_index ++)
+      {
+        pt_tier->t_clientProcessId[u8_index] = NULL ;
+      }
 
-  if (result == BMM_OK)
-  {
-    // Create the bucket change task
-    pt_this->t_bucketProcessId = KE_TaskCreate ( (procptr)BMM_bucketProcess,  // Function
-                                                 256,                         // Stack size
-                                                 10,                          // Priority
-                                                 "BMM_bucketPr",              // Name
-                                                 1,                           // Number of arguments
-                                                 pt_this ) ;                  // Arg...
+      // Allocate memory for buckets
+      pt_tier->au24_pulseCount = getmem (pt_tier->u16_nrOfBuckets * sizeof(unsigned int)) ;
+      if (pt_tier->au24_pulseCount == NULL)
+      {
+        // Clean up
+        BMM_FreeTiers (pt_this) ;
+        pt_this->u24_signature = 0x000000 ;
+        (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
 
-    if (pt_this->t_bucketProcessId == 0)
-    {
-      // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)KE_TaskDelete (pt_this->t_pulseProcessId) ;
-      (void)freemem (pt_this->at_pulseBucket, pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
-      (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
+        (void)xc_printf ("BMM_Create: Memory error (buckets).\n") ;
+        result = BMM_ERR_MEMORY ;
+      }
+      else
+      {
+        // Empty the current bucket
+        pt_tier->au24_pulseCount[pt_tier->u16_firstBucket] = 0 ;
+        // Timestamp the current bucket with the start of its period
+        RTC_GetTime (&u32_currTime) ;
+        RTC_AlignTime (pt_tier->t_period, u32_currTime, &(pt_tier->u32_baseTime)) ;
 
-      (void)xc_printf ("BMM_Create: Process error (create - pulse).\n") ;
-      result = BMM_ERR_PROCESS ;
+        pt_tier->u24_signature = BMM_TIER_SIGNATURE ;
+      }
     }
   }
 
   if (result == BMM_OK)
   {
-    if ( KE_TaskResume(pt_this->t_pulseProcessId) == SYSERR)
+    // Create the process
+    pt_this->t_processId = KE_TaskCreate ( (procptr)BMM_Process,   // Function
+                                           256,                    // Stack size
+                                           10,                     // Priority
+                                           "BMM_Process",          // Name
+                                           1,                      // Number of arguments
+                                           pt_this ) ;             // Arg...
+
+    if (pt_this->t_processId == 0)
     {
       // Clean up
+      BMM_FreeTiers (pt_this) ;
       pt_this->u24_signature = 0x000000 ;
-      (void)KE_TaskDelete (pt_this->t_bucketProcessId) ;
-      (void)KE_TaskDelete (pt_this->t_pulseProcessId) ;
-      (void)freemem (pt_this->at_pulseBucket, pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
       (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
 
-      (void)xc_printf ("BMM_Create: Process error (resume - pulse).\n") ;
+      (void)xc_printf ("BMM_Create: Process error (create).\n") ;
       result = BMM_ERR_PROCESS ;
     }
   }
 
   if (result == BMM_OK)
   {
-    if ( KE_TaskResume(pt_this->t_bucketProcessId) == SYSERR)
+    if ( KE_TaskResume(pt_this->t_processId) == SYSERR)
     {
       // Clean up
+      (void)KE_TaskDelete (pt_this->t_processId) ;
+      BMM_FreeTiers (pt_this) ;
       pt_this->u24_signature = 0x000000 ;
-      (void)KE_TaskDelete (pt_this->t_bucketProcessId) ;
-      (void)KE_TaskDelete (pt_this->t_pulseProcessId) ;
-      (void)freemem (pt_this->at_pulseBucket, pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
       (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
 
-      (void)xc_printf ("BMM_Create: Process error (resume - pulse).\n") ;
+      (void)xc_printf ("BMM_Create: Process error (resume).\n") ;
       result = BMM_ERR_PROCESS ;
     }
   }
@@ -211,14 +289,15 @@ BMM_status BMM_Create          (BMM_handle     * const ppt_instance,
 
 BMM_status BMM_Delete (BMM_handle const pt_instance)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       Pulse handler destruction routine                          //
-//                 - Destroys an instance                                     //
+// Function:       Bucket memory destruction routine                          //
+//                 - Destroys an instance and all of its tiers                //
 // History :       24 Jul 2004 by R. Delien:                                  //
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
   BMM_status                  result  = BMM_OK ;
   BMM_instance_struct * const pt_this = pt_instance ;
+  unsigned char               u8_tier ;
 
   if (result == BMM_OK)
   {
@@ -242,15 +321,21 @@ BMM_status BMM_Delete (BMM_handle const pt_instance)
 
   if (result == BMM_OK)
   {
-    // Kill the tasks
-    (void)KE_TaskDelete (pt_this->t_bucketProcessId) ;
-    (void)KE_TaskDelete (pt_this->t_pulseProcessId) ;
+    // Unsubscribe from the RTC
+    for (u8_tier = 0; (u8_tier < pt_this->u8_nrOfTiers) && (pt_this->b_started); u8_tier ++)
+    {
+      if (pt_this->at_tier[u8_tier].u8_parent == BMM_NO_PARENT)
+      {
+        (void)RTC_RemoveClient (pt_this->t_processId, &(pt_this->at_tier[u8_tier])) ;
+      }
+    }
 
-    // Invalidate the pointer
-    pt_this->u24_signature = 0x000000 ;
+    // Kill the task
+    (void)KE_TaskDelete (pt_this->t_processId) ;
 
-    // Return the memory to the memory manager
-    (void)freemem (pt_this->at_pulseBucket, pt_this->u16_nrOfBuckets * sizeof(BMM_bucket)) ;
+    // Invalidate the pointers and return the memory to the memory manager
+    BMM_FreeTiers (pt_this) ;
+    pt_this->u24_signature = 0x000000 ;
     (void)freemem (pt_this, sizeof(BMM_instance_struct)) ;
   }
 
@@ -259,6 +344,85 @@ BMM_status BMM_Delete (BMM_handle const pt_instance)
 // End: BMM_Delete
 
 
+BMM_status BMM_Start (BMM_handle const pt_instance)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_Start                                                  //
+//                 - Subscribes the tiers without a parent to their RTC       //
+//                   event. Until then the process receives no events, so the //
+//                   options of the tiers can be set without racing it. The   //
+//                   options are fixed from here on                           //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_instance_struct * const pt_this = pt_instance ;
+  unsigned char               u8_tier ;
+  unsigned char               u8_index ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if (pt_instance == NULL)
+    {
+      (void)xc_printf ("BMM_Start: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_Start: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    if (pt_this->b_started)
+    {
+      (void)xc_printf ("BMM_Start: Already started.\n") ;
+      result = BMM_ERR_STARTED ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Subscribe the tiers without a parent to their RTC event. The tier itself
+    // is sent along with the event, which tells the process which tier to change
+    for (u8_tier = 0; (u8_tier < pt_this->u8_nrOfTiers) && (result == BMM_OK); u8_tier ++)
+    {
+      if (pt_this->at_tier[u8_tier].u8_parent == BMM_NO_PARENT)
+      {
+        if (RTC_AddClient (pt_this->at_tier[u8_tier].t_period, pt_this->t_processId, &(pt_this->at_tier[u8_tier])) != RTC_OK)
+        {
+          // Clean up
+          for (u8_index = 0; u8_index < u8_tier; u8_index ++)
+          {
+            if (pt_this->at_tier[u8_index].u8_parent == BMM_NO_PARENT)
+            {
+              (void)RTC_RemoveClient (pt_this->t_processId, &(pt_this->at_tier[u8_index])) ;
+            }
+          }
+
+          (void)xc_printf ("BMM_Start: No free RTC slot.\n") ;
+          result = BMM_ERR_NOFREESLOT ;
+        }
+      }
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_this->b_started = TRUE ;
+  }
+
+  return (result) ;
+}
+// End: BMM_Start
+
+
 BMM_status BMM_SetMeteringFunc (BMM_handle    const pt_instance,
                                 fetchFunction const func_GetPulses)
 ////////////////////////////////////////////////////////////////////////////////
@@ -302,6 +466,48 @@ BMM_status BMM_SetMeteringFunc (BMM_handle    const pt_instance,
 // End: BMM_SetMeteringFunc
 
 
+BMM_status BMM_SetRateFunc (BMM_handle    const pt_instance,
+                            fetchFunction const func_GetRate)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_SetRateFunc                                            //
+//                 - Sets the function to invoke for retrieving the load,     //
+//                   which feeds the statistics of the buckets                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_instance_struct * const pt_this = pt_instance ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if (pt_instance == NULL)
+    {
+      (void)xc_printf ("BMM_SetRateFunc: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_SetRateFunc: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Set the rate-fetch function
+    pt_this->func_fetchRate = func_GetRate ;
+  }
+
+  return (result) ;
+}
+// End: BMM_SetRateFunc
+
+
 BMM_status BMM_GetMeteringProc (BMM_handle   const pt_instance,
                                 PID        * const pt_processId)
 ////////////////////////////////////////////////////////////////////////////////
@@ -338,7 +544,7 @@ BMM_status BMM_GetMeteringProc (BMM_handle   const pt_instance,
   if (result == BMM_OK)
   {
     // Fill out the process ID
-    *pt_processId = pt_this->t_pulseProcessId ;
+    *pt_processId = pt_this->t_processId ;
   }
 
   return (result) ;
@@ -346,13 +552,13 @@ BMM_status BMM_GetMeteringProc (BMM_handle   const pt_instance,
 // End: BMM_GetMeteringProc
 
 
-BMM_status BMM_GetBucketProc (BMM_handle   const pt_instance,
-                              PID        * const pt_processId)
+BMM_status BMM_GetTier (BMM_handle   const pt_instance,
+                        unsigned char  const u8_tier,
+                        BMM_handle   * const ppt_tier)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       BMM_GetBucketProc                                          //
-//                 - Retrieves the process ID of the bucket change process    //
-// History :       24 Jul 2004 by R. Delien:                                  //
-//                 - Initial revision.                                        //
+// Function:       BMM_GetTier                                                //
+//                 - Retrieves the handle of a tier, for reading its buckets  //
+//                   and subscribing to its bucket change event               //
 ////////////////////////////////////////////////////////////////////////////////
 {
   BMM_status                  result  = BMM_OK ;
@@ -361,10 +567,10 @@ BMM_status BMM_GetBucketProc (BMM_handle   const pt_instance,
   if (result == BMM_OK)
   {
     // Do parameter check
-    if ( (pt_instance  == NULL) ||
-         (pt_processId == NULL)    )
+    if ( (pt_instance == NULL) ||
+         (ppt_tier    == NULL)    )
     {
-      (void)xc_printf ("BMM_GetMeteringProc: Parameter error.\n") ;
+      (void)xc_printf ("BMM_GetTier: Parameter error.\n") ;
       result = BMM_ERR_PARAM ;
     }
   }
@@ -372,42 +578,48 @@ BMM_status BMM_GetBucketProc (BMM_handle   const pt_instance,
   if (result == BMM_OK)
   {
     // Check if the pointer is valid
-    if (BMM_PTR_INVALID(pt_this))
+    if ( (BMM_PTR_INVALID(pt_this)       ) ||
+         (u8_tier >= pt_this->u8_nrOfTiers)    )
     {
-      (void)xc_printf ("BMM_GetMeteringProc: Invalid pointer.\n") ;
+      (void)xc_printf ("BMM_GetTier: Invalid pointer.\n") ;
       result = BMM_ERR_POINTER ;
     }
   }
 
   if (result == BMM_OK)
   {
-    // Fill out the process ID
-    *pt_processId = pt_this->t_bucketProcessId ;
+    // Fill out the tier handle
+    *ppt_tier = &(pt_this->at_tier[u8_tier]) ;
   }
 
   return (result) ;
 }
-// End: BMM_GetBucketProc
+// End: BMM_GetTier
 
 
-BMM_status BMM_SetSlaveProc (BMM_handle const pt_instance,
-                             PID        const pt_processId)
+BMM_status BMM_SetRangeIndex (BMM_handle   const pt_instance,
+                              unsigned char  const u8_tier)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       BMM_SetSlaveProc                                           //
-//                 - Sets the process ID to re-send pulse-events to           //
-// History :       24 Jul 2004 by R. Delien:                                  //
-//                 - Initial revision.                                        //
+// Function:       BMM_SetRangeIndex                                          //
+//                 - Adds a range index to a tier: the pulse total at the     //
+//                   opening of each bucket, so BMM_GetRangeSum can subtract  //
+//                   two totals instead of adding up buckets. Costs 4 bytes   //
+//                   per bucket. Call it before BMM_Start; the process is the //
+//                   only writer after that                                   //
 ////////////////////////////////////////////////////////////////////////////////
 {
   BMM_status                  result  = BMM_OK ;
   BMM_instance_struct * const pt_this = pt_instance ;
+  BMM_tier_struct     *       pt_tier ;
+  unsigned long*              au32_pulseTotal ;
+  unsigned short              u16_bucket ;
 
   if (result == BMM_OK)
   {
     // Do parameter check
-    if (pt_instance  == NULL)
+    if (pt_instance == NULL)
     {
-      (void)xc_printf ("BMM_SetSlaveProc: Parameter error.\n") ;
+      (void)xc_printf ("BMM_SetRangeIndex: Parameter error.\n") ;
       result = BMM_ERR_PARAM ;
     }
   }
@@ -415,42 +627,94 @@ BMM_status BMM_SetSlaveProc (BMM_handle const pt_instance,
   if (result == BMM_OK)
   {
     // Check if the pointer is valid
-    if (BMM_PTR_INVALID(pt_this))
+    if ( (BMM_PTR_INVALID(pt_this)       ) ||
+         (u8_tier >= pt_this->u8_nrOfTiers)    )
     {
-      (void)xc_printf ("BMM_SetSlaveProc: Invalid pointer.\n") ;
+      (void)xc_printf ("BMM_SetRangeIndex: Invalid pointer.\n") ;
       result = BMM_ERR_POINTER ;
     }
   }
 
   if (result == BMM_OK)
   {
-    // Set the process ID
-    pt_this->t_slaveProcessId = pt_processId ;
+    // The process is the only writer once the instance is started
+    if (pt_this->b_started)
+    {
+      (void)xc_printf ("BMM_SetRangeIndex: Already started.\n") ;
+      result = BMM_ERR_STARTED ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+    // Nothing to do if the tier has an index already
+    if (pt_tier->au32_pulseTotal == NULL)
+    {
+      au32_pulseTotal = getmem (pt_tier->u16_nrOfBuckets * sizeof(unsigned long)) ;
+      if (au32_pulseTotal == NULL)
+      {
+        (void)xc_printf ("BMM_SetRangeIndex: Memory error.\n") ;
+        result = BMM_ERR_MEMORY ;
+      }
+      else
+      {
+        pt_tier->u24_sequence ++ ;
+
+        // Build the index from the buckets filled so far
+        u16_bucket = pt_tier->u16_lastBucket ;
+        pt_tier->u32_pulseTotal = 0 ;
+        for (;;)
+        {
+          au32_pulseTotal[u16_bucket] = pt_tier->u32_pulseTotal ;
+          pt_tier->u32_pulseTotal    += pt_tier->au24_pulseCount[u16_bucket] ;
+
+          if (u16_bucket == pt_tier->u16_firstBucket)
+          {
+            break ;
+          }
+
+          u16_bucket ++ ;
+          if (u16_bucket >= pt_tier->u16_nrOfBuckets)
+          {
+            u16_bucket = 0 ;
+          }
+        }
+        pt_tier->au32_pulseTotal = au32_pulseTotal ;
+
+        pt_tier->u24_sequence ++ ;
+      }
+    }
   }
 
   return (result) ;
 }
-// End: BMM_SetSlaveProc
+// End: BMM_SetRangeIndex
 
 
-BMM_status BMM_GetPulses (BMM_handle     const pt_instance,
-                          unsigned int * const pu24_pulses)
+BMM_status BMM_SetStatistics (BMM_handle   const pt_instance,
+                              unsigned char  const u8_tier)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       BMM_GetPulses                                              //
-//                 - Function for slave processes to the retrieved nr of pulses //
-// History :       24 Jul 2004 by R. Delien:                                  //
-//                 - Initial revision.                                        //
+// Function:       BMM_SetStatistics                                          //
+//                 - Adds load statistics to a tier: the minimum and maximum  //
+//                   load and the number of samples of each bucket. Costs 9   //
+//                   bytes per bucket. Call it before BMM_Start; the process  //
+//                   is the only writer after that                            //
 ////////////////////////////////////////////////////////////////////////////////
 {
   BMM_status                  result  = BMM_OK ;
   BMM_instance_struct * const pt_this = pt_instance ;
+  BMM_tier_struct     *       pt_tier ;
+  BMM_statistics_struct *     at_statistics ;
+  unsigned short              u16_bucket ;
 
   if (result == BMM_OK)
   {
     // Do parameter check
     if (pt_instance == NULL)
     {
-      (void)xc_printf ("BMM_GetPulses: Parameter error.\n") ;
+      (void)xc_printf ("BMM_SetStatistics: Parameter error.\n") ;
       result = BMM_ERR_PARAM ;
     }
   }
@@ -458,33 +722,158 @@ BMM_status BMM_GetPulses (BMM_handle     const pt_instance,
   if (result == BMM_OK)
   {
     // Check if the pointer is valid
-    if (BMM_PTR_INVALID(pt_this))
+    if ( (BMM_PTR_INVALID(pt_this)       ) ||
+         (u8_tier >= pt_this->u8_nrOfTiers)    )
+    {
+      (void)xc_printf ("BMM_SetStatistics: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // The process is the only writer once the instance is started
+    if (pt_this->b_started)
+    {
+      (void)xc_printf ("BMM_SetStatistics: Already started.\n") ;
+      result = BMM_ERR_STARTED ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+    // Nothing to do if the tier has statistics already
+    if (pt_tier->at_statistics == NULL)
+    {
+      at_statistics = getmem (pt_tier->u16_nrOfBuckets * sizeof(BMM_statistics_struct)) ;
+      if (at_statistics == NULL)
+      {
+        (void)xc_printf ("BMM_SetStatistics: Memory error.\n") ;
+        result = BMM_ERR_MEMORY ;
+      }
+      else
+      {
+        // Buckets filled so far have no samples
+        for (u16_bucket = 0; u16_bucket < pt_tier->u16_nrOfBuckets; u16_bucket ++)
+        {
+          at_statistics[u16_bucket].u24_nrOfSamples = 0 ;
+        }
+
+        pt_tier->u24_sequence ++ ;
+        pt_tier->at_statistics = at_statistics ;
+        pt_tier->u24_sequence ++ ;
+      }
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_SetStatistics
+
+
+BMM_status BMM_SetArchive (BMM_handle     const pt_instance,
+                           unsigned char  const u8_tier,
+                           unsigned short const u16_nrOfBlocks)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_SetArchive                                             //
+//                 - Adds a compressed archive to a tier: every closed bucket //
+//                   is appended to a ring of u16_nrOfBlocks blocks, the      //
+//                   oldest block is dropped whole when the ring is full.     //
+//                   Call it before BMM_Start; the process is the only writer //
+//                   after that                                               //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_instance_struct * const pt_this = pt_instance ;
+  BMM_tier_struct     *       pt_tier ;
+  BMM_archive_struct  *       pt_archive ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance    == NULL) ||
+         (u16_nrOfBlocks == 0   )    )
+    {
+      (void)xc_printf ("BMM_SetArchive: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if ( (BMM_PTR_INVALID(pt_this)       ) ||
+         (u8_tier >= pt_this->u8_nrOfTiers)    )
     {
-      (void)xc_printf ("BMM_GetPulses: Invalid pointer.\n") ;
+      (void)xc_printf ("BMM_SetArchive: Invalid pointer.\n") ;
       result = BMM_ERR_POINTER ;
     }
   }
 
   if (result == BMM_OK)
   {
-    KE_CriticalBegin () ;
+    // The process is the only writer once the instance is started
+    if (pt_this->b_started)
+    {
+      (void)xc_printf ("BMM_SetArchive: Already started.\n") ;
+      result = BMM_ERR_STARTED ;
+    }
+  }
 
-    *pu24_pulses = pt_this->u24_fetchedPulses ;
-    pt_this->u24_fetchedPulses = 0 ;
+  if (result == BMM_OK)
+  {
+    pt_tier = &(pt_this->at_tier[u8_tier]) ;
 
-    KE_CriticalEnd () ;
+    // Nothing to do if the tier has an archive already
+    if (pt_tier->pt_archive == NULL)
+    {
+      pt_archive = getmem (sizeof(BMM_archive_struct)) ;
+      if (pt_archive == NULL)
+      {
+        (void)xc_printf ("BMM_SetArchive: Memory error (archive).\n") ;
+        result = BMM_ERR_MEMORY ;
+      }
+      else
+      {
+        pt_archive->at_block = getmem (u16_nrOfBlocks * sizeof(BMM_block_struct)) ;
+        if (pt_archive->at_block == NULL)
+        {
+          // Clean up
+          (void)freemem (pt_archive, sizeof(BMM_archive_struct)) ;
+
+          (void)xc_printf ("BMM_SetArchive: Memory error (blocks).\n") ;
+          result = BMM_ERR_MEMORY ;
+        }
+        else
+        {
+          pt_archive->u16_nrOfBlocks = u16_nrOfBlocks ;
+          pt_archive->u16_firstBlock = 0 ;
+          pt_archive->u16_usedBlocks = 0 ;
+          pt_archive->u32_nextSerial = 1 ;
+          pt_archive->u32_nextTime   = 0 ;
+          pt_archive->u24_lastValue  = 0 ;
+          pt_archive->u16_run        = 0 ;
+
+          pt_tier->u24_sequence ++ ;
+          pt_tier->pt_archive = pt_archive ;
+          pt_tier->u24_sequence ++ ;
+        }
+      }
+    }
   }
 
   return (result) ;
 }
-// End: BMM_GetPulses
+// End: BMM_SetArchive
 
 
 BMM_status BMM_AddClient (BMM_handle         const pt_instance,
                           PID                const t_clientProcId)
 {
   BMM_status                  result   = BMM_OK ;
-  BMM_instance_struct * const pt_this  = pt_instance ;
+  BMM_tier_struct     * const pt_this  = pt_instance ;
   unsigned char               u8_index = 0 ;
 
   if (result == BMM_OK)
@@ -525,7 +914,7 @@ BMM_status BMM_RemoveClient (BMM_handle         const pt_instance,
                              PID                const t_clientProcId)
 {
   BMM_status                  result   = BMM_OK ;
-  BMM_instance_struct * const pt_this  = pt_instance ;
+  BMM_tier_struct     * const pt_this  = pt_instance ;
   unsigned char               u8_index = 0 ;
 
   if (result == BMM_OK)
@@ -566,7 +955,8 @@ BMM_status BMM_GetNrOfBuckets (BMM_handle       const pt_instance,
                                unsigned short * const pu16_nrOfBuckets)
 {
   BMM_status                  result  = BMM_OK ;
-  BMM_instance_struct * const pt_this = pt_instance ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned int                u24_sequence ;
 
   if (result == BMM_OK)
   {
@@ -582,7 +972,7 @@ BMM_status BMM_GetNrOfBuckets (BMM_handle       const pt_instance,
   if (result == BMM_OK)
   {
     // Check if the pointer is valid
-    if (BMM_PTR_INVALID(pt_this))
+    if (BMM_TIER_INVALID(pt_this))
     {
       (void)xc_printf ("BMM_GetNrOfBuckets: Invalid pointer.\n") ;
       result = BMM_ERR_POINTER ;
@@ -591,15 +981,20 @@ BMM_status BMM_GetNrOfBuckets (BMM_handle       const pt_instance,
 
   if (result == BMM_OK)
   {
-    // Calculate the current number of timestamps in the queue
-    if (pt_this->u16_firstBucket >= pt_this->u16_lastBucket)
-    {
-      *pu16_nrOfBuckets = pt_this->u16_firstBucket - pt_this->u16_lastBucket ;
-    }
-    else
+    do
     {
-      *pu16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets) - pt_this->u16_lastBucket ;
-    }
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      // Calculate the current number of timestamps in the queue
+      if (pt_this->u16_firstBucket >= pt_this->u16_lastBucket)
+      {
+        *pu16_nrOfBuckets = pt_this->u16_firstBucket - pt_this->u16_lastBucket ;
+      }
+      else
+      {
+        *pu16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets) - pt_this->u16_lastBucket ;
+      }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
   }
 
   return (result) ;
@@ -612,8 +1007,10 @@ BMM_status BMM_GetBucketCont (BMM_handle       const pt_instance,
                               BMM_bucket     * const pt_bucketContents)
 {
   BMM_status                  result  = BMM_OK ;
-  BMM_instance_struct * const pt_this = pt_instance ;
-  BMM_bucket*                 pt_tmpBucket ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned short              u16_bucketsAgo ;
+  unsigned long               u32_baseTime ;
+  unsigned int                u24_sequence ;
 
   if (result == BMM_OK)
   {
@@ -629,7 +1026,7 @@ BMM_status BMM_GetBucketCont (BMM_handle       const pt_instance,
   if (result == BMM_OK)
   {
     // Check if the pointer is valid
-    if (BMM_PTR_INVALID(pt_this))
+    if (BMM_TIER_INVALID(pt_this))
     {
       (void)xc_printf ("BMM_GetBucketCont: Invalid pointer.\n") ;
       result = BMM_ERR_POINTER ;
@@ -638,10 +1035,18 @@ BMM_status BMM_GetBucketCont (BMM_handle       const pt_instance,
 
   if (result == BMM_OK)
   {
-    // Fill out a poiter to work around a compiler, eh, short coming
-    pt_tmpBucket = &(pt_this->at_pulseBucket[(pt_this->u16_lastBucket + u16_bucketNr) % pt_this->u16_nrOfBuckets]) ;
-    // Copy the bucket into the supplied pointer buffer
-    *pt_bucketContents = *pt_tmpBucket ;
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      // Copy the count and take the base time of the same bucket generation
+      pt_bucketContents->u24_value = pt_this->au24_pulseCount[(pt_this->u16_lastBucket + u16_bucketNr) % pt_this->u16_nrOfBuckets] ;
+      u32_baseTime                 = pt_this->u32_baseTime ;
+      u16_bucketsAgo               = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - pt_this->u16_lastBucket - u16_bucketNr) % pt_this->u16_nrOfBuckets ;
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    // The timestamp is the start of the bucket's period
+    RTC_AddPeriods (pt_this->t_period, u32_baseTime, -(long)u16_bucketsAgo, &(pt_bucketContents->u32_timeStamp)) ;
   }
 
   return (result) ;
@@ -649,96 +1054,1324 @@ BMM_status BMM_GetBucketCont (BMM_handle       const pt_instance,
 // End: BMM_GetBucketCont
 
 
+BMM_status BMM_GetBucketRange (BMM_handle               const pt_instance,
+                               unsigned short           const u16_bucketNr,
+                               unsigned short           const u16_maxBuckets,
+                               unsigned int           * const pau24_values,
+                               BMM_range_struct       * const pt_range)
 ////////////////////////////////////////////////////////////////////////////////
-// Local Implementations                                                      //
+// Function:       BMM_GetBucketRange                                         //
+//                 - Copies up to u16_maxBuckets closed buckets, starting at  //
+//                   u16_bucketNr (0 = oldest), in one go. The number of      //
+//                   buckets and the generation are taken at the same instant //
+//                   as the copy, so the range is a consistent snapshot       //
 ////////////////////////////////////////////////////////////////////////////////
-static PROCESS BMM_pulseProcess (BMM_handle const pt_instance)
 {
-  BMM_instance_struct * const pt_this = pt_instance ;
-  void*                       pt_phdInstance ;
-  unsigned int                u24_nrOfPulses ;
-  BMM_bucket*                 pt_tmpBucket ;
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned short              u16_startBucket ;
+  unsigned short              u16_nrToWrap ;
+  unsigned short              u16_bucketsAgo ;
+  unsigned long               u32_baseTime ;
+  unsigned int                u24_sequence ;
 
-  for (;;)
+  if (result == BMM_OK)
   {
-    // Wait for a new-pulse-event
-    pt_phdInstance = KE_MBoxReceive () ;
-
-    // Get the pulse(s)
-    if (pt_this->func_fetchPulses != NULL)
+    // Do parameter check
+    if ( (pt_instance  == NULL) ||
+         (pau24_values == NULL) ||
+         (pt_range     == NULL)    )
     {
-      // Fetch the number of metered pulses
-      (void)pt_this->func_fetchPulses (pt_phdInstance, &u24_nrOfPulses) ;
-
-      KE_CriticalBegin () ;
-
-      // Add the pulse(s) to the buffer for the slave process
-      pt_this->u24_fetchedPulses += u24_nrOfPulses ;
-
-      // Add the pulse(e) to the current bucket
-      pt_this->at_pulseBucket[pt_this->u16_firstBucket].u24_value += u24_nrOfPulses ;
+      (void)xc_printf ("BMM_GetBucketRange: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
 
-      KE_CriticalEnd () ;
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetBucketRange: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      // Calculate the current number of closed buckets
+      pt_range->u16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - pt_this->u16_lastBucket) % pt_this->u16_nrOfBuckets ;
+      pt_range->u32_generation  = pt_this->u32_generation ;
+      pt_range->t_period        = pt_this->t_period ;
+      pt_range->b_statistics    = (pt_this->at_statistics != NULL) ;
+      u32_baseTime              = pt_this->u32_baseTime ;
+
+      // Limit the range to the closed buckets
+      if (u16_bucketNr >= pt_range->u16_nrOfBuckets)
+      {
+        pt_range->u16_nrCopied = 0 ;
+      }
+      else if (u16_maxBuckets > pt_range->u16_nrOfBuckets - u16_bucketNr)
+      {
+        pt_range->u16_nrCopied = pt_range->u16_nrOfBuckets - u16_bucketNr ;
+      }
+      else
+      {
+        pt_range->u16_nrCopied = u16_maxBuckets ;
+      }
+
+      // Copy up to the end of the ring, then the part that wrapped around
+      u16_startBucket = (pt_this->u16_lastBucket + u16_bucketNr) % pt_this->u16_nrOfBuckets ;
+      u16_nrToWrap    = pt_this->u16_nrOfBuckets - u16_startBucket ;
+      if (pt_range->u16_nrCopied <= u16_nrToWrap)
+      {
+        memcpy (pau24_values, &(pt_this->au24_pulseCount[u16_startBucket]), pt_range->u16_nrCopied * sizeof(unsigned int)) ;
+      }
+      else
+      {
+        memcpy (pau24_values, &(pt_this->au24_pulseCount[u16_startBucket]), u16_nrToWrap * sizeof(unsigned int)) ;
+        memcpy (&(pau24_values[u16_nrToWrap]), pt_this->au24_pulseCount, (pt_range->u16_nrCopied - u16_nrToWrap) * sizeof(unsigned int)) ;
+      }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    // The timestamp is the start of the first copied bucket's period. With
+    // nothing copied it's the start of the running one, the next to close.
+    if (pt_range->u16_nrCopied > 0)
+    {
+      u16_bucketsAgo = pt_range->u16_nrOfBuckets - u16_bucketNr ;
+      RTC_AddPeriods (pt_range->t_period, u32_baseTime, -(long)u16_bucketsAgo, &(pt_range->u32_timeStamp)) ;
+    }
+    else
+    {
+      pt_range->u32_timeStamp = u32_baseTime ;
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_GetBucketRange
+
+
+BMM_status BMM_Resample (BMM_handle               const pt_instance,
+                         unsigned long            const u32_startTime,
+                         unsigned short           const u16_factor,
+                         unsigned short           const u16_maxBuckets,
+                         unsigned long          * const pau32_values,
+                         BMM_range_struct       * const pt_range)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_Resample                                               //
+//                 - Fills up to u16_maxBuckets buckets of u16_factor times   //
+//                   the tier's period, from the group containing             //
+//                   u32_startTime (see RTC_AlignGroup) up to and including   //
+//                   the current bucket, which makes the last one partial. If //
+//                   the tier doesn't reach back that far, the groups start   //
+//                   at the first group boundary it holds                     //
+//                 - Adds up the tier's buckets in one pass straight into the //
+//                   caller's buffer. The start of the first bucket is        //
+//                   returned in the range's timestamp                        //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned int                u24_sequence ;
+  unsigned long               u32_baseTime ;
+  unsigned long               u32_alignedStart ;
+  unsigned long               u32_firstTime ;
+  unsigned long               u32_groupTime ;
+  unsigned short              u16_bucketsAgo ;
+  unsigned short              u16_skip ;
+  unsigned short              u16_bucket ;
+  unsigned short              u16_nrOfSource ;
+  unsigned short              u16_source ;
+  unsigned short              u16_inBucket ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance    == NULL) ||
+         (u16_factor     == 0   ) ||
+         (u16_maxBuckets == 0   ) ||
+         (pau32_values   == NULL) ||
+         (pt_range       == NULL)    )
+    {
+      (void)xc_printf ("BMM_Resample: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_Resample: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    RTC_AlignGroup (pt_this->t_period, u16_factor, u32_startTime, &u32_alignedStart) ;
+
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      pt_range->u16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - pt_this->u16_lastBucket) % pt_this->u16_nrOfBuckets ;
+      pt_range->u32_generation  = pt_this->u32_generation ;
+      pt_range->t_period        = pt_this->t_period ;
+      pt_range->b_statistics    = (pt_this->at_statistics != NULL) ;
+      u32_baseTime              = pt_this->u32_baseTime ;
+
+      // Find the bucket holding the start time, counted back from the current one
+      RTC_CountPeriods (pt_range->t_period, u32_alignedStart, u32_baseTime, pt_range->u16_nrOfBuckets, &u16_bucketsAgo) ;
+
+      // Skip the oldest buckets up to a group boundary if the start was dropped
+      RTC_AddPeriods (pt_range->t_period, u32_baseTime, -(long)u16_bucketsAgo, &u32_firstTime) ;
+      if (u32_firstTime > u32_alignedStart)
+      {
+        RTC_AlignGroup (pt_range->t_period, u16_factor, u32_firstTime, &u32_groupTime) ;
+        if (u32_groupTime < u32_firstTime)
+        {
+          RTC_CountPeriods (pt_range->t_period, u32_groupTime, u32_firstTime, u16_factor, &u16_skip) ;
+          u16_skip = u16_factor - u16_skip ;
+          u16_bucketsAgo = (u16_skip < u16_bucketsAgo) ? u16_bucketsAgo - u16_skip : 0 ;
+        }
+      }
+
+      // Limit the source to what fits in the caller's buffer
+      u16_nrOfSource = u16_bucketsAgo + 1 ;
+      if (u16_nrOfSource > (unsigned long)u16_maxBuckets * u16_factor)
+      {
+        u16_nrOfSource = u16_maxBuckets * u16_factor ;
+      }
+
+      // Add up the source buckets, oldest first
+      u16_source   = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - u16_bucketsAgo) % pt_this->u16_nrOfBuckets ;
+      u16_bucket   = 0 ;
+      u16_inBucket = 0 ;
+      pau32_values[0] = 0 ;
+      while (u16_nrOfSource > 0)
+      {
+        if (u16_inBucket == u16_factor)
+        {
+          u16_bucket ++ ;
+          u16_inBucket = 0 ;
+          pau32_values[u16_bucket] = 0 ;
+        }
+
+        pau32_values[u16_bucket] += pt_this->au24_pulseCount[u16_source] ;
+        u16_inBucket ++ ;
+        u16_nrOfSource -- ;
+
+        u16_source ++ ;
+        if (u16_source >= pt_this->u16_nrOfBuckets)
+        {
+          u16_source = 0 ;
+        }
+      }
+      pt_range->u16_nrCopied = u16_bucket + 1 ;
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    // The first bucket starts where its oldest source bucket does
+    RTC_AddPeriods (pt_range->t_period, u32_baseTime, -(long)u16_bucketsAgo, &(pt_range->u32_timeStamp)) ;
+  }
+
+  return (result) ;
+}
+// End: BMM_Resample
+
+
+BMM_status BMM_GetRangeSum (BMM_handle       const pt_instance,
+                            unsigned short   const u16_fromBucketNr,
+                            unsigned short   const u16_toBucketNr,
+                            unsigned long  * const pu32_sum)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_GetRangeSum                                            //
+//                 - Returns the number of pulses in buckets u16_fromBucketNr //
+//                   up to and including u16_toBucketNr (0 = oldest, the      //
+//                   number of buckets = the current bucket) in O(1). The     //
+//                   tier needs a range index (BMM_SetRangeIndex)             //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned short              u16_nrOfBuckets ;
+  unsigned long               u32_fromTotal ;
+  unsigned long               u32_toTotal ;
+  unsigned int                u24_sequence ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance      == NULL            ) ||
+         (pu32_sum         == NULL            ) ||
+         (u16_fromBucketNr >  u16_toBucketNr  )    )
+    {
+      (void)xc_printf ("BMM_GetRangeSum: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetRangeSum: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    if (pt_this->au32_pulseTotal == NULL)
+    {
+      (void)xc_printf ("BMM_GetRangeSum: No range index.\n") ;
+      result = BMM_ERR_NOINDEX ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+      result       = BMM_OK ;
+
+      u16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - pt_this->u16_lastBucket) % pt_this->u16_nrOfBuckets ;
+      if (u16_toBucketNr > u16_nrOfBuckets)
+      {
+        result = BMM_ERR_PARAM ;
+      }
+      else
+      {
+        // The range ends where the next bucket opens, or at the running total
+        u32_fromTotal = pt_this->au32_pulseTotal[(pt_this->u16_lastBucket + u16_fromBucketNr) % pt_this->u16_nrOfBuckets] ;
+        if (u16_toBucketNr == u16_nrOfBuckets)
+        {
+          u32_toTotal = pt_this->u32_pulseTotal ;
+        }
+        else
+        {
+          u32_toTotal = pt_this->au32_pulseTotal[(pt_this->u16_lastBucket + u16_toBucketNr + 1) % pt_this->u16_nrOfBuckets] ;
+        }
+      }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    if (result == BMM_OK)
+    {
+      // Unsigned subtraction also holds when the total has wrapped
+      *pu32_sum = u32_toTotal - u32_fromTotal ;
+    }
+    else
+    {
+      (void)xc_printf ("BMM_GetRangeSum: Parameter error.\n") ;
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_GetRangeSum
+
+
+BMM_status BMM_GetBucketStats (BMM_handle               const pt_instance,
+                               unsigned short           const u16_bucketNr,
+                               BMM_statistics_struct  * const pt_statistics)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_GetBucketStats                                         //
+//                 - Retrieves the load statistics of a bucket (0 = oldest,   //
+//                   the number of buckets = the current bucket). The tier    //
+//                   needs statistics (BMM_SetStatistics)                     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned int                u24_sequence ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance   == NULL) ||
+         (pt_statistics == NULL)    )
+    {
+      (void)xc_printf ("BMM_GetBucketStats: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetBucketStats: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    if (pt_this->at_statistics == NULL)
+    {
+      (void)xc_printf ("BMM_GetBucketStats: No statistics.\n") ;
+      result = BMM_ERR_NOSTATS ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      *pt_statistics = pt_this->at_statistics[(pt_this->u16_lastBucket + u16_bucketNr) % pt_this->u16_nrOfBuckets] ;
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    // Report a bucket without samples as no load at all
+    if (pt_statistics->u24_nrOfSamples == 0)
+    {
+      pt_statistics->u24_minRate = 0 ;
+      pt_statistics->u24_maxRate = 0 ;
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_GetBucketStats
+
+
+BMM_status BMM_GetStatsRange (BMM_handle               const pt_instance,
+                              unsigned short           const u16_bucketNr,
+                              unsigned short           const u16_maxBuckets,
+                              BMM_statistics_struct  * const pat_statistics,
+                              BMM_range_struct       * const pt_range)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_GetStatsRange                                          //
+//                 - Copies the load statistics of up to u16_maxBuckets       //
+//                   closed buckets, starting at u16_bucketNr (0 = oldest),   //
+//                   like BMM_GetBucketRange does with the counts. A caller   //
+//                   that reads both compares the generations of the ranges   //
+//                   to tell whether the buckets changed in between           //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  unsigned short              u16_bucket ;
+  unsigned short              u16_index ;
+  unsigned short              u16_bucketsAgo ;
+  unsigned long               u32_baseTime ;
+  unsigned int                u24_sequence ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance    == NULL) ||
+         (pat_statistics == NULL) ||
+         (pt_range       == NULL)    )
+    {
+      (void)xc_printf ("BMM_GetStatsRange: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetStatsRange: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    if (pt_this->at_statistics == NULL)
+    {
+      (void)xc_printf ("BMM_GetStatsRange: No statistics.\n") ;
+      result = BMM_ERR_NOSTATS ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      pt_range->u16_nrOfBuckets = (pt_this->u16_firstBucket + pt_this->u16_nrOfBuckets - pt_this->u16_lastBucket) % pt_this->u16_nrOfBuckets ;
+      pt_range->u32_generation  = pt_this->u32_generation ;
+      pt_range->t_period        = pt_this->t_period ;
+      pt_range->b_statistics    = TRUE ;
+      u32_baseTime              = pt_this->u32_baseTime ;
+
+      // Limit the range to the closed buckets
+      if (u16_bucketNr >= pt_range->u16_nrOfBuckets)
+      {
+        pt_range->u16_nrCopied = 0 ;
+      }
+      else if (u16_maxBuckets > pt_range->u16_nrOfBuckets - u16_bucketNr)
+      {
+        pt_range->u16_nrCopied = pt_range->u16_nrOfBuckets - u16_bucketNr ;
+      }
+      else
+      {
+        pt_range->u16_nrCopied = u16_maxBuckets ;
+      }
+
+      u16_bucket = (pt_this->u16_lastBucket + u16_bucketNr) % pt_this->u16_nrOfBuckets ;
+      for (u16_index = 0; u16_index < pt_range->u16_nrCopied; u16_index ++)
+      {
+        pat_statistics[u16_index] = pt_this->at_statistics[u16_bucket] ;
+
+        u16_bucket ++ ;
+        if (u16_bucket >= pt_this->u16_nrOfBuckets)
+        {
+          u16_bucket = 0 ;
+        }
+      }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    for (u16_index = 0; u16_index < pt_range->u16_nrCopied; u16_index ++)
+    {
+      // Report a bucket without samples as no load at all
+      if (pat_statistics[u16_index].u24_nrOfSamples == 0)
+      {
+        pat_statistics[u16_index].u24_minRate = 0 ;
+        pat_statistics[u16_index].u24_maxRate = 0 ;
+      }
+    }
+
+    // The timestamp is derived as BMM_GetBucketRange does
+    if (pt_range->u16_nrCopied > 0)
+    {
+      u16_bucketsAgo = pt_range->u16_nrOfBuckets - u16_bucketNr ;
+      RTC_AddPeriods (pt_range->t_period, u32_baseTime, -(long)u16_bucketsAgo, &(pt_range->u32_timeStamp)) ;
+    }
+    else
+    {
+      pt_range->u32_timeStamp = u32_baseTime ;
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_GetStatsRange
+
+
+BMM_status BMM_GetMemoryUse (BMM_handle       const pt_instance,
+                             unsigned long  * const pu32_bytes)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_GetMemoryUse                                           //
+//                 - Retrieves the number of bytes allocated for an instance, //
+//                   its buckets, range indexes, statistics and archives      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_instance_struct * const pt_this = pt_instance ;
+  BMM_tier_struct     *       pt_tier ;
+  unsigned char               u8_tier ;
+  unsigned long               u32_bucketSize ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance == NULL) ||
+         (pu32_bytes  == NULL)    )
+    {
+      (void)xc_printf ("BMM_GetMemoryUse: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetMemoryUse: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    *pu32_bytes = sizeof(BMM_instance_struct) ;
+
+    for (u8_tier = 0; u8_tier < pt_this->u8_nrOfTiers; u8_tier ++)
+    {
+      pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+      u32_bucketSize = sizeof(unsigned int) ;
+      if (pt_tier->au32_pulseTotal != NULL)
+      {
+        u32_bucketSize += sizeof(unsigned long) ;
+      }
+      if (pt_tier->at_statistics != NULL)
+      {
+        u32_bucketSize += sizeof(BMM_statistics_struct) ;
+      }
+
+      *pu32_bytes += pt_tier->u16_nrOfBuckets * u32_bucketSize ;
+
+      if (pt_tier->pt_archive != NULL)
+      {
+        *pu32_bytes += sizeof(BMM_archive_struct) +
+                       pt_tier->pt_archive->u16_nrOfBlocks * sizeof(BMM_block_struct) ;
+      }
+    }
+  }
+
+  return (result) ;
+}
+// End: BMM_GetMemoryUse
+
+
+BMM_status BMM_GetArchiveUse (BMM_handle       const pt_instance,
+                              unsigned long  * const pu32_nrOfBuckets,
+                              unsigned long  * const pu32_nrOfBytes)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_GetArchiveUse                                          //
+//                 - Retrieves the number of buckets in the archive of a tier //
+//                   and the bytes they take, block headers included          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  BMM_archive_struct  *       pt_archive ;
+  unsigned int                u24_sequence ;
+  unsigned short              u16_block ;
+  unsigned short              u16_index ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance      == NULL) ||
+         (pu32_nrOfBuckets == NULL) ||
+         (pu32_nrOfBytes   == NULL)    )
+    {
+      (void)xc_printf ("BMM_GetArchiveUse: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_GetArchiveUse: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_archive = pt_this->pt_archive ;
+    if (pt_archive == NULL)
+    {
+      (void)xc_printf ("BMM_GetArchiveUse: No archive.\n") ;
+      result = BMM_ERR_NOARCHIVE ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
 
-      // Nofify the slave process about the newly fetched pulses
-      if (pt_this->t_slaveProcessId != NULL)
+      *pu32_nrOfBuckets = 0 ;
+      *pu32_nrOfBytes   = 0 ;
+      u16_block         = pt_archive->u16_firstBlock ;
+      for (u16_index = 0; u16_index < pt_archive->u16_usedBlocks; u16_index ++)
       {
-        (void)KE_MBoxSend (pt_this->t_slaveProcessId, pt_this) ;
+        *pu32_nrOfBuckets += pt_archive->at_block[u16_block].u16_nrOfBuckets ;
+        *pu32_nrOfBytes   += pt_archive->at_block[u16_block].u8_nrOfBytes + (sizeof(BMM_block_struct) - BMM_BLOCK_SIZE) ;
+
+        u16_block ++ ;
+        if (u16_block >= pt_archive->u16_nrOfBlocks)
+        {
+          u16_block = 0 ;
+        }
       }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+  }
+
+  return (result) ;
+}
+// End: BMM_GetArchiveUse
+
+
+BMM_status BMM_OpenArchive (BMM_handle                 const pt_instance,
+                            BMM_archiveReader_struct * const pt_reader)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_OpenArchive                                            //
+//                 - Positions a reader at the oldest bucket in the archive   //
+//                   of a tier                                                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     * const pt_this = pt_instance ;
+  BMM_archive_struct  *       pt_archive ;
+  unsigned int                u24_sequence ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance == NULL) ||
+         (pt_reader   == NULL)    )
+    {
+      (void)xc_printf ("BMM_OpenArchive: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
     }
   }
 
-  return ;
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    if (BMM_TIER_INVALID(pt_this))
+    {
+      (void)xc_printf ("BMM_OpenArchive: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_archive = pt_this->pt_archive ;
+    if (pt_archive == NULL)
+    {
+      (void)xc_printf ("BMM_OpenArchive: No archive.\n") ;
+      result = BMM_ERR_NOARCHIVE ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+
+      // An empty archive gets serial 0, which no block has
+      pt_reader->pt_tier           = pt_this ;
+      pt_reader->u16_block         = pt_archive->u16_firstBlock ;
+      pt_reader->u32_serial        = 0 ;
+      pt_reader->u32_timeStamp     = 0 ;
+      if (pt_archive->u16_usedBlocks > 0)
+      {
+        pt_reader->u32_serial      = pt_archive->at_block[pt_reader->u16_block].u32_serial ;
+        pt_reader->u32_timeStamp   = pt_archive->at_block[pt_reader->u16_block].u32_startTime ;
+      }
+      pt_reader->u8_position       = 0 ;
+      pt_reader->u16_bucketInBlock = 0 ;
+      pt_reader->u16_run           = 0 ;
+      pt_reader->u16_pastTokens    = 0 ;
+      pt_reader->u24_value         = 0 ;
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+  }
+
+  return (result) ;
+}
+// End: BMM_OpenArchive
+
+
+BMM_status BMM_ReadArchive (BMM_archiveReader_struct * const pt_reader,
+                            BMM_bucket               * const pt_bucketContents)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_ReadArchive                                            //
+//                 - Decodes the next bucket of an opened archive. Returns    //
+//                   BMM_ERR_END after the newest bucket (read again later    //
+//                   for more), or BMM_ERR_CHANGED if the block being read    //
+//                   was dropped meanwhile (open the archive again)           //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_status                  result  = BMM_OK ;
+  BMM_tier_struct     *       pt_this ;
+  BMM_archive_struct  *       pt_archive ;
+  BMM_block_struct    *       pt_block ;
+  BMM_archiveReader_struct    t_state ;
+  unsigned int                u24_sequence ;
+  unsigned long               u32_token ;
+  unsigned char               u8_shift ;
+  unsigned short              u16_newest ;
+
+  if (result == BMM_OK)
+  {
+    // Do parameter check
+    if ( (pt_reader         == NULL) ||
+         (pt_bucketContents == NULL)    )
+    {
+      (void)xc_printf ("BMM_ReadArchive: Parameter error.\n") ;
+      result = BMM_ERR_PARAM ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    // Check if the pointer is valid
+    pt_this = pt_reader->pt_tier ;
+    if ( (pt_this             == NULL) ||
+         (BMM_TIER_INVALID(pt_this)  ) ||
+         (pt_this->pt_archive == NULL)    )
+    {
+      (void)xc_printf ("BMM_ReadArchive: Invalid pointer.\n") ;
+      result = BMM_ERR_POINTER ;
+    }
+  }
+
+  if (result == BMM_OK)
+  {
+    pt_archive = pt_this->pt_archive ;
+
+    do
+    {
+      u24_sequence = BMM_ReadBegin (pt_this) ;
+      result       = BMM_OK ;
+      t_state      = *pt_reader ;
+
+      if ( (t_state.u32_serial         == 0) &&
+           (pt_archive->u16_usedBlocks >  0)    )
+      {
+        // The archive was empty when opened, start at its oldest block
+        t_state.u16_block     = pt_archive->u16_firstBlock ;
+        t_state.u32_serial    = pt_archive->at_block[t_state.u16_block].u32_serial ;
+        t_state.u32_timeStamp = pt_archive->at_block[t_state.u16_block].u32_startTime ;
+      }
+
+      for (;;)
+      {
+        pt_block   = &(pt_archive->at_block[t_state.u16_block]) ;
+        u16_newest = (pt_archive->u16_firstBlock + pt_archive->u16_usedBlocks - 1) % pt_archive->u16_nrOfBlocks ;
+
+        if ( (pt_archive->u16_usedBlocks == 0                ) ||
+             (pt_block->u32_serial       != t_state.u32_serial)    )
+        {
+          result = (t_state.u32_serial == 0) ? BMM_ERR_END : BMM_ERR_CHANGED ;
+          break ;
+        }
+
+        if (t_state.u16_run > 0)
+        {
+          // Continue a run
+          t_state.u16_run -- ;
+          break ;
+        }
+
+        if (t_state.u8_position < pt_block->u8_nrOfBytes)
+        {
+          // Decode the next token
+          u32_token = 0 ;
+          u8_shift  = 0 ;
+          do
+          {
+            u32_token |= (unsigned long)(pt_block->au8_token[t_state.u8_position] & 0x7F) << u8_shift ;
+            u8_shift  += 7 ;
+          } while ((pt_block->au8_token[t_state.u8_position ++] & 0x80) != 0x00) ;
+
+          if ((u32_token & BMM_TOKEN_RUN) != 0x00)
+          {
+            // Skip the part of the run already read before it was written
+            t_state.u16_run        = (u32_token >> 1) - t_state.u16_pastTokens - 1 ;
+            t_state.u16_pastTokens = 0 ;
+            if (t_state.u16_run == 0xFFFF)
+            {
+              // The whole run was read already
+              t_state.u16_run = 0 ;
+              continue ;
+            }
+          }
+          else
+          {
+            // Undo the zig-zag coding of the difference
+            u32_token >>= 1 ;
+            t_state.u24_value += (u32_token & 0x01) ? -(long)((u32_token + 1) >> 1) : (long)(u32_token >> 1) ;
+          }
+          break ;
+        }
+
+        if (t_state.u16_bucketInBlock < pt_block->u16_nrOfBuckets)
+        {
+          // The newest block ends in a run that isn't written yet
+          t_state.u16_pastTokens ++ ;
+          break ;
+        }
+
+        if (t_state.u16_block == u16_newest)
+        {
+          result = BMM_ERR_END ;
+          break ;
+        }
+
+        // Continue with the next block
+        t_state.u16_block ++ ;
+        if (t_state.u16_block >= pt_archive->u16_nrOfBlocks)
+        {
+          t_state.u16_block = 0 ;
+        }
+        t_state.u32_serial        = pt_archive->at_block[t_state.u16_block].u32_serial ;
+        t_state.u32_timeStamp     = pt_archive->at_block[t_state.u16_block].u32_startTime ;
+        t_state.u8_position       = 0 ;
+        t_state.u16_bucketInBlock = 0 ;
+        t_state.u16_pastTokens    = 0 ;
+        t_state.u24_value         = 0 ;
+      }
+    } while (BMM_ReadRetry (pt_this, u24_sequence)) ;
+
+    if (result == BMM_OK)
+    {
+      pt_bucketContents->u24_value     = t_state.u24_value ;
+      pt_bucketContents->u32_timeStamp = t_state.u32_timeStamp ;
+
+      // Move on to the next bucket
+      t_state.u16_bucketInBlock ++ ;
+      RTC_AddPeriods (pt_this->t_period, t_state.u32_timeStamp, 1, &(t_state.u32_timeStamp)) ;
+      *pt_reader = t_state ;
+    }
+  }
+
+  return (result) ;
 }
-// End: BMM_pulseProcess
+// End: BMM_ReadArchive
 
 
-static PROCESS BMM_bucketProcess (BMM_handle const pt_instance)
+////////////////////////////////////////////////////////////////////////////////
+// Local Implementations                                                      //
+////////////////////////////////////////////////////////////////////////////////
+static PROCESS BMM_Process (BMM_handle const pt_instance)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_Process                                                //
+//                 - Waits for events. A tier of this instance is a bucket    //
+//                   change event from the RTC, anything else is a new-pulse  //
+//                   event from the metering instance                         //
+////////////////////////////////////////////////////////////////////////////////
 {
   BMM_instance_struct * const pt_this = pt_instance ;
-  BMM_bucket*                 pt_tmpBucket ;
-  unsigned char               u8_index ;
+  void*                       pt_message ;
+  BMM_tier_struct     *       pt_tier ;
+  unsigned int                u24_nrOfPulses ;
+  unsigned int                u24_rate ;
+  unsigned char               u8_tier ;
+
   for (;;)
   {
-    // Wait for a new-pulse-event
-    (void)KE_MBoxReceive () ;
+    // Wait for an event
+    pt_message = KE_MBoxReceive () ;
+
+    // Check if it's a bucket change event of one of the tiers
+    for (u8_tier = 0; u8_tier < pt_this->u8_nrOfTiers; u8_tier ++)
+    {
+      if (pt_message == &(pt_this->at_tier[u8_tier]))
+      {
+        break ;
+      }
+    }
+
+    if (u8_tier < pt_this->u8_nrOfTiers)
+    {
+      BMM_ChangeBuckets (pt_this, u8_tier) ;
+    }
+    else if (pt_this->func_fetchPulses != NULL)
+    {
+      // Fetch the number of metered pulses
+      (void)pt_this->func_fetchPulses (pt_message, &u24_nrOfPulses) ;
+
+      // Fetch the load once for the statistics of all tiers. Sampling every
+      // tier directly gives the same minimum and maximum as rolling the lower
+      // tiers up, without storing anything for it
+      if (pt_this->func_fetchRate != NULL)
+      {
+        (void)pt_this->func_fetchRate (pt_message, &u24_rate) ;
+      }
+
+      // Add the pulse(s) to the current bucket of all tiers. This process is
+      // the only writer, readers retry if the sequence changed under them
+      for (u8_tier = 0; u8_tier < pt_this->u8_nrOfTiers; u8_tier ++)
+      {
+        pt_tier = &(pt_this->at_tier[u8_tier]) ;
+        pt_tier->u24_sequence ++ ;
+        pt_tier->au24_pulseCount[pt_tier->u16_firstBucket] += u24_nrOfPulses ;
+        pt_tier->u32_pulseTotal                             += u24_nrOfPulses ;
+        if ( (pt_tier->at_statistics != NULL) &&
+             (pt_this->func_fetchRate != NULL)    )
+        {
+          BMM_AddSample (&(pt_tier->at_statistics[pt_tier->u16_firstBucket]), u24_rate) ;
+        }
+        pt_tier->u24_sequence ++ ;
+      }
+    }
+  }
+
+  return ;
+}
+// End: BMM_Process
+
+
+static void BMM_ChangeBuckets (BMM_instance_struct * const pt_this,
+                               unsigned char         const u8_eventTier)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_ChangeBuckets                                          //
+//                 - Changes the bucket of the tier that got its RTC event if //
+//                   one or more new periods began, then cascades down to the //
+//                   tiers                                                    //
+//                   whose parent changed bucket. Parents come before their   //
+//                   children, so one pass over the tiers does                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_tier_struct * pt_tier ;
+  unsigned char     u8_tier ;
+  unsigned char     u8_changed = 0x00 ;                   // Bit set for each tier that changed bucket
+  unsigned long     u32_currTime ;
+  unsigned long     u32_startTime ;
+  unsigned short    u16_nrOfPeriods ;
+
+  RTC_GetTime (&u32_currTime) ;
+
+  for (u8_tier = u8_eventTier; u8_tier < pt_this->u8_nrOfTiers; u8_tier ++)
+  {
+    pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+    if ( (u8_tier == u8_eventTier) ||
+         ( (pt_tier->u8_parent != BMM_NO_PARENT                  ) &&
+           ((u8_changed & (1 << pt_tier->u8_parent)) != 0x00     )    )    )
+    {
+      // Only change the bucket if the period it belongs to has ended. If
+      // the clock was set back, keep filling the current bucket
+      RTC_AlignTime (pt_tier->t_period, u32_currTime, &u32_startTime) ;
+      if (u32_startTime > pt_tier->u32_baseTime)
+      {
+        // Count the boundaries passed since the current bucket opened; more
+        // than the ring holds would only clear it more than once
+        RTC_CountPeriods (pt_tier->t_period, pt_tier->u32_baseTime, u32_startTime, pt_tier->u16_nrOfBuckets, &u16_nrOfPeriods) ;
+
+        BMM_NextBucket (pt_tier, u32_startTime, u16_nrOfPeriods) ;
+        u8_changed |= (1 << u8_tier) ;
+      }
+    }
+  }
+
+  return ;
+}
+// End: BMM_ChangeBuckets
+
+
+static void BMM_NextBucket (BMM_tier_struct * const pt_tier,
+                            unsigned long     const u32_startTime,
+                            unsigned short    const u16_nrOfPeriods)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_NextBucket                                             //
+//                 - Closes the current bucket of a tier and moves on         //
+//                   u16_nrOfPeriods buckets. The buckets of missed periods   //
+//                   are left empty; as timestamps are derived from the start //
+//                   time of the new bucket, they all get their exact         //
+//                   boundary. Notifies the clients of the tier once          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char  u8_index ;
+  unsigned short u16_period ;
+  unsigned long  u32_timeStamp ;
 
-    KE_CriticalBegin () ;
+  pt_tier->u24_sequence ++ ;
+
+  for (u16_period = 0; u16_period < u16_nrOfPeriods; u16_period ++)
+  {
+    if (pt_tier->pt_archive != NULL)
+    {
+      // Archive the bucket being closed. The first is the one that was open,
+      // the others are the empty buckets of missed periods before the new one
+      if (u16_period == 0)
+      {
+        u32_timeStamp = pt_tier->u32_baseTime ;
+      }
+      else
+      {
+        RTC_AddPeriods (pt_tier->t_period, u32_startTime, -(long)(u16_nrOfPeriods - u16_period), &u32_timeStamp) ;
+      }
+      BMM_Archive (pt_tier->pt_archive, pt_tier->t_period, u32_timeStamp, pt_tier->au24_pulseCount[pt_tier->u16_firstBucket]) ;
+    }
 
     // Increase the queue head
-    pt_this->u16_firstBucket ++ ;
-    if (pt_this->u16_firstBucket >= pt_this->u16_nrOfBuckets)
+    pt_tier->u16_firstBucket ++ ;
+    if (pt_tier->u16_firstBucket >= pt_tier->u16_nrOfBuckets)
     {
-      pt_this->u16_firstBucket = 0 ;
+      pt_tier->u16_firstBucket = 0 ;
     }
 
     // Check for a queue overflow
-    if (pt_this->u16_firstBucket == pt_this->u16_lastBucket)
+    if (pt_tier->u16_firstBucket == pt_tier->u16_lastBucket)
     {
       // Increase the queue tail
-      pt_this->u16_lastBucket ++ ;
-      if (pt_this->u16_lastBucket >= pt_this->u16_nrOfBuckets)
+      pt_tier->u16_lastBucket ++ ;
+      if (pt_tier->u16_lastBucket >= pt_tier->u16_nrOfBuckets)
       {
-        pt_this->u16_lastBucket = 0 ;
+        pt_tier->u16_lastBucket = 0 ;
       }
     }
 
     // Empty the new bucket
-    pt_this->at_pulseBucket[pt_this->u16_firstBucket].u24_value = 0 ;
-    // Fill out the timestamp for the new bucket
-    RTC_GetTime (&(pt_this->at_pulseBucket[pt_this->u16_firstBucket].u32_timeStamp)) ;
+    pt_tier->au24_pulseCount[pt_tier->u16_firstBucket] = 0 ;
+    if (pt_tier->au32_pulseTotal != NULL)
+    {
+      pt_tier->au32_pulseTotal[pt_tier->u16_firstBucket] = pt_tier->u32_pulseTotal ;
+    }
+    if (pt_tier->at_statistics != NULL)
+    {
+      pt_tier->at_statistics[pt_tier->u16_firstBucket].u24_nrOfSamples = 0 ;
+    }
+  }
+
+  // Fill out the timestamp for the new bucket
+  pt_tier->u32_baseTime    = u32_startTime ;
+  pt_tier->u32_generation += u16_nrOfPeriods ;
+
+  pt_tier->u24_sequence ++ ;
+
+  for (u8_index = 0; u8_index < BMM_MAX_EVENTS; u8_index ++)
+  {
+    if (pt_tier->t_clientProcessId[u8_index] != NULL)
+    {
+      (void)KE_MBoxSend (pt_tier->t_clientProcessId[u8_index], pt_tier) ;
+    }
+  }
+
+  return ;
+}
+// End: BMM_NextBucket
+
+
+static void BMM_FreeTiers (BMM_instance_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_FreeTiers                                              //
+//                 - Invalidates all tiers and frees their buckets, range     //
+//                   indexes, statistics and archives                         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_tier_struct * pt_tier ;
+  unsigned char     u8_tier ;
+
+  for (u8_tier = 0; u8_tier < BMM_MAX_TIERS; u8_tier ++)
+  {
+    pt_tier = &(pt_this->at_tier[u8_tier]) ;
+
+    pt_tier->u24_signature = 0x000000 ;
+    if (pt_tier->au24_pulseCount != NULL)
+    {
+      (void)freemem (pt_tier->au24_pulseCount, pt_tier->u16_nrOfBuckets * sizeof(unsigned int)) ;
+      pt_tier->au24_pulseCount = NULL ;
+    }
+    if (pt_tier->au32_pulseTotal != NULL)
+    {
+      (void)freemem (pt_tier->au32_pulseTotal, pt_tier->u16_nrOfBuckets * sizeof(unsigned long)) ;
+      pt_tier->au32_pulseTotal = NULL ;
+    }
+    if (pt_tier->at_statistics != NULL)
+    {
+      (void)freemem (pt_tier->at_statistics, pt_tier->u16_nrOfBuckets * sizeof(BMM_statistics_struct)) ;
+      pt_tier->at_statistics = NULL ;
+    }
+    if (pt_tier->pt_archive != NULL)
+    {
+      (void)freemem (pt_tier->pt_archive->at_block, pt_tier->pt_archive->u16_nrOfBlocks * sizeof(BMM_block_struct)) ;
+      (void)freemem (pt_tier->pt_archive, sizeof(BMM_archive_struct)) ;
+      pt_tier->pt_archive = NULL ;
+    }
+  }
+
+  return ;
+}
+// End: BMM_FreeTiers
+
+
+static void BMM_AddSample (BMM_statistics_struct * const pt_statistics,
+                           unsigned int            const u24_rate)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_AddSample                                              //
+//                 - Adds a load sample to the statistics of a bucket         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  if (pt_statistics->u24_nrOfSamples == 0)
+  {
+    pt_statistics->u24_minRate = u24_rate ;
+    pt_statistics->u24_maxRate = u24_rate ;
+  }
+  else if (u24_rate < pt_statistics->u24_minRate)
+  {
+    pt_statistics->u24_minRate = u24_rate ;
+  }
+  else if (u24_rate > pt_statistics->u24_maxRate)
+  {
+    pt_statistics->u24_maxRate = u24_rate ;
+  }
+
+  pt_statistics->u24_nrOfSamples ++ ;
+
+  return ;
+}
+// End: BMM_AddSample
+
+
+static void BMM_Archive (BMM_archive_struct * const pt_archive,
+                         t_event_enum         const t_period,
+                         unsigned long        const u32_timeStamp,
+                         unsigned int         const u24_value)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_Archive                                                //
+//                 - Appends a closed bucket to an archive. Equal buckets are //
+//                   counted as a run and only written when the run ends; a   //
+//                   new block is started when a token doesn't fit, or when   //
+//                   the bucket doesn't follow on the newest one              //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_block_struct * pt_block = NULL ;
+  long               s32_difference ;
+  unsigned long      u32_token ;
+
+  if (pt_archive->u16_usedBlocks > 0)
+  {
+    pt_block = &(pt_archive->at_block[(pt_archive->u16_firstBlock + pt_archive->u16_usedBlocks - 1) % pt_archive->u16_nrOfBlocks]) ;
+  }
+
+  // Extend the run if possible
+  if ( (pt_block                  != NULL                     ) &&
+       (u32_timeStamp             == pt_archive->u32_nextTime ) &&
+       (u24_value                 == pt_archive->u24_lastValue) &&
+       (pt_archive->u16_run       <  BMM_MAX_RUN              ) &&
+       (pt_block->u8_nrOfBytes + BMM_TokenLength (((unsigned long)(pt_archive->u16_run + 1) << 1) | BMM_TOKEN_RUN) <= BMM_BLOCK_SIZE) )
+  {
+    pt_archive->u16_run ++ ;
+    pt_block->u16_nrOfBuckets ++ ;
+  }
+  else
+  {
+    // Write the pending run; its length was checked to fit when it grew
+    if ( (pt_block            != NULL) &&
+         (pt_archive->u16_run >  0   )    )
+    {
+      BMM_WriteToken (pt_block, ((unsigned long)pt_archive->u16_run << 1) | BMM_TOKEN_RUN) ;
+      pt_archive->u16_run = 0 ;
+    }
 
-    KE_CriticalEnd () ;
+    s32_difference = (long)u24_value - (long)pt_archive->u24_lastValue ;
+    u32_token      = (s32_difference >= 0) ? ((unsigned long)s32_difference << 1) : (((unsigned long)(-s32_difference) << 1) - 1) ;
+    u32_token    <<= 1 ;
 
-    for (u8_index = 0; u8_index < BMM_MAX_EVENTS; u8_index ++)
+    if ( (pt_block                                               == NULL                    ) ||
+         (u32_timeStamp                                          != pt_archive->u32_nextTime) ||
+         (pt_block->u8_nrOfBytes + BMM_TokenLength (u32_token)   >  BMM_BLOCK_SIZE          )    )
     {
-      if (pt_this->t_clientProcessId[u8_index] != NULL)
+      // Drop the oldest block if all are in use
+      if (pt_archive->u16_usedBlocks == pt_archive->u16_nrOfBlocks)
       {
-        (void)KE_MBoxSend (pt_this->t_clientProcessId[u8_index], pt_this) ;
+        pt_archive->u16_firstBlock ++ ;
+        if (pt_archive->u16_firstBlock >= pt_archive->u16_nrOfBlocks)
+        {
+          pt_archive->u16_firstBlock = 0 ;
+        }
+        pt_archive->u16_usedBlocks -- ;
       }
+
+      // Start a new block, its first bucket differs from 0
+      pt_archive->u16_usedBlocks ++ ;
+      pt_block = &(pt_archive->at_block[(pt_archive->u16_firstBlock + pt_archive->u16_usedBlocks - 1) % pt_archive->u16_nrOfBlocks]) ;
+      pt_block->u32_serial      = pt_archive->u32_nextSerial ++ ;
+      pt_block->u32_startTime   = u32_timeStamp ;
+      pt_block->u16_nrOfBuckets = 0 ;
+      pt_block->u8_nrOfBytes    = 0 ;
+
+      u32_token = (unsigned long)u24_value << 2 ;
     }
+
+    BMM_WriteToken (pt_block, u32_token) ;
+    pt_block->u16_nrOfBuckets ++ ;
+    pt_archive->u24_lastValue = u24_value ;
   }
 
+  RTC_AddPeriods (t_period, u32_timeStamp, 1, &(pt_archive->u32_nextTime)) ;
+
   return ;
 }
-// End: BMM_NextBucket
+// End: BMM_Archive
+
+
+static void BMM_WriteToken (BMM_block_struct * const pt_block,
+                            unsigned long      const u32_token)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_WriteToken                                             //
+//                 - Appends a token to a block as a varint                   //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long u32_rest = u32_token ;
+
+  while (u32_rest > 0x7F)
+  {
+    pt_block->au8_token[pt_block->u8_nrOfBytes ++] = (unsigned char)(u32_rest & 0x7F) | 0x80 ;
+    u32_rest >>= 7 ;
+  }
+  pt_block->au8_token[pt_block->u8_nrOfBytes ++] = (unsigned char)u32_rest ;
+
+  return ;
+}
+// End: BMM_WriteToken
+
+
+static unsigned char BMM_TokenLength (unsigned long const u32_token)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_TokenLength                                            //
+//                 - Returns the number of bytes of a token as a varint       //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char u8_length = 1 ;
+  unsigned long u32_rest  = u32_token ;
+
+  while (u32_rest > 0x7F)
+  {
+    u8_length ++ ;
+    u32_rest >>= 7 ;
+  }
+
+  return (u8_length) ;
+}
+// End: BMM_TokenLength
+
+
+static unsigned int BMM_ReadBegin (BMM_tier_struct const * const pt_tier)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_ReadBegin                                              //
+//                 - Returns the sequence of a tier to read under. While the  //
+//                   process is writing (odd sequence) the reader sleeps, as  //
+//                   the writer may have a lower priority                     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned int u24_sequence ;
+
+  for (;;)
+  {
+    u24_sequence = pt_tier->u24_sequence ;
+    if ((u24_sequence & 0x000001) == 0)
+    {
+      break ;
+    }
+    KE_TaskSleep100 (1) ;
+  }
+
+  return (u24_sequence) ;
+}
+// End: BMM_ReadBegin
+
+
+static BOOL BMM_ReadRetry (BMM_tier_struct const * const pt_tier,
+                           unsigned int            const u24_sequence)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       BMM_ReadRetry                                              //
+//                 - Tells if a write overlapped the read started with        //
+//                   BMM_ReadBegin, so the read must be done again            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  return (pt_tier->u24_sequence != u24_sequence) ;
+}
+// End: BMM_ReadRetry
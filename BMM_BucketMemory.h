@@ -26,6 +26,15 @@
 #define BMM_ERR_PROCESS         (-4)                  // Process allocation errord
 #define BMM_ERR_NOFREESLOT      (-5)                  // No free client slot was found
 #define BMM_ERR_NOTFOUND        (-6)                  // ProcessId not found
+#define BMM_ERR_NOINDEX         (-7)                  // Tier has no range index
+#define BMM_ERR_NOSTATS         (-8)                  // Tier has no statistics
+#define BMM_ERR_NOARCHIVE       (-9)                  // Tier has no archive
+#define BMM_ERR_END             (-10)                 // No more buckets in the archive
+#define BMM_ERR_CHANGED         (-11)                 // Archive block was dropped while reading it
+#define BMM_ERR_STARTED         (-12)                 // Instance was started already
+
+#define BMM_MAX_TIERS           (8)                   // Maximum number of resolutions per instance
+#define BMM_NO_PARENT           (0xFF)                // Tier changes bucket on its own RTC event
 
 
 // BMM types
@@ -34,33 +43,82 @@ typedef char                    BMM_status ;          // Status/Error return typ
 typedef struct
 {
   unsigned int    u24_value ;
-  unsigned long   u32_timeStamp ;
+  unsigned long   u32_timeStamp ;                     // Start of the bucket's period, derived on read
 } BMM_bucket ;
 
+typedef struct
+{
+  unsigned short  u16_nrOfBuckets ;                   // Closed buckets at the time of the copy
+  unsigned short  u16_nrCopied ;                      // Buckets copied into the buffer
+  unsigned long   u32_generation ;                    // Bucket changes since creation, at the time of the copy
+  unsigned long   u32_timeStamp ;                     // Start of the first copied bucket, or of the running one if none
+  t_event_enum    t_period ;                          // Period of each bucket
+  BOOL            b_statistics ;                      // Tier keeps load statistics (BMM_SetStatistics)
+} BMM_range_struct ;
+
+typedef struct
+{
+  unsigned int    u24_minRate ;                       // Lowest load seen in the bucket (base load)
+  unsigned int    u24_maxRate ;                       // Highest load seen in the bucket (peak load)
+  unsigned int    u24_nrOfSamples ;                   // Number of load samples taken
+} BMM_statistics_struct ;
+
+typedef struct                                        // Position of an archive reader, don't touch
+{
+  BMM_handle      pt_tier ;
+  unsigned long   u32_serial ;                        // Serial of the block being read
+  unsigned long   u32_timeStamp ;                     // Start of the next bucket
+  unsigned short  u16_block ;
+  unsigned short  u16_bucketInBlock ;
+  unsigned short  u16_run ;                           // Buckets left of the current run
+  unsigned short  u16_pastTokens ;                    // Buckets of a pending run read before it was written
+  unsigned int    u24_value ;                         // Last bucket read
+  unsigned char   u8_position ;                       // Next byte in the block
+} BMM_archiveReader_struct ;
+
+
+typedef struct
+{
+  t_event_enum    t_period ;                          // Period of each bucket
+  unsigned short  u16_nrOfBuckets ;                   // Number of buckets to retain
+  unsigned char   u8_parent ;                         // Tier that triggers the bucket change, or BMM_NO_PARENT
+} BMM_tier_desc ;
+
 
 // Define the function call type required for fetching pulses
 typedef char (*fetchFunction)(BMM_handle const pt_instance, unsigned int * const pu24_pulses) ;
 
 
 BMM_status  BMM_Create          (BMM_handle          * const ppt_instance,
-                                 unsigned short        const u16_nrOfBuckets) ;
+                                 unsigned char         const u8_nrOfTiers,
+                                 BMM_tier_desc const * const pat_tierDesc) ;
 
 BMM_status  BMM_Delete          (BMM_handle            const pt_instance) ;
 
+BMM_status  BMM_Start           (BMM_handle            const pt_instance) ;
+
 BMM_status  BMM_SetMeteringFunc (BMM_handle            const pt_instance,
                                  fetchFunction         const func_GetPulses) ;
 
+BMM_status  BMM_SetRateFunc     (BMM_handle            const pt_instance,
+                                 fetchFunction         const func_GetRate) ;
+
 BMM_status  BMM_GetMeteringProc (BMM_handle            const pt_instance,
                                  PID                 * const pt_processId) ;
 
-BMM_status  BMM_GetBucketProc   (BMM_handle            const pt_instance,
-                                 PID                 * const pt_processId) ;
+BMM_status  BMM_GetTier         (BMM_handle            const pt_instance,
+                                 unsigned char         const u8_tier,
+                                 BMM_handle          * const ppt_tier) ;
 
-BMM_status  BMM_SetSlaveProc    (BMM_handle            const pt_instance,
-                                 PID                   const pt_processId) ;
+BMM_status  BMM_SetRangeIndex   (BMM_handle            const pt_instance,
+                                 unsigned char         const u8_tier) ;
 
-BMM_status  BMM_GetPulses       (BMM_handle            const pt_instance,
-                                 unsigned int        * const pu24_pulses) ;
+BMM_status  BMM_SetStatistics   (BMM_handle            const pt_instance,
+                                 unsigned char         const u8_tier) ;
+
+BMM_status  BMM_SetArchive      (BMM_handle            const pt_instance,
+                                 unsigned char         const u8_tier,
+                                 unsigned short        const u16_nrOfBlocks) ;
 
 BMM_status  BMM_AddClient       (BMM_handle            const pt_instance,
                                  PID                   const t_clientProcId) ;
@@ -75,5 +133,46 @@ BMM_status  BMM_GetBucketCont   (BMM_handle            const pt_instance,
                                  unsigned short        const u16_bucketNr,
                                  BMM_bucket          * const pt_bucketContents) ;
 
+BMM_status  BMM_GetBucketRange  (BMM_handle            const pt_instance,
+                                 unsigned short        const u16_bucketNr,
+                                 unsigned short        const u16_maxBuckets,
+                                 unsigned int        * const pau24_values,
+                                 BMM_range_struct    * const pt_range) ;
+
+BMM_status  BMM_Resample        (BMM_handle            const pt_instance,
+                                 unsigned long         const u32_startTime,
+                                 unsigned short        const u16_factor,
+                                 unsigned short        const u16_maxBuckets,
+                                 unsigned long       * const pau32_values,
+                                 BMM_range_struct    * const pt_range) ;
+
+BMM_status  BMM_GetRangeSum     (BMM_handle            const pt_instance,
+                                 unsigned short        const u16_fromBucketNr,
+                                 unsigned short        const u16_toBucketNr,
+                                 unsigned long       * const pu32_sum) ;
+
+BMM_status  BMM_GetBucketStats  (BMM_handle            const pt_instance,
+                                 unsigned short        const u16_bucketNr,
+                                 BMM_statistics_struct * const pt_statistics) ;
+
+BMM_status  BMM_GetStatsRange   (BMM_handle            const pt_instance,
+                                 unsigned short        const u16_bucketNr,
+                                 unsigned short        const u16_maxBuckets,
+                                 BMM_statistics_struct * const pat_statistics,
+                                 BMM_range_struct    * const pt_range) ;
+
+BMM_status  BMM_GetMemoryUse    (BMM_handle            const pt_instance,
+                                 unsigned long       * const pu32_bytes) ;
+
+BMM_status  BMM_GetArchiveUse   (BMM_handle            const pt_instance,
+                                 unsigned long       * const pu32_nrOfBuckets,
+                                 unsigned long       * const pu32_nrOfBytes) ;
+
+BMM_status  BMM_OpenArchive     (BMM_handle            const pt_instance,
+                                 BMM_archiveReader_struct * const pt_reader) ;
+
+BMM_status  BMM_ReadArchive     (BMM_archiveReader_struct * const pt_reader,
+                                 BMM_bucket          * const pt_bucketContents) ;
+
 
 #endif //BMM_BUCKETMEMORY_H
@@ -9,14 +9,27 @@
 
 #define PHD_PULSEHANDLER_C
 #include <kernel.h>
-#include "PHD_PulseHandler.h"
-
 #include "TMR_Timer.h"
+#include "PHD_PulseHandler.h"
 
 #define PHD_SIGNATURE         ('PHD')
 #define PHD_MAX_EVENTS        (5)
 #define PHD_TICKS_PER_MINUTE  (60000UL)
 #define PHD_DEBOUNCE_FACTOR   (4UL)
+#define PHD_TRACK_DOWN_SHIFT  (2)                         // Low interval estimate follows shorter intervals with 1/4
+#define PHD_TRACK_UP_SHIFT    (5)                         // Low interval estimate follows longer intervals with 1/32
+#define PHD_REJECT_RUN        (4)                         // Rejections at one spacing that reset the low interval estimate
+#define PHD_SPACING_SHIFT     (3)                         // Spacings within 1/8 of each other are the same
+#define PHD_US_PER_SECOND     (1000000UL)
+#define PHD_SLOTS_PER_MINUTE  (60)                        // Number of one-second slots in the sliding window
+#define PHD_SLOTS_PER_HOUR    (60)                        // Number of one-minute slots in the sliding window
+#define PHD_SECS_PER_MINUTE   (60)
+#define PHD_SECS_PER_HOUR     (3600)
+#define PHD_TICKS_PER_SLEEP   (10)                        // Timer ticks per unit of KE_TaskSleep100
+#define PHD_US_PER_HOUR       (3600000000UL)
+#define PHD_IPI_MAX           (PHD_US_PER_HOUR)           // Longest interval taken into account, in us
+#define PHD_RATE_FILTER       (1)                         // Default filter: Weight of a new interval is 1/2
+#define PHD_MAX_RATE_FILTER   (7)                         // Weakest filter weight allowed is 1/128
 
 #define PHD_PTR_INVALID(p)    (p->u24_signature != PHD_SIGNATURE)
 
@@ -24,142 +37,299 @@
 // Global Data                                                                //
 ////////////////////////////////////////////////////////////////////////////////
 
+typedef struct
+{
+  unsigned short      u16_seconds ;                         // Length of the window, 0 if unused
+  unsigned char       u8_nrOfSlots ;                        // Length of the window in slots
+  BOOL                b_minuteSlots ;                       // Window is built from minute slots
+  unsigned int        u24_sum ;                             // Running sum of the slots in the window
+} PHD_window_struct ;
+
 typedef struct
 {
   unsigned int        u24_signature ;
   PID                 pt_storageProcId ;
   PID                 pt_displayProcId[PHD_MAX_EVENTS] ;
-  unsigned long       u32_debounceTime ;
-  TMR_ticks_struct    u32_debounceTimeOut ;
-  unsigned int        u24_pulses ;
-  unsigned int        u24_pulsesSend ;
+  unsigned long       u32_debounceTime ;                    // Minimum time between accepted pulses, in us
+  unsigned long       u32_fixedDebounce ;                   // Debounce time derived from the maximum pulse rate
+  BOOL                b_adaptiveDebounce ;                  // Debounce time follows the observed intervals
+  unsigned long       u32_debounceMin ;                     // Lower bound of the adaptive debounce time, in us
+  unsigned long       u32_debounceMax ;                     // Upper bound of the adaptive debounce time, in us
+  unsigned long       u32_lowInterval ;                     // Estimate of the shortest plausible interval, in us (ISR)
+  TMR_micro_struct    t_lastPlausible ;                     // Time stamp of the last pulse which was no bounce (ISR)
+  unsigned long       u32_rejectSpacing ;                   // Spacing of the running series of rejections, in us (ISR)
+  unsigned char       u8_rejectRun ;                        // Rejections at that spacing in a row (ISR)
   unsigned int        u24_pulsesPerMinute ;
-  unsigned short      u16_pulseQueueSize ;
-  unsigned short      u16_pulseQueueHead ;
-  unsigned short      u16_pulseQueueTail ;
-  TMR_ticks_struct*   at_pulseQueue ;
-  PID                 t_processId ;
+  unsigned int        u24_pulseTotal ;                      // Free running pulse counter (ISR)
+  unsigned int        u24_pulseTotalSend ;                  // Free running pulse counter last notified to storage
+  unsigned int        u24_pulseTotalFetched ;               // Free running pulse counter last fetched by storage
+  unsigned int        u24_pulseTotalSecond ;                // Free running pulse counter at the start of the second
+  unsigned short      au16_secondSlot[PHD_SLOTS_PER_MINUTE] ; // Pulses per second of the last minute
+  unsigned char       u8_oldestSlot ;                       // Slot to be overwritten by the next second
+  unsigned int        u24_windowSum ;                       // Running sum of all second slots
+  unsigned int        au24_minuteSlot[PHD_SLOTS_PER_HOUR] ; // Pulses per minute of the last hour
+  unsigned char       u8_oldestMinute ;                     // Minute slot to be overwritten by the next minute
+  unsigned char       u8_secondsInMinute ;                  // Seconds closed in the running minute
+  unsigned int        u24_minutePulses ;                    // Pulses of the seconds closed in the running minute
+  PHD_window_struct   at_window[PHD_MAX_WINDOWS] ;          // Configured averaging windows
+  TMR_ticks_struct    t_nextSecond ;                        // Timeout at which the running second closes
+  TMR_micro_struct    t_lastPulse ;                         // Time stamp of the last accepted pulse, in us (ISR)
+  unsigned long       u32_avgInterval ;                     // Filtered pulse interval, in us (ISR)
+  unsigned char       u8_rateFilter ;                       // Weight of a new interval is 1/2^u8_rateFilter
+  unsigned char       u8_intervalSeq ;                      // Increased by the ISR on each update of its data
+  BOOL                b_lastPulseValid ;                    // The last pulse time stamp is valid
+  unsigned long       u32_accepted ;                        // Accepted pulses (ISR)
+  unsigned long       u32_rejected ;                        // Pulses rejected by the debouncer (ISR)
+  unsigned long       u32_minInterval ;                     // Shortest accepted interval, in us (ISR)
+  unsigned long       u32_maxInterval ;                     // Longest accepted interval, in us (ISR)
+  unsigned int        u24_overflows ;                       // Seconds with more pulses than a slot holds
+  unsigned int        u24_pulsesPerHour ;                   // Last published interval based rate
+  BOOL                b_simulated ;                         // Seconds are closed by PHD_AdvanceTime, not the process
+  TMR_micro_struct    t_simNextSecond ;                     // Simulated time at which the running second closes
 } PHD_instance_struct ;
 
+static PHD_instance_struct * pt_channel      = NULL ;    // Contiguous array of all channels
+static unsigned char         u8_nrOfChannels = 0 ;
+static PID                   t_processId ;
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Local Prototypes                                                           //
 ////////////////////////////////////////////////////////////////////////////////
 
-static PROCESS PHD_Process (PHD_handle const pt_instance) ;
+static PROCESS       PHD_Process       (void) ;
+static PHD_status    PHD_TakePulse     (PHD_instance_struct       * const pt_this,
+                                        TMR_micro_struct    const * const pt_pulseTime) ;
+static unsigned long PHD_ServiceChannel(PHD_instance_struct       * const pt_this) ;
+static unsigned int  PHD_IntervalRate  (PHD_instance_struct const * const pt_this) ;
+static void          PHD_CloseRunning  (PHD_instance_struct       * const pt_this) ;
+static void          PHD_AdaptDebounce (PHD_instance_struct       * const pt_this,
+                                        TMR_micro_struct    const * const pt_pulseTime,
+                                        unsigned long               const u32_interval,
+                                        BOOL                        const b_rejected) ;
+static void          PHD_CloseSecond   (PHD_instance_struct       * const pt_this,
+                                        unsigned short              const u16_closedPulses) ;
+static void          PHD_CloseMinute   (PHD_instance_struct       * const pt_this) ;
+static void          PHD_ClearWindows  (PHD_instance_struct       * const pt_this) ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global Implementations                                                     //
 ////////////////////////////////////////////////////////////////////////////////
 
-PHD_status PHD_Create (PHD_handle          * const ppt_instance,
-                       unsigned short        const u16_maxPulsesPerMinute)
+PHD_status PHD_Initialize (unsigned char const u8_channels)
 ////////////////////////////////////////////////////////////////////////////////
-// Function:       Pulse handler construction routine                         //
-//                 - Creates an instance                                      //
-// History :       24 Jul 2004 by R. Delien:                                  //
-//                 - Initial revision.                                        //
+// Function:       Pulse handler initialisation routine                       //
+//                 - Allocates the state of all channels and creates the one  //
+//                   process which services them                              //
 ////////////////////////////////////////////////////////////////////////////////
 {
-  PHD_status            result      = PHD_OK ;
-  PHD_instance_struct * pt_this ;
+  PHD_status    result = PHD_OK ;
+  unsigned char u8_index ;
 
   if (result == PHD_OK)
   {
     // Do parameter check
-    if (ppt_instance == NULL)
+    if ( (u8_channels == 0               ) ||
+         (u8_channels >  PHD_MAX_CHANNELS) ||
+         (pt_channel  != NULL            )    )
     {
-      (void)xc_printf ("PHD_Create: Parameter error.\n") ;
+      (void)xc_printf ("PHD_Initialize: Parameter error.\n") ;
       result = PHD_ERR_PARAM ;
     }
   }
 
   if (result == PHD_OK)
   {
-    // Allocate memory for this instance
-    pt_this = getmem (sizeof(PHD_instance_struct)) ;
-    if (pt_this == NULL)
+    // Allocate memory for all channels
+    pt_channel = getmem (u8_channels * sizeof(PHD_instance_struct)) ;
+    if (pt_channel == NULL)
     {
-      (void)xc_printf ("PHD_Create: Memory error (instance).\n") ;
+      (void)xc_printf ("PHD_Initialize: Memory error.\n") ;
       result = PHD_ERR_MEMORY ;
     }
   }
 
   if (result == PHD_OK)
   {
-    unsigned char u8_index ;
-
-    // Initialize global variables of this instance
-    pt_this->u24_signature        = PHD_SIGNATURE ;
-    pt_this->pt_storageProcId     = NULL ;
-    pt_this->u32_debounceTime     = (PHD_TICKS_PER_MINUTE / u16_maxPulsesPerMinute) / PHD_DEBOUNCE_FACTOR ;
-    pt_this->u24_pulses           = 0 ;
-    pt_this->u24_pulsesSend       = 0 ;
-    pt_this->u24_pulsesPerMinute  = 0 ;
-    pt_this->u16_pulseQueueSize   = u16_maxPulsesPerMinute + 1 ;
-    pt_this->u16_pulseQueueHead   = 0 ;
-    pt_this->u16_pulseQueueTail   = 0 ;
-    TMR_SetTimeout (&(pt_this->u32_debounceTimeOut), 0) ;
-
-    // Clear all events
-    for (u8_index = 0; u8_index < PHD_MAX_EVENTS; u8_index ++)
+    // Mark all channels unused
+    for (u8_index = 0; u8_index < u8_channels; u8_index ++)
     {
-      pt_this->pt_displayProcId[u8_index] = NULL ;
+      pt_channel[u8_index].u24_signature = 0x000000 ;
     }
+    u8_nrOfChannels = u8_channels ;
+
+    // Create the process
+    t_processId = KE_TaskCreate ( (procptr)PHD_Process, // Function
+                                  256,                  // Stack size
+                                  10,                   // Priority
+                                  "PHD_Process",        // Name
+                                  0 ) ;                 // Number of arguments
 
-    // Allocate memory pulse ages
-    pt_this->at_pulseQueue = getmem (pt_this->u16_pulseQueueSize * sizeof(TMR_ticks_struct)) ;
-    if (pt_this->at_pulseQueue == NULL)
+    if (t_processId == 0)
     {
       // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)freemem (pt_this, sizeof(PHD_instance_struct)) ;
+      (void)freemem (pt_channel, u8_nrOfChannels * sizeof(PHD_instance_struct)) ;
+      pt_channel      = NULL ;
+      u8_nrOfChannels = 0 ;
 
-      (void)xc_printf ("PHD_Create: Memory error (ages).\n") ;
-      result = PHD_ERR_MEMORY ;
+      (void)xc_printf ("PHD_Initialize: Process error (create).\n") ;
+      result = PHD_ERR_PROCESS ;
     }
   }
 
   if (result == PHD_OK)
   {
-    // Create the instance task
-    pt_this->t_processId = KE_TaskCreate ( (procptr)PHD_Process,  // Function
-                                           256,                   // Stack size
-                                           10,                    // Priority
-                                           "PHD_Process",         // Name
-                                           1,                     // Number of arguments
-                                           pt_this ) ;            // Arg...
-
-    if (pt_this->t_processId == 0)
+    if ( KE_TaskResume(t_processId) == SYSERR)
     {
       // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)freemem (pt_this->at_pulseQueue, pt_this->u16_pulseQueueSize * sizeof(TMR_ticks_struct)) ;
-      (void)freemem (pt_this, sizeof(PHD_instance_struct)) ;
+      (void)KE_TaskDelete (t_processId) ;
+      (void)freemem (pt_channel, u8_nrOfChannels * sizeof(PHD_instance_struct)) ;
+      pt_channel      = NULL ;
+      u8_nrOfChannels = 0 ;
 
-      (void)xc_printf ("PHD_Create: Process error (create).\n") ;
+      (void)xc_printf ("PHD_Initialize: Process error (resume).\n") ;
       result = PHD_ERR_PROCESS ;
     }
   }
 
+  return (result) ;
+}
+// End: PHD_Initialize
+
+
+PHD_status PHD_Terminate (void)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       Pulse handler termination routine                          //
+//                 - Kills the process and frees the state of all channels    //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char u8_index ;
+
+  if (pt_channel != NULL)
+  {
+    // Kill the task
+    (void)KE_TaskDelete (t_processId) ;
+
+    // Invalidate all handles
+    for (u8_index = 0; u8_index < u8_nrOfChannels; u8_index ++)
+    {
+      pt_channel[u8_index].u24_signature = 0x000000 ;
+    }
+
+    // Return the memory to the memory manager
+    (void)freemem (pt_channel, u8_nrOfChannels * sizeof(PHD_instance_struct)) ;
+    pt_channel      = NULL ;
+    u8_nrOfChannels = 0 ;
+  }
+
+  return (PHD_OK) ;
+}
+// End: PHD_Terminate
+
+
+PHD_status PHD_Create (PHD_handle          * const ppt_instance,
+                       unsigned char         const u8_channelNr,
+                       unsigned short        const u16_maxPulsesPerMinute)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       Pulse handler construction routine                         //
+//                 - Creates an instance                                      //
+//                 - Claims a channel of the pulse handler process            //
+// History :       24 Jul 2004 by R. Delien:                                  //
+//                 - Initial revision.                                        //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status            result      = PHD_OK ;
+  PHD_instance_struct * pt_this ;
+
   if (result == PHD_OK)
   {
-    if ( KE_TaskResume(pt_this->t_processId) == SYSERR)
+    // Check if the module is initialized
+    if (pt_channel == NULL)
     {
-      // Clean up
-      pt_this->u24_signature = 0x000000 ;
-      (void)KE_TaskDelete (pt_this->t_processId) ;
-      (void)freemem (pt_this->at_pulseQueue, pt_this->u16_pulseQueueSize * sizeof(TMR_ticks_struct)) ;
-      (void)freemem (pt_this, sizeof(PHD_instance_struct)) ;
+      (void)xc_printf ("PHD_Create: Not initialized.\n") ;
+      result = PHD_ERR_NOTINIT ;
+    }
+  }
 
-      (void)xc_printf ("PHD_Create: Process error (resume).\n") ;
-      result = PHD_ERR_PROCESS ;
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (ppt_instance           == NULL           ) ||
+         (u8_channelNr           >= u8_nrOfChannels) ||
+         (u16_maxPulsesPerMinute == 0              )    )
+    {
+      (void)xc_printf ("PHD_Create: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Claim the channel
+    pt_this = &(pt_channel[u8_channelNr]) ;
+    if (!PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_Create: Channel in use.\n") ;
+      result = PHD_ERR_NOFREESLOT ;
     }
   }
 
   if (result == PHD_OK)
   {
+    unsigned char u8_index ;
+
+    // Initialize global variables of this instance
+    pt_this->pt_storageProcId      = NULL ;
+    pt_this->u32_fixedDebounce     = ((PHD_TICKS_PER_MINUTE / u16_maxPulsesPerMinute) / PHD_DEBOUNCE_FACTOR) * TMR_US_PER_MS ;
+    pt_this->u32_debounceTime      = pt_this->u32_fixedDebounce ;
+    pt_this->b_adaptiveDebounce    = FALSE ;
+    pt_this->u24_pulsesPerMinute   = 0 ;
+    pt_this->u24_pulseTotal        = 0 ;
+    pt_this->u24_pulseTotalSend    = 0 ;
+    pt_this->u24_pulseTotalFetched = 0 ;
+    pt_this->u24_pulseTotalSecond  = 0 ;
+    pt_this->u32_avgInterval       = 0 ;
+    pt_this->u8_rateFilter         = PHD_RATE_FILTER ;
+    pt_this->u8_intervalSeq        = 0 ;
+    pt_this->b_lastPulseValid      = FALSE ;
+    pt_this->u32_accepted          = 0 ;
+    pt_this->u32_rejected          = 0 ;
+    pt_this->u32_minInterval       = 0xFFFFFFFF ;
+    pt_this->u32_maxInterval       = 0 ;
+    pt_this->u24_overflows         = 0 ;
+    pt_this->u24_pulsesPerHour     = 0 ;
+    pt_this->b_simulated           = FALSE ;
+    TMR_SetTimeout (&(pt_this->t_nextSecond), TMR_SECOND) ;
+
+    // Clear all events
+    for (u8_index = 0; u8_index < PHD_MAX_EVENTS; u8_index ++)
+    {
+      pt_this->pt_displayProcId[u8_index] = NULL ;
+    }
+
+    // Set up the default averaging windows, then empty all slots
+    for (u8_index = 0; u8_index < PHD_MAX_WINDOWS; u8_index ++)
+    {
+      pt_this->at_window[u8_index].u16_seconds = 0 ;
+    }
+    pt_this->at_window[0].u16_seconds   = PHD_WINDOW_FAST ;
+    pt_this->at_window[0].u8_nrOfSlots  = PHD_WINDOW_FAST ;
+    pt_this->at_window[0].b_minuteSlots = FALSE ;
+    pt_this->at_window[1].u16_seconds   = PHD_WINDOW_SHORT ;
+    pt_this->at_window[1].u8_nrOfSlots  = PHD_WINDOW_SHORT ;
+    pt_this->at_window[1].b_minuteSlots = FALSE ;
+    pt_this->at_window[2].u16_seconds   = PHD_WINDOW_MINUTE ;
+    pt_this->at_window[2].u8_nrOfSlots  = PHD_WINDOW_MINUTE ;
+    pt_this->at_window[2].b_minuteSlots = FALSE ;
+    pt_this->at_window[3].u16_seconds   = PHD_WINDOW_DEMAND ;
+    pt_this->at_window[3].u8_nrOfSlots  = PHD_WINDOW_DEMAND / PHD_SECS_PER_MINUTE ;
+    pt_this->at_window[3].b_minuteSlots = TRUE ;
+    PHD_ClearWindows (pt_this) ;
+
+    // Hand the channel to the process; it is serviced from now on
+    pt_this->u24_signature = PHD_SIGNATURE ;
+
     // Fill out the instance pointer
     *ppt_instance = pt_this ;
   }
@@ -202,15 +372,8 @@ PHD_status PHD_Delete (PHD_handle const pt_instance)
 
   if (result == PHD_OK)
   {
-    // Kill the task
-    (void)KE_TaskDelete (pt_this->t_processId) ;
-
-    // Invalidate the pointer
+    // Invalidate the pointer; this also releases the channel
     pt_this->u24_signature = 0x000000 ;
-
-    // Return the memory to the memory manager
-    (void)freemem (pt_this->at_pulseQueue, (pt_this->u16_pulseQueueSize) * sizeof(TMR_ticks_struct)) ;
-    (void)freemem (pt_this, sizeof(PHD_instance_struct)) ;
   }
 
   return (result) ;
@@ -250,6 +413,17 @@ PHD_status PHD_SetStorageClient (PHD_handle const pt_instance,
     }
   }
 
+  if (result == PHD_OK)
+  {
+    // Simulated pulses must never reach storage
+    if ( (pt_this->b_simulated != FALSE) &&
+         (t_clientProcId       != NULL )    )
+    {
+      (void)xc_printf ("PHD_SetStorageClient: Instance simulated.\n") ;
+      result = PHD_ERR_BUSY ;
+    }
+  }
+
   if (result == PHD_OK)
   {
     pt_this->pt_storageProcId = t_clientProcId ;
@@ -267,6 +441,27 @@ PHD_status PHD_HandlePulse (PHD_handle const pt_instance)
 // History :       24 Jul 2004 by R. Delien:                                  //
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
+{
+  TMR_micro_struct t_now ;
+
+  // Time stamp this pulse first, for highest accuracy
+  TMR_SetMicroStampIsr (&t_now) ;
+
+  return (PHD_HandlePulseIsr (pt_instance, &t_now)) ;
+}
+// End: PHD_HandlePulse
+
+
+PHD_status PHD_HandlePulseIsr (PHD_handle               const pt_instance,
+                               TMR_micro_struct const * const pt_pulseTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_HandlePulseIsr                                         //
+//                 - Process an incomming pulse, time stamped by the caller   //
+//                   with TMR_SetMicroStampIsr (INTERRUPT CONTEXT!)           //
+//                 - A simulated instance refuses it with PHD_ERR_BUSY, so a  //
+//                   live pulse never mixes with a replay                     //
+//                 - Returns PHD_ERR_DEBOUNCE if the pulse was rejected       //
+////////////////////////////////////////////////////////////////////////////////
 {
   PHD_status                  result  = PHD_OK ;
   PHD_instance_struct * const pt_this = pt_instance ;
@@ -274,9 +469,10 @@ PHD_status PHD_HandlePulse (PHD_handle const pt_instance)
   if (result == PHD_OK)
   {
     // Do parameter check
-    if (pt_instance == NULL)
+    if ( (pt_instance  == NULL) ||
+         (pt_pulseTime == NULL)    )
     {
-      (void)xc_printf ("PHD_HandlePulse: Parameter error.\n") ;
+      (void)xc_printf ("PHD_HandlePulseIsr: Parameter error.\n") ;
       result = PHD_ERR_PARAM ;
     }
   }
@@ -286,48 +482,250 @@ PHD_status PHD_HandlePulse (PHD_handle const pt_instance)
     // Check if the pointer is valid
     if (PHD_PTR_INVALID(pt_this))
     {
-      (void)xc_printf ("PHD_HandlePulse: Invalid pointer.\n") ;
+      (void)xc_printf ("PHD_HandlePulseIsr: Invalid pointer.\n") ;
       result = PHD_ERR_POINTER ;
     }
   }
 
   if (result == PHD_OK)
   {
-    // Debounce the pulse
-    if ( TMR_CheckTimeout(&(pt_this->u32_debounceTimeOut)) )
+    // Simulated instances only take pulses from PHD_HandlePulseAt
+    if (pt_this->b_simulated != FALSE)
     {
-      // Add a time stamp to the queue for this pulse
-      TMR_SetTimeStamp (&(pt_this->at_pulseQueue[pt_this->u16_pulseQueueHead])) ;
+      result = PHD_ERR_BUSY ;
+    }
+  }
 
-      // Set new debounce timeout
-      TMR_SetTimeout (&(pt_this->u32_debounceTimeOut), pt_this->u32_debounceTime) ;
+  if (result == PHD_OK)
+  {
+    result = PHD_TakePulse (pt_this, pt_pulseTime) ;
+  }
 
-      // Increase the pulse buffer ;
-      pt_this->u24_pulses ++ ;
+  return (result) ;
+}
+// End: PHD_HandlePulseIsr
 
-      // Increase the queue head
-      pt_this->u16_pulseQueueHead ++ ;
-      if (pt_this->u16_pulseQueueHead >= pt_this->u16_pulseQueueSize)
-      {
-        pt_this->u16_pulseQueueHead = 0 ;
-      }
 
-      // Check for a queue overflow
-      if (pt_this->u16_pulseQueueHead == pt_this->u16_pulseQueueTail)
-      {
-        // Increase the queue tail
-        pt_this->u16_pulseQueueTail ++ ;
-        if (pt_this->u16_pulseQueueTail >= pt_this->u16_pulseQueueSize)
-        {
-          pt_this->u16_pulseQueueTail = 0 ;
-        }
-      }
+PHD_status PHD_HandlePulseAt (PHD_handle               const pt_instance,
+                              TMR_micro_struct const * const pt_pulseTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_HandlePulseAt                                          //
+//                 - Process a simulated pulse which came in at the given     //
+//                   time. Only a simulated instance takes it, so nothing but //
+//                   the interrupt feeds a live one                           //
+//                 - Returns PHD_ERR_DEBOUNCE if the pulse was rejected       //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance  == NULL) ||
+         (pt_pulseTime == NULL)    )
+    {
+      (void)xc_printf ("PHD_HandlePulseAt: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if ( (PHD_PTR_INVALID(pt_this)     ) ||
+         (pt_this->b_simulated == FALSE)    )
+    {
+      (void)xc_printf ("PHD_HandlePulseAt: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
     }
   }
 
+  if (result == PHD_OK)
+  {
+    result = PHD_TakePulse (pt_this, pt_pulseTime) ;
+  }
+
   return (result) ;
 }
-// End: PHD_HandlePulse
+// End: PHD_HandlePulseAt
+
+
+PHD_status PHD_SetSimulated (PHD_handle               const pt_instance,
+                             TMR_micro_struct const * const pt_startTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_SetSimulated                                           //
+//                 - Run an instance on a simulated clock, starting at the    //
+//                   given time. From now on its seconds are only closed by   //
+//                   PHD_AdvanceTime, and its pulses must come in through     //
+//                   PHD_HandlePulseAt                                        //
+//                 - Only for a scratch instance: one with a storage client   //
+//                   is refused, so a replay never ends up in the buckets     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance  == NULL) ||
+         (pt_startTime == NULL)    )
+    {
+      (void)xc_printf ("PHD_SetSimulated: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_SetSimulated: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Simulated pulses must never reach storage
+    if (pt_this->pt_storageProcId != NULL)
+    {
+      (void)xc_printf ("PHD_SetSimulated: Instance has a storage client.\n") ;
+      result = PHD_ERR_BUSY ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Stop the process from closing seconds first
+    pt_this->b_simulated      = TRUE ;
+    pt_this->t_simNextSecond  = *pt_startTime ;
+    TMR_PostponeMicroStamp (&(pt_this->t_simNextSecond), PHD_US_PER_SECOND) ;
+    pt_this->b_lastPulseValid = FALSE ;
+    pt_this->u32_avgInterval  = 0 ;
+    pt_this->u8_intervalSeq ++ ;
+  }
+
+  return (result) ;
+}
+// End: PHD_SetSimulated
+
+
+PHD_status PHD_AdvanceTime (PHD_handle               const pt_instance,
+                            TMR_micro_struct const * const pt_currentTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_AdvanceTime                                            //
+//                 - Advance the simulated clock of an instance, closing all  //
+//                   seconds which have passed                                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+  unsigned char               u8_closedSeconds ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance    == NULL) ||
+         (pt_currentTime == NULL)    )
+    {
+      (void)xc_printf ("PHD_AdvanceTime: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if ( (PHD_PTR_INVALID(pt_this)     ) ||
+         (pt_this->b_simulated == FALSE)    )
+    {
+      (void)xc_printf ("PHD_AdvanceTime: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Close every second that has passed, but never more than one window
+    u8_closedSeconds = 0 ;
+    while ( (TMR_MicroStampDiff (&(pt_this->t_simNextSecond), pt_currentTime) == 0) &&
+            (u8_closedSeconds < PHD_SLOTS_PER_MINUTE                              )    )
+    {
+      PHD_CloseRunning (pt_this) ;
+      TMR_PostponeMicroStamp (&(pt_this->t_simNextSecond), PHD_US_PER_SECOND) ;
+      u8_closedSeconds ++ ;
+    }
+
+    // Resynchronize if more than a whole window has passed
+    if (u8_closedSeconds >= PHD_SLOTS_PER_MINUTE)
+    {
+      pt_this->t_simNextSecond = *pt_currentTime ;
+      TMR_PostponeMicroStamp (&(pt_this->t_simNextSecond), PHD_US_PER_SECOND) ;
+    }
+  }
+
+  return (result) ;
+}
+// End: PHD_AdvanceTime
+
+
+PHD_status PHD_SetRealTime (PHD_handle const pt_instance)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_SetRealTime                                            //
+//                 - Put a simulated instance back on the real clock. The     //
+//                   windows restart empty, so no simulated pulse is left in  //
+//                   its rates                                                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if (pt_instance == NULL)
+    {
+      (void)xc_printf ("PHD_SetRealTime: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if ( (PHD_PTR_INVALID(pt_this)     ) ||
+         (pt_this->b_simulated == FALSE)    )
+    {
+      (void)xc_printf ("PHD_SetRealTime: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Begin of critical region: No pulse may come in meanwhile
+    KE_CriticalBegin () ;
+
+    PHD_ClearWindows (pt_this) ;
+    pt_this->u24_pulseTotalSecond = pt_this->u24_pulseTotal ;
+    pt_this->b_lastPulseValid     = FALSE ;
+    pt_this->u32_avgInterval      = 0 ;
+    pt_this->u8_intervalSeq ++ ;
+    TMR_SetTimeout (&(pt_this->t_nextSecond), TMR_SECOND) ;
+
+    // Hand the seconds back to the process last
+    pt_this->b_simulated          = FALSE ;
+
+    // End of critical region
+    KE_CriticalEnd () ;
+  }
+
+  return (result) ;
+}
+// End: PHD_SetRealTime
 
 
 PHD_status PHD_AddClient (PHD_handle const pt_instance,
@@ -466,8 +864,8 @@ PHD_status PHD_GetPulsesPerMinute (PHD_handle     const pt_instance,
 
   if (result == PHD_OK)
   {
-    // Fill out the current number of pulses
-    *pu24_pulsesPerMinute = pt_this->u24_pulsesPerMinute ;
+    // Fill out the current number of pulses, from the running sum of the window
+    *pu24_pulsesPerMinute = pt_this->u24_windowSum ;
   }
 
   return (result) ;
@@ -475,17 +873,373 @@ PHD_status PHD_GetPulsesPerMinute (PHD_handle     const pt_instance,
 // End: PHD_GetPulsesPerMinute
 
 
-PHD_status  PHD_GetPulses (PHD_handle            const pt_instance,
+PHD_status PHD_GetPulsesPerHour (PHD_handle     const pt_instance,
+                                 unsigned int * const pu24_pulsesPerHour)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_GetPulsesPerHour                                       //
+//                 - Retrieve the current rate, derived from the filtered     //
+//                   interval between the most recent pulses. Reacts within   //
+//                   one or two pulses, where PHD_GetPulsesPerMinute takes a  //
+//                   whole minute.                                            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance        == NULL) ||
+         (pu24_pulsesPerHour == NULL)    )
+    {
+      (void)xc_printf ("PHD_GetPulsesPerHour: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_GetPulsesPerHour: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Fill out the current rate
+    *pu24_pulsesPerHour = PHD_IntervalRate (pt_this) ;
+  }
+
+  return (result) ;
+}
+// End: PHD_GetPulsesPerHour
+
+
+PHD_status PHD_SetRateFilter (PHD_handle    const pt_instance,
+                              unsigned char const u8_rateFilter)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_SetRateFilter                                          //
+//                 - Set the weight of a new pulse interval in the filtered   //
+//                   interval to 1/2^u8_rateFilter. 0 uses the last interval  //
+//                   only, higher values average over more pulses.            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance   == NULL               ) ||
+         (u8_rateFilter >  PHD_MAX_RATE_FILTER)    )
+    {
+      (void)xc_printf ("PHD_SetRateFilter: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_SetRateFilter: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    pt_this->u8_rateFilter = u8_rateFilter ;
+  }
+
+  return (result) ;
+}
+// End: PHD_SetRateFilter
+
+
+PHD_status PHD_SetAdaptiveDebounce (PHD_handle    const pt_instance,
+                                    unsigned long const u32_minDebounce,
+                                    unsigned long const u32_maxDebounce)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_SetAdaptiveDebounce                                    //
+//                 - Let the debounce time follow a quarter of the shortest   //
+//                   plausible pulse interval, within the given bounds in us  //
+//                 - Both bounds 0 return to the fixed debounce time derived  //
+//                   from the maximum pulse rate                              //
+//                 - The lower bound must exceed the bounces of the sensor.   //
+//                   The upper bound may exceed the fixed debounce time, for  //
+//                   a sensor which chatters longer at low rates              //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+  unsigned long               u32_debounceTime ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance     == NULL           ) ||
+         (u32_minDebounce >  u32_maxDebounce)    )
+    {
+      (void)xc_printf ("PHD_SetAdaptiveDebounce: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_SetAdaptiveDebounce: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Start from the fixed debounce time, within the bounds
+    u32_debounceTime = pt_this->u32_fixedDebounce ;
+    if (u32_debounceTime > u32_maxDebounce)
+    {
+      u32_debounceTime = u32_maxDebounce ;
+    }
+    if (u32_debounceTime < u32_minDebounce)
+    {
+      u32_debounceTime = u32_minDebounce ;
+    }
+
+    // Begin of critical region: The ISR must not adapt meanwhile
+    KE_CriticalBegin () ;
+
+    if (u32_maxDebounce == 0)
+    {
+      pt_this->b_adaptiveDebounce = FALSE ;
+      pt_this->u32_debounceTime   = pt_this->u32_fixedDebounce ;
+    }
+    else
+    {
+      pt_this->u32_debounceMin    = u32_minDebounce ;
+      pt_this->u32_debounceMax    = u32_maxDebounce ;
+      pt_this->u32_lowInterval    = u32_debounceTime * PHD_DEBOUNCE_FACTOR ;
+      pt_this->u32_debounceTime   = u32_debounceTime ;
+      pt_this->t_lastPlausible    = pt_this->t_lastPulse ;
+      pt_this->u32_rejectSpacing  = 0 ;
+      pt_this->u8_rejectRun       = 0 ;
+      pt_this->b_adaptiveDebounce = TRUE ;
+    }
+
+    // End of critical region
+    KE_CriticalEnd () ;
+  }
+
+  return (result) ;
+}
+// End: PHD_SetAdaptiveDebounce
+
+
+PHD_status PHD_SetWindow (PHD_handle     const pt_instance,
+                          unsigned char  const u8_window,
+                          unsigned short const u16_seconds)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_SetWindow                                              //
+//                 - Set the length of an averaging window. Up to a minute,   //
+//                   any number of seconds is allowed. Longer windows must be //
+//                   whole minutes, up to an hour. 0 disables the window.     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+  PHD_window_struct   *       pt_window ;
+  unsigned char               u8_slot ;
+  unsigned char               u8_index ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance == NULL                                  ) ||
+         (u8_window   >= PHD_MAX_WINDOWS                       ) ||
+         (u16_seconds >  PHD_SECS_PER_HOUR                     ) ||
+         ( (u16_seconds                       > PHD_SECS_PER_MINUTE) &&
+           (u16_seconds % PHD_SECS_PER_MINUTE != 0                 )    )    )
+    {
+      (void)xc_printf ("PHD_SetWindow: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_SetWindow: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    pt_window = &(pt_this->at_window[u8_window]) ;
+
+    // Begin of critical region: The process must not close a slot meanwhile
+    KE_CriticalBegin () ;
+
+    pt_window->u16_seconds = u16_seconds ;
+    pt_window->u24_sum     = 0 ;
+    if (u16_seconds <= PHD_SECS_PER_MINUTE)
+    {
+      // Sum the newest second slots
+      pt_window->b_minuteSlots = FALSE ;
+      pt_window->u8_nrOfSlots  = u16_seconds ;
+      u8_slot                  = pt_this->u8_oldestSlot ;
+      for (u8_index = 0; u8_index < pt_window->u8_nrOfSlots; u8_index ++)
+      {
+        u8_slot = (u8_slot == 0) ? PHD_SLOTS_PER_MINUTE - 1 : u8_slot - 1 ;
+        pt_window->u24_sum += pt_this->au16_secondSlot[u8_slot] ;
+      }
+    }
+    else
+    {
+      // Sum the newest minute slots
+      pt_window->b_minuteSlots = TRUE ;
+      pt_window->u8_nrOfSlots  = u16_seconds / PHD_SECS_PER_MINUTE ;
+      u8_slot                  = pt_this->u8_oldestMinute ;
+      for (u8_index = 0; u8_index < pt_window->u8_nrOfSlots; u8_index ++)
+      {
+        u8_slot = (u8_slot == 0) ? PHD_SLOTS_PER_HOUR - 1 : u8_slot - 1 ;
+        pt_window->u24_sum += pt_this->au24_minuteSlot[u8_slot] ;
+      }
+    }
+
+    // End of critical region
+    KE_CriticalEnd () ;
+  }
+
+  return (result) ;
+}
+// End: PHD_SetWindow
+
+
+PHD_status PHD_GetWindowPulses (PHD_handle       const pt_instance,
+                                unsigned char    const u8_window,
+                                unsigned int   * const pu24_pulses,
+                                unsigned short * const pu16_seconds)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_GetWindowPulses                                        //
+//                 - Retrieve the number of pulses in an averaging window and //
+//                   the length of that window in seconds                     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance  == NULL           ) ||
+         (u8_window    >= PHD_MAX_WINDOWS) ||
+         (pu24_pulses  == NULL           ) ||
+         (pu16_seconds == NULL           )    )
+    {
+      (void)xc_printf ("PHD_GetWindowPulses: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_GetWindowPulses: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Fill out the window contents
+    *pu24_pulses  = pt_this->at_window[u8_window].u24_sum ;
+    *pu16_seconds = pt_this->at_window[u8_window].u16_seconds ;
+  }
+
+  return (result) ;
+}
+// End: PHD_GetWindowPulses
+
+
+PHD_status PHD_GetStatistics (PHD_handle                    const pt_instance,
+                              PHD_statistics_struct       * const pt_statistics)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_GetStatistics                                          //
+//                 - Retrieve the pulse accounting counters of an instance    //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status                  result  = PHD_OK ;
+  PHD_instance_struct * const pt_this = pt_instance ;
+  unsigned char               u8_intervalSeq ;
+
+  if (result == PHD_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance   == NULL) ||
+         (pt_statistics == NULL)    )
+    {
+      (void)xc_printf ("PHD_GetStatistics: Parameter error.\n") ;
+      result = PHD_ERR_PARAM ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Check if the pointer is valid
+    if (PHD_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("PHD_GetStatistics: Invalid pointer.\n") ;
+      result = PHD_ERR_POINTER ;
+    }
+  }
+
+  if (result == PHD_OK)
+  {
+    // Copy the ISR's counters; retry if a pulse came in during the copy
+    do
+    {
+      u8_intervalSeq                 = pt_this->u8_intervalSeq ;
+      pt_statistics->u32_accepted    = pt_this->u32_accepted ;
+      pt_statistics->u32_rejected    = pt_this->u32_rejected ;
+      pt_statistics->u32_minInterval = pt_this->u32_minInterval ;
+      pt_statistics->u32_maxInterval = pt_this->u32_maxInterval ;
+      pt_statistics->u32_debounce    = pt_this->u32_debounceTime ;
+    } while (u8_intervalSeq != pt_this->u8_intervalSeq) ;
+
+    // Only the process writes this one, in a single (24-bit) access
+    pt_statistics->u24_overflows = pt_this->u24_overflows ;
+  }
+
+  return (result) ;
+}
+// End: PHD_GetStatistics
+
+
+PHD_status  PHD_GetPulses (PHD_handle            const pt_instance,
                            unsigned int        * const pu24_pulses)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       PHD_GetPulses                                              //
 //                 - Retrieve the nr of metered pulses since last time        //
+//                 - Only one storage client may fetch pulses                 //
 // History :       24 Jul 2004 by R. Delien:                                  //
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
   PHD_status                  result  = PHD_OK ;
   PHD_instance_struct * const pt_this = pt_instance ;
+  unsigned int                u24_pulseTotal ;
 
   if (result == PHD_OK)
   {
@@ -509,18 +1263,16 @@ PHD_status  PHD_GetPulses (PHD_handle            const pt_instance,
 
   if (result == PHD_OK)
   {
-    // Begin of critical region: No interrupts, no task switches
-    KE_CriticalBegin () ;
+    // Take a snapshot of the free running counter. The ISR only increases it
+    // and it is read in a single (24-bit) access, so interrupts can stay
+    // enabled; pulses arriving after the snapshot are left for the next fetch.
+    u24_pulseTotal = pt_this->u24_pulseTotal ;
 
-    // Fill out the number of metered pulses
-    *pu24_pulses = pt_this->u24_pulses ;
-    // Reset the meter counter
-    pt_this->u24_pulses = 0 ;
-    // Reset the meter counter change-detection-buffer
-    pt_this->u24_pulsesSend = 0 ;
+    // Fill out the number of metered pulses since the previous fetch
+    *pu24_pulses = u24_pulseTotal - pt_this->u24_pulseTotalFetched ;
 
-    // En of critical region
-    KE_CriticalEnd () ;
+    // Remember what has been handed over
+    pt_this->u24_pulseTotalFetched = u24_pulseTotal ;
   }
 
   return (result) ;
@@ -532,75 +1284,526 @@ PHD_status  PHD_GetPulses (PHD_handle            const pt_instance,
 // Local Implementations                                                      //
 ////////////////////////////////////////////////////////////////////////////////
 
-static PROCESS PHD_Process (PHD_handle const pt_instance)
+static PROCESS PHD_Process (void)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       PHD_Process                                                //
-//                 - Periodically check if metered data has change and if so  //
-//                   send events to clients                                   //
+//                 - Check if metered data has change and if so send events   //
+//                   to clients                                               //
+//                 - Sleeps until the first channel closes its next second;   //
+//                   the load can only drop when a second leaves the window,  //
+//                   and pulses are handed to storage once per second         //
+//                 - Services all channels in one pass                        //
 // History :       24 Jul 2004 by R. Delien:                                  //
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
-  PHD_instance_struct * const pt_this = pt_instance ;
-  unsigned char               u8_index ;
-  unsigned int                u24_pulsesPerMinute ;
+  unsigned char u8_channelNr ;
+  unsigned long u32_ticksLeft ;
+  unsigned long u32_sleep ;
 
   for (;;)
   {
-    KE_CriticalBegin () ;
-
-    // Remove old time stamps from the queue
-    while ( (pt_this->u16_pulseQueueHead != pt_this->u16_pulseQueueTail                                      ) &&
-            (TMR_TimeStampAge (&(pt_this->at_pulseQueue[pt_this->u16_pulseQueueTail])) > PHD_TICKS_PER_MINUTE)    )
+    u32_sleep = TMR_SECOND ;
+    for (u8_channelNr = 0; u8_channelNr < u8_nrOfChannels; u8_channelNr ++)
     {
-      // Increase the queue tail
-      pt_this->u16_pulseQueueTail ++ ;
-      if (pt_this->u16_pulseQueueTail >= pt_this->u16_pulseQueueSize)
+      // Only service claimed channels
+      if (!PHD_PTR_INVALID((&(pt_channel[u8_channelNr]))))
       {
-        pt_this->u16_pulseQueueTail = 0 ;
+        u32_ticksLeft = PHD_ServiceChannel (&(pt_channel[u8_channelNr])) ;
+        if (u32_ticksLeft < u32_sleep)
+        {
+          u32_sleep = u32_ticksLeft ;
+        }
       }
     }
 
-    // Calculate the current number of timestamps in the queue
-    if (pt_this->u16_pulseQueueHead >= pt_this->u16_pulseQueueTail)
+    // Sleep until the next second boundary, rounded up to whole sleep units
+    u32_sleep = (u32_sleep + PHD_TICKS_PER_SLEEP - 1) / PHD_TICKS_PER_SLEEP ;
+    if (u32_sleep == 0)
     {
-      u24_pulsesPerMinute = pt_this->u16_pulseQueueHead - pt_this->u16_pulseQueueTail ;
+      u32_sleep = 1 ;
     }
-    else
+    KE_TaskSleep100 ((unsigned int)u32_sleep) ;
+  }
+
+  return ;
+}
+// End: PHD_Process
+
+
+static PHD_status PHD_TakePulse (PHD_instance_struct       * const pt_this,
+                                 TMR_micro_struct    const * const pt_pulseTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_TakePulse                                              //
+//                 - Debounce and count a pulse of a checked instance         //
+//                 - Returns PHD_ERR_DEBOUNCE if the pulse was rejected       //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_status    result = PHD_OK ;
+  unsigned long u32_interval ;
+
+  if (result == PHD_OK)
+  {
+    // Debounce the pulse
+    if (pt_this->b_lastPulseValid != FALSE)
     {
-      u24_pulsesPerMinute = (pt_this->u16_pulseQueueHead + pt_this->u16_pulseQueueSize) - pt_this->u16_pulseQueueTail ;
+      u32_interval = TMR_MicroStampDiff (pt_pulseTime, &(pt_this->t_lastPulse)) ;
+      if (u32_interval < pt_this->u32_debounceTime)
+      {
+        // A steady run of rejections opens the window, so it can't lock out real pulses
+        if (pt_this->b_adaptiveDebounce != FALSE)
+        {
+          PHD_AdaptDebounce (pt_this, pt_pulseTime, u32_interval, TRUE) ;
+        }
+
+        // Account the rejected pulse, unless the run just showed it to be real
+        if (u32_interval < pt_this->u32_debounceTime)
+        {
+          pt_this->u32_rejected ++ ;
+          pt_this->u8_intervalSeq ++ ;
+
+          result = PHD_ERR_DEBOUNCE ;
+        }
+      }
     }
+  }
 
-    // Begin of critical region: No interrupts, no task switches
-    KE_CriticalEnd () ;
+  if (result == PHD_OK)
+  {
+    // Increase the free running pulse counter
+    pt_this->u24_pulseTotal ++ ;
+    pt_this->u32_accepted ++ ;
 
-    // Send a message if the number of pulses per minute has changed
-    if (pt_this->u24_pulsesPerMinute != u24_pulsesPerMinute)
+    // Update the filtered interval if the previous pulse is known
+    if (pt_this->b_lastPulseValid != FALSE)
     {
-      pt_this->u24_pulsesPerMinute = u24_pulsesPerMinute ;
+      // Keep track of the extremes
+      if (u32_interval < pt_this->u32_minInterval)
+      {
+        pt_this->u32_minInterval = u32_interval ;
+      }
+      if (u32_interval > pt_this->u32_maxInterval)
+      {
+        pt_this->u32_maxInterval = u32_interval ;
+      }
 
-      for (u8_index = 0; u8_index < PHD_MAX_EVENTS; u8_index ++)
+      if (u32_interval > PHD_IPI_MAX)
       {
-        if (pt_this->pt_displayProcId[u8_index] != NULL)
-        {
-          (void)KE_MBoxSend (pt_this->pt_displayProcId[u8_index], pt_this) ;
-        }
+        u32_interval = PHD_IPI_MAX ;
+      }
+
+      // Let the debounce time follow the shortest plausible interval
+      if (pt_this->b_adaptiveDebounce != FALSE)
+      {
+        PHD_AdaptDebounce (pt_this, pt_pulseTime, u32_interval, FALSE) ;
+      }
+
+      if (pt_this->u32_avgInterval == 0)
+      {
+        // First interval: Take it as it is
+        pt_this->u32_avgInterval = u32_interval ;
       }
+      else if (u32_interval >= pt_this->u32_avgInterval)
+      {
+        // Exponentially weighted moving average (unsigned, intervals exceed a signed long)
+        pt_this->u32_avgInterval += (u32_interval - pt_this->u32_avgInterval) >> pt_this->u8_rateFilter ;
+      }
+      else
+      {
+        pt_this->u32_avgInterval -= (pt_this->u32_avgInterval - u32_interval) >> pt_this->u8_rateFilter ;
+      }
+    }
+
+    // Remember the time stamp of this pulse
+    pt_this->t_lastPulse      = *pt_pulseTime ;
+    pt_this->t_lastPlausible  = *pt_pulseTime ;
+    pt_this->b_lastPulseValid = TRUE ;
+    pt_this->u8_intervalSeq ++ ;
+  }
+
+  return (result) ;
+}
+// End: PHD_TakePulse
+
+
+static unsigned long PHD_ServiceChannel (PHD_instance_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_ServiceChannel                                         //
+//                 - Close the passed seconds of one channel and send events  //
+//                   to its clients                                           //
+//                 - Returns the ticks left until its next second closes      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char  u8_index ;
+  unsigned char  u8_closedSeconds ;
+  unsigned int   u24_pulseTotal ;
+  unsigned int   u24_pulsesPerHour ;
+  unsigned long  u32_ticksLeft ;
+  BOOL           b_loadChanged ;
+
+  // Simulated instances have their seconds closed by PHD_AdvanceTime
+  u32_ticksLeft = TMR_SECOND ;
+  if (pt_this->b_simulated == FALSE)
+  {
+    // Close every second that has passed, but never more than one window
+    u8_closedSeconds = 0 ;
+    while ( (TMR_CheckTimeout (&(pt_this->t_nextSecond)) != FALSE) &&
+            (u8_closedSeconds < PHD_SLOTS_PER_MINUTE            )    )
+    {
+      PHD_CloseRunning (pt_this) ;
+      TMR_PostponeTimeout (&(pt_this->t_nextSecond), TMR_SECOND) ;
+      u8_closedSeconds ++ ;
     }
 
-    // Send a message if the number of pulses has changed
-    if (pt_this->u24_pulsesSend != pt_this->u24_pulses)
+    // Resynchronize if we have been stalled for more than a whole window
+    if (u8_closedSeconds >= PHD_SLOTS_PER_MINUTE)
     {
-      pt_this->u24_pulsesSend = pt_this->u24_pulses ;
+      TMR_SetTimeout (&(pt_this->t_nextSecond), TMR_SECOND) ;
+    }
+
+    u32_ticksLeft = TMR_TimeoutLeft (&(pt_this->t_nextSecond)) ;
+  }
+
+  // Check if the number of pulses per minute has changed
+  b_loadChanged = FALSE ;
+  if (pt_this->u24_pulsesPerMinute != pt_this->u24_windowSum)
+  {
+    pt_this->u24_pulsesPerMinute = pt_this->u24_windowSum ;
+    b_loadChanged = TRUE ;
+  }
+
+  // Check if the interval based rate has changed
+  u24_pulsesPerHour = PHD_IntervalRate (pt_this) ;
+  if (pt_this->u24_pulsesPerHour != u24_pulsesPerHour)
+  {
+    pt_this->u24_pulsesPerHour = u24_pulsesPerHour ;
+    b_loadChanged = TRUE ;
+  }
 
-      if (pt_this->pt_storageProcId != NULL)
+  // Send a message if the load has changed
+  if (b_loadChanged != FALSE)
+  {
+
+    for (u8_index = 0; u8_index < PHD_MAX_EVENTS; u8_index ++)
+    {
+      if (pt_this->pt_displayProcId[u8_index] != NULL)
       {
-        (void)KE_MBoxSend (pt_this->pt_storageProcId, pt_this) ;
+        (void)KE_MBoxSend (pt_this->pt_displayProcId[u8_index], pt_this) ;
       }
     }
+  }
+
+  // Send a message if the number of pulses has changed
+  u24_pulseTotal = pt_this->u24_pulseTotal ;
+  if (pt_this->u24_pulseTotalSend != u24_pulseTotal)
+  {
+    pt_this->u24_pulseTotalSend = u24_pulseTotal ;
 
-    KE_TaskSleep(0);
+    if (pt_this->pt_storageProcId != NULL)
+    {
+      (void)KE_MBoxSend (pt_this->pt_storageProcId, pt_this) ;
+    }
   }
 
+  return (u32_ticksLeft) ;
+}
+// End: PHD_ServiceChannel
+
+
+static unsigned int PHD_IntervalRate (PHD_instance_struct const * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_IntervalRate                                           //
+//                 - Calculate the rate in pulses per hour from the filtered  //
+//                   pulse interval                                           //
+//                 - When pulses stop, the rate decays: It never exceeds one  //
+//                   pulse per time elapsed since the last pulse              //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TMR_micro_struct  t_lastPulse ;
+  unsigned long     u32_avgInterval ;
+  unsigned long     u32_age ;
+  unsigned char     u8_intervalSeq ;
+  BOOL              b_lastPulseValid ;
+  unsigned int      u24_pulsesPerHour = 0 ;
+
+  // Copy the ISR's data; retry if a pulse came in during the copy
+  do
+  {
+    u8_intervalSeq   = pt_this->u8_intervalSeq ;
+    t_lastPulse      = pt_this->t_lastPulse ;
+    u32_avgInterval  = pt_this->u32_avgInterval ;
+    b_lastPulseValid = pt_this->b_lastPulseValid ;
+  } while (u8_intervalSeq != pt_this->u8_intervalSeq) ;
+
+  if ( (b_lastPulseValid != FALSE) &&
+       (u32_avgInterval  != 0    )    )
+  {
+    // Apply the decay rule
+    u32_age = TMR_MicroStampAge (&t_lastPulse) ;
+    if (u32_age > PHD_IPI_MAX)
+    {
+      u32_age = PHD_IPI_MAX ;
+    }
+    if (u32_age > u32_avgInterval)
+    {
+      u32_avgInterval = u32_age ;
+    }
+
+    u24_pulsesPerHour = PHD_US_PER_HOUR / u32_avgInterval ;
+  }
+
+  return (u24_pulsesPerHour) ;
+}
+// End: PHD_IntervalRate
+
+
+static void PHD_CloseRunning (PHD_instance_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_CloseRunning                                           //
+//                 - Close the running second                                 //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned int   u24_pulseTotal ;
+  unsigned int   u24_closedPulses ;
+
+  // Take the pulses of the running second. The ISR only ever increases the
+  // free running counter, which is read in a single (24-bit) access, so
+  // no critical region is needed.
+  u24_pulseTotal                = pt_this->u24_pulseTotal ;
+  u24_closedPulses              = u24_pulseTotal - pt_this->u24_pulseTotalSecond ;
+  pt_this->u24_pulseTotalSecond = u24_pulseTotal ;
+
+  // Saturate a second which does not fit a slot
+  if (u24_closedPulses > 0xFFFF)
+  {
+    u24_closedPulses = 0xFFFF ;
+    pt_this->u24_overflows ++ ;
+  }
+
+  // Move the closed second into the windows
+  PHD_CloseSecond (pt_this, (unsigned short)u24_closedPulses) ;
+
+  return ;
+}
+// End: PHD_CloseRunning
+
+
+static void PHD_AdaptDebounce (PHD_instance_struct       * const pt_this,
+                               TMR_micro_struct    const * const pt_pulseTime,
+                               unsigned long               const u32_interval,
+                               BOOL                        const b_rejected)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_AdaptDebounce                                          //
+//                 - Track the low end of the intervals and derive the        //
+//                   debounce time from it (INTERRUPT CONTEXT!)               //
+//                 - The estimate drops fast on accepted intervals, so a real //
+//                   load spike is never debounced away, and rises slowly,    //
+//                   so a single long gap doesn't open the window for chatter //
+//                 - Rejected pulses closer than the lower bound to the last  //
+//                   plausible pulse are bounces and teach nothing. Other     //
+//                   rejections only reset the estimate after PHD_REJECT_RUN  //
+//                   of them at one spacing, with at most accepted pulses in  //
+//                   step in between: Real pulses inside a window that is too //
+//                   wide. Chatter has no steady spacing                      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long u32_debounceTime ;
+  unsigned long u32_spacing ;
+  unsigned long u32_margin ;
+  BOOL          b_sameSpacing ;
+
+  // Compare the spacing to the last plausible pulse with the running series
+  u32_spacing   = TMR_MicroStampDiff (pt_pulseTime, &(pt_this->t_lastPlausible)) ;
+  u32_margin    = pt_this->u32_rejectSpacing >> PHD_SPACING_SHIFT ;
+  b_sameSpacing = ( (pt_this->u8_rejectRun    >  0                                      ) &&
+                    (u32_spacing + u32_margin >= pt_this->u32_rejectSpacing             ) &&
+                    (u32_spacing              <= pt_this->u32_rejectSpacing + u32_margin)    ) ;
+
+  if (b_rejected == FALSE)
+  {
+    // Asymmetric tracking of the shortest plausible interval
+    if (u32_interval < pt_this->u32_lowInterval)
+    {
+      pt_this->u32_lowInterval -= (pt_this->u32_lowInterval - u32_interval) >> PHD_TRACK_DOWN_SHIFT ;
+    }
+    else
+    {
+      pt_this->u32_lowInterval += (u32_interval - pt_this->u32_lowInterval) >> PHD_TRACK_UP_SHIFT ;
+    }
+
+    // An accepted pulse in step with the series keeps it going, any other ends it
+    if (b_sameSpacing == FALSE)
+    {
+      pt_this->u8_rejectRun = 0 ;
+    }
+  }
+  else
+  {
+    if (u32_spacing >= pt_this->u32_debounceMin)
+    {
+      pt_this->t_lastPlausible = *pt_pulseTime ;
+
+      // Count the rejections in a row at the same spacing
+      if (b_sameSpacing != FALSE)
+      {
+        pt_this->u8_rejectRun ++ ;
+      }
+      else
+      {
+        pt_this->u32_rejectSpacing = u32_spacing ;
+        pt_this->u8_rejectRun      = 1 ;
+      }
+
+      // A steady run: Real pulses come this fast
+      if (pt_this->u8_rejectRun >= PHD_REJECT_RUN)
+      {
+        pt_this->u32_lowInterval = pt_this->u32_rejectSpacing ;
+        pt_this->u8_rejectRun    = 0 ;
+      }
+    }
+  }
+
+  // Reject anything closer than a fraction of it, within the bounds
+  u32_debounceTime = pt_this->u32_lowInterval / PHD_DEBOUNCE_FACTOR ;
+  if (u32_debounceTime < pt_this->u32_debounceMin)
+  {
+    u32_debounceTime = pt_this->u32_debounceMin ;
+  }
+  if (u32_debounceTime > pt_this->u32_debounceMax)
+  {
+    u32_debounceTime = pt_this->u32_debounceMax ;
+  }
+  pt_this->u32_debounceTime = u32_debounceTime ;
+
+  return ;
+}
+// End: PHD_AdaptDebounce
+
+
+static void PHD_CloseSecond (PHD_instance_struct * const pt_this,
+                             unsigned short        const u16_closedPulses)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_CloseSecond                                            //
+//                 - Move a closed second into the second slots and update    //
+//                   the running sums of all windows incrementally            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_window_struct * pt_window ;
+  unsigned char       u8_index ;
+  unsigned char       u8_leavingSlot ;
+
+  // Update the windows built from second slots, before the oldest slot is overwritten
+  for (u8_index = 0; u8_index < PHD_MAX_WINDOWS; u8_index ++)
+  {
+    pt_window = &(pt_this->at_window[u8_index]) ;
+    if ( (pt_window->u16_seconds   != 0    ) &&
+         (pt_window->b_minuteSlots == FALSE)    )
+    {
+      // The slot which drops out of this window
+      u8_leavingSlot = (pt_this->u8_oldestSlot + PHD_SLOTS_PER_MINUTE - pt_window->u8_nrOfSlots) % PHD_SLOTS_PER_MINUTE ;
+
+      pt_window->u24_sum -= pt_this->au16_secondSlot[u8_leavingSlot] ;
+      pt_window->u24_sum += u16_closedPulses ;
+    }
+  }
+
+  // Replace the oldest slot by the closed second and update the running sum
+  pt_this->u24_windowSum -= pt_this->au16_secondSlot[pt_this->u8_oldestSlot] ;
+  pt_this->u24_windowSum += u16_closedPulses ;
+  pt_this->au16_secondSlot[pt_this->u8_oldestSlot] = u16_closedPulses ;
+
+  // Increase the oldest slot
+  pt_this->u8_oldestSlot ++ ;
+  if (pt_this->u8_oldestSlot >= PHD_SLOTS_PER_MINUTE)
+  {
+    pt_this->u8_oldestSlot = 0 ;
+  }
+
+  // Accumulate the running minute and close it when complete
+  pt_this->u24_minutePulses += u16_closedPulses ;
+  pt_this->u8_secondsInMinute ++ ;
+  if (pt_this->u8_secondsInMinute >= PHD_SECS_PER_MINUTE)
+  {
+    PHD_CloseMinute (pt_this) ;
+  }
+
+  return ;
+}
+// End: PHD_CloseSecond
+
+
+static void PHD_CloseMinute (PHD_instance_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_CloseMinute                                            //
+//                 - Move the running minute into the minute slots and update //
+//                   the running sums of the windows built from them          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  PHD_window_struct * pt_window ;
+  unsigned char       u8_index ;
+  unsigned char       u8_leavingSlot ;
+
+  // Update the windows built from minute slots, before the oldest slot is overwritten
+  for (u8_index = 0; u8_index < PHD_MAX_WINDOWS; u8_index ++)
+  {
+    pt_window = &(pt_this->at_window[u8_index]) ;
+    if ( (pt_window->u16_seconds   != 0    ) &&
+         (pt_window->b_minuteSlots != FALSE)    )
+    {
+      // The slot which drops out of this window
+      u8_leavingSlot = (pt_this->u8_oldestMinute + PHD_SLOTS_PER_HOUR - pt_window->u8_nrOfSlots) % PHD_SLOTS_PER_HOUR ;
+
+      pt_window->u24_sum -= pt_this->au24_minuteSlot[u8_leavingSlot] ;
+      pt_window->u24_sum += pt_this->u24_minutePulses ;
+    }
+  }
+
+  // Replace the oldest minute slot by the closed minute
+  pt_this->au24_minuteSlot[pt_this->u8_oldestMinute] = pt_this->u24_minutePulses ;
+
+  // Increase the oldest minute slot
+  pt_this->u8_oldestMinute ++ ;
+  if (pt_this->u8_oldestMinute >= PHD_SLOTS_PER_HOUR)
+  {
+    pt_this->u8_oldestMinute = 0 ;
+  }
+
+  // Start a new minute
+  pt_this->u24_minutePulses   = 0 ;
+  pt_this->u8_secondsInMinute = 0 ;
+
+  return ;
+}
+// End: PHD_CloseMinute
+
+
+static void PHD_ClearWindows (PHD_instance_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       PHD_ClearWindows                                           //
+//                 - Empty all slots and the running sums of all windows      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char u8_index ;
+
+  for (u8_index = 0; u8_index < PHD_SLOTS_PER_MINUTE; u8_index ++)
+  {
+    pt_this->au16_secondSlot[u8_index] = 0 ;
+  }
+  for (u8_index = 0; u8_index < PHD_SLOTS_PER_HOUR; u8_index ++)
+  {
+    pt_this->au24_minuteSlot[u8_index] = 0 ;
+  }
+  for (u8_index = 0; u8_index < PHD_MAX_WINDOWS; u8_index ++)
+  {
+    pt_this->at_window[u8_index].u24_sum = 0 ;
+  }
+
+  pt_this->u8_oldestSlot      = 0 ;
+  pt_this->u24_windowSum      = 0 ;
+  pt_this->u8_oldestMinute    = 0 ;
+  pt_this->u8_secondsInMinute = 0 ;
+  pt_this->u24_minutePulses   = 0 ;
+
   return ;
 }
+// End: PHD_ClearWindows
@@ -26,21 +26,62 @@
 #define PHD_ERR_PROCESS         (-4)                  // Process allocation errord
 #define PHD_ERR_NOFREESLOT      (-5)                  // No free client slot was found
 #define PHD_ERR_NOTFOUND        (-6)                  // ProcessId not found
+#define PHD_ERR_NOTINIT         (-7)                  // Module not initialized
+#define PHD_ERR_DEBOUNCE        (-8)                  // Pulse rejected by the debouncer
+#define PHD_ERR_BUSY            (-9)                  // Instance feeds storage, or runs simulated
+
+#define PHD_MAX_CHANNELS        (16)                  // Maximum number of channels of the pulse handler
+
+#define PHD_MAX_WINDOWS         (4)                   // Number of averaging windows per instance
+#define PHD_WINDOW_FAST         (1)                   // Default window 0: 1 second, live meter
+#define PHD_WINDOW_SHORT        (10)                  // Default window 1: 10 seconds
+#define PHD_WINDOW_MINUTE       (60)                  // Default window 2: 1 minute, display
+#define PHD_WINDOW_DEMAND       (900)                 // Default window 3: 15 minutes, demand tracking
 
 
 // PHD types
 typedef void*                   PHD_handle ;
 typedef char                    PHD_status ;          // Status/Error return type
 
+typedef struct
+{
+  unsigned long   u32_accepted ;                      // Accepted pulses
+  unsigned long   u32_rejected ;                      // Pulses rejected by the debouncer
+  unsigned long   u32_minInterval ;                   // Shortest accepted interval in us, 0xFFFFFFFF if none yet
+  unsigned long   u32_maxInterval ;                   // Longest accepted interval in us, saturates at 0xFFFFFFFF
+  unsigned int    u24_overflows ;                     // Seconds with more pulses than a slot holds
+  unsigned long   u32_debounce ;                      // Current debounce time in us
+} PHD_statistics_struct ;
+
 
 ////// Main functions //////
+PHD_status  PHD_Initialize          (unsigned char         const u8_channels) ;
+
+PHD_status  PHD_Terminate           (void) ;
+
 PHD_status  PHD_Create              (PHD_handle          * const ppt_instance,
+                                     unsigned char         const u8_channelNr,
                                      unsigned short        const u16_maxPulsesPerMinute) ;
 
 PHD_status  PHD_Delete              (PHD_handle            const pt_instance) ;
 
 PHD_status  PHD_HandlePulse         (PHD_handle            const pt_instance) ;
 
+PHD_status  PHD_HandlePulseIsr      (PHD_handle            const pt_instance,
+                                     TMR_micro_struct const * const pt_pulseTime) ;
+
+////// Simulation functions //////
+PHD_status  PHD_HandlePulseAt       (PHD_handle            const pt_instance,
+                                     TMR_micro_struct const * const pt_pulseTime) ;
+
+PHD_status  PHD_SetSimulated        (PHD_handle            const pt_instance,
+                                     TMR_micro_struct const * const pt_startTime) ;
+
+PHD_status  PHD_AdvanceTime         (PHD_handle            const pt_instance,
+                                     TMR_micro_struct const * const pt_currentTime) ;
+
+PHD_status  PHD_SetRealTime         (PHD_handle            const pt_instance) ;
+
 ////// Metering functions //////
 PHD_status  PHD_SetStorageClient    (PHD_handle            const pt_instance,
                                      PID                   const t_clientProcId) ;
@@ -58,4 +99,27 @@ PHD_status  PHD_RemoveClient        (PHD_handle            const pt_instance,
 PHD_status  PHD_GetPulsesPerMinute  (PHD_handle            const pt_instance,
                                      unsigned int        * const pu24_pulsesPerMinute) ;
 
+PHD_status  PHD_GetPulsesPerHour    (PHD_handle            const pt_instance,
+                                     unsigned int        * const pu24_pulsesPerHour) ;
+
+PHD_status  PHD_SetRateFilter       (PHD_handle            const pt_instance,
+                                     unsigned char         const u8_rateFilter) ;
+
+PHD_status  PHD_SetAdaptiveDebounce (PHD_handle            const pt_instance,
+                                     unsigned long         const u32_minDebounce,
+                                     unsigned long         const u32_maxDebounce) ;
+
+PHD_status  PHD_SetWindow           (PHD_handle            const pt_instance,
+                                     unsigned char         const u8_window,
+                                     unsigned short        const u16_seconds) ;
+
+PHD_status  PHD_GetWindowPulses     (PHD_handle            const pt_instance,
+                                     unsigned char         const u8_window,
+                                     unsigned int        * const pu24_pulses,
+                                     unsigned short      * const pu16_seconds) ;
+
+////// Monitoring functions //////
+PHD_status  PHD_GetStatistics       (PHD_handle            const pt_instance,
+                                     PHD_statistics_struct * const pt_statistics) ;
+
 #endif //PHD_PULSEHANDLER_H
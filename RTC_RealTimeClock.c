@@ -16,6 +16,8 @@
 #define RTC_SECS_PER_MIN      (60UL)
 #define RTC_SECS_PER_HOUR     (60UL * RTC_SECS_PER_MIN)
 #define RTC_SECS_PER_DAY      (24UL * RTC_SECS_PER_HOUR)
+#define RTC_SECS_PER_QUARTER  (15UL * RTC_SECS_PER_MIN)
+#define RTC_DAYS_PER_WEEK     (7)
 
 #define RTC_UTC               (0UL * RTC_SECS_PER_HOUR)
 #define RTC_CET               (1UL * RTC_SECS_PER_HOUR)
@@ -24,12 +26,12 @@
 #define RTC_LEAPYEAR(y)       (((y)%4==0) && (((y)%100!=0) || ((y)%400==0)))
 
 #define RTC_LOCAL             (RTC_CET)
-#define RTC_DST(t)            (((t->u8_month  >  3) && (t->u8_month < 10)                                               ) || \
-                               ((t->u8_month == 10) && (t->u8_day <  25)                                                ) || \
-                               ((t->u8_month ==  3) && (t->u8_day >= 25) && (t->u8_day + (7 - t->u8_dayOfWeek) >  31)   ) || \
-                               ((t->u8_month == 10) && (t->u8_day >= 25) && (t->u8_day + (7 - t->u8_dayOfWeek) <= 31)   ) || \
-                               ((t->u8_month ==  3) && (t->u8_day >= 25) && (t->u8_dayOfWeek == 0) && (t->u8_hour >=  2)) || \
-                               ((t->u8_month == 10) && (t->u8_day >= 25) && (t->u8_dayOfWeek == 0) && (t->u8_hour <   2))    )
+#define RTC_DST(t)            (((t->u8_month  >  3) && (t->u8_month < 10)                                                                      ) || \
+                               ((t->u8_month == 10) && (t->u8_day <  25)                                                                       ) || \
+                               ((t->u8_month ==  3) && (t->u8_day >= 25) && (t->u8_dayOfWeek != 0) && (t->u8_day + (7 - t->u8_dayOfWeek) >  31)) || \
+                               ((t->u8_month == 10) && (t->u8_day >= 25) && (t->u8_day + (7 - t->u8_dayOfWeek) <= 31)                          ) || \
+                               ((t->u8_month ==  3) && (t->u8_day >= 25) && (t->u8_dayOfWeek == 0) && (t->u8_hour >=  2)                       ) || \
+                               ((t->u8_month == 10) && (t->u8_day >= 25) && (t->u8_dayOfWeek == 0) && (t->u8_hour <   2)                       )    )
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global Data                                                                //
@@ -52,6 +54,12 @@ static PID                 t_processId ;
 static PROCESS  RTC_Process       (void) ;
 static void     RTC_ReadDateTime  (RTC_DateTime_struct       * const t_curDateTime) ;
 static void     RTC_WriteDateTime (RTC_DateTime_struct const * const t_curDateTime) ;
+static void     RTC_Local2Seconds (unsigned long               const u32_localSeconds,
+                                   unsigned long             * const pu32_seconds) ;
+static unsigned long RTC_PeriodLength (t_event_enum            const t_period) ;
+static unsigned char RTC_DaysPerMonth (unsigned char           const u8_month,
+                                       unsigned short          const u16_year) ;
+static void     RTC_SendEvent     (t_event_enum                const t_event) ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,11 +291,11 @@ void RTC_Seconds2UTC (unsigned long         const u32_seconds,
   pt_dateTime->u8_minute    = (u32_seconds % RTC_SECS_PER_HOUR) / RTC_SECS_PER_MIN ;
   pt_dateTime->u8_hour      = (u32_seconds % RTC_SECS_PER_DAY ) / RTC_SECS_PER_HOUR ;
   u32_totalDays             = (u32_seconds / RTC_SECS_PER_DAY ) + 1UL ;     // 1-1-1970 = day 0
-  pt_dateTime->u8_dayOfWeek = (u32_totalDays + 4UL) % 7UL ;       // 0 = Sunday
+  pt_dateTime->u8_dayOfWeek = (u32_totalDays + 3UL) % 7UL ;       // 0 = Sunday
 
-  // Transfer days to years
+  // Transfer days to years, each compared with its own length
   pt_dateTime->u16_year = 1970 ;
-  do
+  for (;;)
   {
     if (RTC_LEAPYEAR(pt_dateTime->u16_year))
     {
@@ -298,45 +306,26 @@ void RTC_Seconds2UTC (unsigned long         const u32_seconds,
       u16_daysPerYear = 365 ;
     }
 
-    if (u32_totalDays > u16_daysPerYear)
+    if (u32_totalDays <= u16_daysPerYear)
     {
-      u32_totalDays -= u16_daysPerYear ;
-      pt_dateTime->u16_year ++ ;
+      break ;
     }
-  } while (u32_totalDays > u16_daysPerYear) ;
+    u32_totalDays -= u16_daysPerYear ;
+    pt_dateTime->u16_year ++ ;
+  }
 
-  // Transfer days to months
+  // Transfer days to months, each compared with its own length
   pt_dateTime->u8_month = 1 ;
-  do
+  for (;;)
   {
-    switch (pt_dateTime->u8_month)
-    {
-      case 1:   case 3:   case 5:   case 7:   case 8:   case 10: case 12:
-        u8_daysPerMonth = 31 ;
-        break ;
-
-      case 4:   case 6:   case 9:   case 11:
-        u8_daysPerMonth = 30 ;
-        break ;
-
-      default:
-        if (RTC_LEAPYEAR(pt_dateTime->u16_year))
-        {
-          u8_daysPerMonth = 29 ;
-        }
-        else
-        {
-          u8_daysPerMonth = 28 ;
-        }
-        break ;
-    }
-
-    if (u32_totalDays > u8_daysPerMonth)
+    u8_daysPerMonth = RTC_DaysPerMonth (pt_dateTime->u8_month, pt_dateTime->u16_year) ;
+    if (u32_totalDays <= u8_daysPerMonth)
     {
-      u32_totalDays -= u8_daysPerMonth ;
-      pt_dateTime->u8_month ++ ;
+      break ;
     }
-  } while (u32_totalDays > u8_daysPerMonth) ;
+    u32_totalDays -= u8_daysPerMonth ;
+    pt_dateTime->u8_month ++ ;
+  }
 
   // Fill out the remaining days
   pt_dateTime->u8_day = u32_totalDays ;
@@ -397,6 +386,347 @@ void RTC_Date2Seconds (RTC_DateTime_struct const * const pt_dateTime,
 }
 
 
+void RTC_AlignTime (t_event_enum    const t_period,
+                    unsigned long   const u32_seconds,
+                    unsigned long * const pu32_aligned)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_AlignTime                                              //
+//                 - Returns the start of the period containing u32_seconds.  //
+//                   Days, weeks (from monday), months and years start at     //
+//                   local midnight, the same moment their events are sent    //
+////////////////////////////////////////////////////////////////////////////////
+{
+  RTC_DateTime_struct t_dateTime ;
+  unsigned long       u32_localSeconds ;
+
+  switch (t_period)
+  {
+    case e_dayEvent:
+    case e_weekEvent:
+      RTC_Seconds2Date (u32_seconds, &t_dateTime) ;
+      u32_localSeconds = u32_seconds + RTC_LOCAL ;
+      if (t_dateTime.b_daylightSavingTime != FALSE)
+      {
+        u32_localSeconds += RTC_SECS_PER_HOUR ;
+      }
+      u32_localSeconds -= u32_localSeconds % RTC_SECS_PER_DAY ;
+      if (t_period == e_weekEvent)
+      {
+        // Go back to monday (sunday is day 0)
+        u32_localSeconds -= ((t_dateTime.u8_dayOfWeek + RTC_DAYS_PER_WEEK - 1) % RTC_DAYS_PER_WEEK) * RTC_SECS_PER_DAY ;
+      }
+      RTC_Local2Seconds (u32_localSeconds, pu32_aligned) ;
+      break ;
+
+    case e_monthEvent:
+    case e_yearEvent:
+      RTC_Seconds2Date (u32_seconds, &t_dateTime) ;
+      if (t_period == e_yearEvent)
+      {
+        t_dateTime.u8_month = 1 ;
+      }
+      t_dateTime.u8_day    = 1 ;
+      t_dateTime.u8_hour   = 0 ;
+      t_dateTime.u8_minute = 0 ;
+      t_dateTime.u8_second = 0 ;
+      RTC_Date2Seconds (&t_dateTime, &u32_localSeconds) ;
+      RTC_Local2Seconds (u32_localSeconds, pu32_aligned) ;
+      break ;
+
+    default:
+      // The local time only differs whole hours from the RTC time
+      *pu32_aligned = u32_seconds - (u32_seconds % RTC_PeriodLength (t_period)) ;
+      break ;
+  }
+
+  return ;
+}
+// End: RTC_AlignTime
+
+
+void RTC_AlignGroup (t_event_enum    const t_period,
+                     unsigned short  const u16_factor,
+                     unsigned long   const u32_seconds,
+                     unsigned long * const pu32_aligned)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_AlignGroup                                             //
+//                 - Returns the start of the group of u16_factor periods     //
+//                   containing u32_seconds. Groups are counted from the      //
+//                   start of the day (periods up to an hour), the week       //
+//                   (days) or the year (months), and from 1970 for weeks and //
+//                   years. Groups that follow stay on these boundaries if    //
+//                   the factor divides the larger period                     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  RTC_DateTime_struct t_dateTime ;
+  unsigned long       u32_aligned ;
+  unsigned long       u32_anchor ;
+  unsigned long       u32_index ;
+  unsigned short      u16_index ;
+
+  RTC_AlignTime (t_period, u32_seconds, &u32_aligned) ;
+
+  switch (t_period)
+  {
+    case e_secondEvent:
+    case e_minuteEvent:
+    case e_quarterEvent:
+    case e_hourEvent:
+      RTC_AlignTime ((t_period == e_secondEvent) ? e_minuteEvent : e_dayEvent, u32_aligned, &u32_anchor) ;
+      RTC_CountPeriods (t_period, u32_anchor, u32_aligned, 0xFFFF, &u16_index) ;
+      u32_index = u16_index ;
+      break ;
+
+    case e_dayEvent:
+    case e_monthEvent:
+      RTC_AlignTime ((t_period == e_dayEvent) ? e_weekEvent : e_yearEvent, u32_aligned, &u32_anchor) ;
+      RTC_CountPeriods (t_period, u32_anchor, u32_aligned, 0xFFFF, &u16_index) ;
+      u32_index = u16_index ;
+      break ;
+
+    case e_weekEvent:
+      // Weeks since monday 5 January 1970 (day 4), in local time
+      RTC_Seconds2Date (u32_aligned, &t_dateTime) ;
+      u32_anchor = u32_aligned + RTC_LOCAL ;
+      if (t_dateTime.b_daylightSavingTime != FALSE)
+      {
+        u32_anchor += RTC_SECS_PER_HOUR ;
+      }
+      u32_index = (u32_anchor / RTC_SECS_PER_DAY - 4UL) / RTC_DAYS_PER_WEEK ;
+      break ;
+
+    default:
+      RTC_Seconds2Date (u32_aligned, &t_dateTime) ;
+      u32_index = t_dateTime.u16_year - 1970 ;
+      break ;
+  }
+
+  if (u16_factor > 1)
+  {
+    RTC_AddPeriods (t_period, u32_aligned, -(long)(u32_index % u16_factor), pu32_aligned) ;
+  }
+  else
+  {
+    *pu32_aligned = u32_aligned ;
+  }
+
+  return ;
+}
+// End: RTC_AlignGroup
+
+
+void RTC_AddPeriods (t_event_enum    const t_period,
+                     unsigned long   const u32_seconds,
+                     long            const s32_periods,
+                     unsigned long * const pu32_seconds)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_AddPeriods                                             //
+//                 - Moves an aligned time a number of periods forward (or    //
+//                   back if negative). Days and up are counted in local      //
+//                   time, so the result is a local midnight even across a    //
+//                   DST change. Months and years follow the calendar         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  RTC_DateTime_struct t_dateTime ;
+  unsigned long       u32_localSeconds ;
+  long                s32_months ;
+
+  switch (t_period)
+  {
+    case e_dayEvent:
+    case e_weekEvent:
+      RTC_Seconds2Date (u32_seconds, &t_dateTime) ;
+      u32_localSeconds = u32_seconds + RTC_LOCAL ;
+      if (t_dateTime.b_daylightSavingTime != FALSE)
+      {
+        u32_localSeconds += RTC_SECS_PER_HOUR ;
+      }
+      if (t_period == e_weekEvent)
+      {
+        u32_localSeconds += s32_periods * (long)(RTC_DAYS_PER_WEEK * RTC_SECS_PER_DAY) ;
+      }
+      else
+      {
+        u32_localSeconds += s32_periods * (long)RTC_SECS_PER_DAY ;
+      }
+      RTC_Local2Seconds (u32_localSeconds, pu32_seconds) ;
+      break ;
+
+    case e_monthEvent:
+    case e_yearEvent:
+      RTC_Seconds2Date (u32_seconds, &t_dateTime) ;
+      s32_months = (long)t_dateTime.u16_year * 12L + (t_dateTime.u8_month - 1) ;
+      if (t_period == e_yearEvent)
+      {
+        s32_months += s32_periods * 12L ;
+      }
+      else
+      {
+        s32_months += s32_periods ;
+      }
+      t_dateTime.u16_year  = s32_months / 12L ;
+      t_dateTime.u8_month  = (s32_months % 12L) + 1 ;
+      RTC_Date2Seconds (&t_dateTime, &u32_localSeconds) ;
+      RTC_Local2Seconds (u32_localSeconds, pu32_seconds) ;
+      break ;
+
+    default:
+      *pu32_seconds = u32_seconds + s32_periods * (long)RTC_PeriodLength (t_period) ;
+      break ;
+  }
+
+  return ;
+}
+// End: RTC_AddPeriods
+
+
+void RTC_CountPeriods (t_event_enum     const t_period,
+                       unsigned long    const u32_from,
+                       unsigned long    const u32_to,
+                       unsigned short   const u16_maxPeriods,
+                       unsigned short * const pu16_nrOfPeriods)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_CountPeriods                                           //
+//                 - Counts the whole periods from the aligned time u32_from  //
+//                   up to u32_to, stopping at u16_maxPeriods                 //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long  u32_boundary ;
+  unsigned long  u32_nrOfPeriods ;
+
+  if (u32_to <= u32_from)
+  {
+    *pu16_nrOfPeriods = 0 ;
+  }
+  else if ( (t_period == e_secondEvent ) ||
+            (t_period == e_minuteEvent ) ||
+            (t_period == e_quarterEvent) ||
+            (t_period == e_hourEvent   )    )
+  {
+    // Fixed length periods can simply be divided
+    u32_nrOfPeriods = (u32_to - u32_from) / RTC_PeriodLength (t_period) ;
+    if (u32_nrOfPeriods > u16_maxPeriods)
+    {
+      u32_nrOfPeriods = u16_maxPeriods ;
+    }
+    *pu16_nrOfPeriods = u32_nrOfPeriods ;
+  }
+  else
+  {
+    // Days and up vary in length, step through the calendar
+    u32_boundary      = u32_from ;
+    *pu16_nrOfPeriods = 0 ;
+    for (;;)
+    {
+      RTC_AddPeriods (t_period, u32_boundary, 1, &u32_boundary) ;
+      if ( (u32_boundary       >  u32_to        ) ||
+           (*pu16_nrOfPeriods  >= u16_maxPeriods)    )
+      {
+        break ;
+      }
+      (*pu16_nrOfPeriods) ++ ;
+    }
+  }
+
+  return ;
+}
+// End: RTC_CountPeriods
+
+
+void RTC_NextDate (t_event_enum          const t_period,
+                   unsigned long       * const pu32_seconds,
+                   RTC_DateTime_struct * const pt_dateTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_NextDate                                               //
+//                 - Moves an aligned time and its date, as filled out by     //
+//                   RTC_Seconds2Date, one period forward. The date is        //
+//                   stepped rather than converted from 1970 again, for       //
+//                   walking through a range of buckets. Periods up to an     //
+//                   hour are converted anyway when they pass midnight, or    //
+//                   on a day DST may change                                  //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long       u32_secondOfDay ;
+  unsigned short      u16_nrOfDays ;
+  BOOL                b_daylightSavingTime = pt_dateTime->b_daylightSavingTime ;
+
+  switch (t_period)
+  {
+    case e_dayEvent:
+    case e_weekEvent:
+    case e_monthEvent:
+    case e_yearEvent:
+      // Step the local date, the time stays midnight
+      if (t_period == e_monthEvent)
+      {
+        u16_nrOfDays = RTC_DaysPerMonth (pt_dateTime->u8_month, pt_dateTime->u16_year) ;
+        pt_dateTime->u8_month ++ ;
+      }
+      else if (t_period == e_yearEvent)
+      {
+        u16_nrOfDays = RTC_LEAPYEAR(pt_dateTime->u16_year) ? 366 : 365 ;
+        pt_dateTime->u16_year ++ ;
+      }
+      else
+      {
+        u16_nrOfDays = (t_period == e_weekEvent) ? RTC_DAYS_PER_WEEK : 1 ;
+        pt_dateTime->u8_day += u16_nrOfDays ;
+        if (pt_dateTime->u8_day > RTC_DaysPerMonth (pt_dateTime->u8_month, pt_dateTime->u16_year))
+        {
+          pt_dateTime->u8_day -= RTC_DaysPerMonth (pt_dateTime->u8_month, pt_dateTime->u16_year) ;
+          pt_dateTime->u8_month ++ ;
+        }
+      }
+      if (pt_dateTime->u8_month > 12)
+      {
+        pt_dateTime->u8_month = 1 ;
+        pt_dateTime->u16_year ++ ;
+      }
+      pt_dateTime->u8_dayOfWeek         = (pt_dateTime->u8_dayOfWeek + u16_nrOfDays) % RTC_DAYS_PER_WEEK ;
+      pt_dateTime->b_daylightSavingTime = RTC_DST(pt_dateTime) ;
+
+      // Local midnights are whole days apart, the RTC time moves with DST
+      *pu32_seconds += (unsigned long)u16_nrOfDays * RTC_SECS_PER_DAY ;
+      if ( (b_daylightSavingTime              != FALSE) &&
+           (pt_dateTime->b_daylightSavingTime == FALSE)    )
+      {
+        *pu32_seconds += RTC_SECS_PER_HOUR ;
+      }
+      else if ( (b_daylightSavingTime              == FALSE) &&
+                (pt_dateTime->b_daylightSavingTime != FALSE)    )
+      {
+        *pu32_seconds -= RTC_SECS_PER_HOUR ;
+      }
+      break ;
+
+    default:
+      *pu32_seconds  += RTC_PeriodLength (t_period) ;
+      u32_secondOfDay = (unsigned long)pt_dateTime->u8_hour   * RTC_SECS_PER_HOUR +
+                        (unsigned long)pt_dateTime->u8_minute * RTC_SECS_PER_MIN  +
+                        (unsigned long)pt_dateTime->u8_second +
+                        RTC_PeriodLength (t_period) ;
+      if ( (u32_secondOfDay           >= RTC_SECS_PER_DAY) ||
+           ( ( (pt_dateTime->u8_month ==  3) ||
+               (pt_dateTime->u8_month == 10)    ) &&
+             (pt_dateTime->u8_day       >= 25) &&
+             (pt_dateTime->u8_dayOfWeek ==  0)    )    )
+      {
+        RTC_Seconds2Date (*pu32_seconds, pt_dateTime) ;
+      }
+      else
+      {
+        pt_dateTime->u8_hour   =  u32_secondOfDay / RTC_SECS_PER_HOUR ;
+        pt_dateTime->u8_minute = (u32_secondOfDay % RTC_SECS_PER_HOUR) / RTC_SECS_PER_MIN ;
+        pt_dateTime->u8_second =  u32_secondOfDay % RTC_SECS_PER_MIN ;
+      }
+      break ;
+  }
+
+  return ;
+}
+// End: RTC_NextDate
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Local Implementations                                                      //
 ////////////////////////////////////////////////////////////////////////////////
@@ -412,9 +742,6 @@ static PROCESS RTC_Process (void)
   TMR_ticks_struct    t_syncTimeOut ;
   RTC_DateTime_struct t_oldDateTime ;
   RTC_DateTime_struct t_curDateTime ;
-  unsigned char       u8_index ;
-
-
   unsigned long       u32_curTime ;
   unsigned long       u32_oldTime ;
   unsigned long       u32_curDateTimeSecs ;
@@ -435,54 +762,50 @@ static PROCESS RTC_Process (void)
       RTC_Seconds2Date (u32_curTime, &t_curDateTime) ;
 
       // Send out the 'second-events'
-      for (u8_index = 0; u8_index < RTC_MAX_EVENTS; u8_index ++)
-      {
-        if ( (pt_client[u8_index].t_event  == e_secondEvent) &&
-             (pt_client[u8_index].t_procId != NULL         )    )
-        {
-          (void)KE_MBoxSend (pt_client[u8_index].t_procId, pt_client[u8_index].pt_instance) ;
-        }
-      }
+      RTC_SendEvent (e_secondEvent) ;
 
       // Send out the 'minute-events'
       if (t_curDateTime.u8_minute != t_oldDateTime.u8_minute)
       {
-        for (u8_index = 0; u8_index < RTC_MAX_EVENTS; u8_index ++)
+        RTC_SendEvent (e_minuteEvent) ;
+
+        // Send out the 'quarter-events'
+        if ((t_curDateTime.u8_minute % 15) == 0)
         {
-          if ( (pt_client[u8_index].t_event  == e_minuteEvent) &&
-               (pt_client[u8_index].t_procId != NULL         )    )
-          {
-            (void)KE_MBoxSend (pt_client[u8_index].t_procId, pt_client[u8_index].pt_instance) ;
-          }
+          RTC_SendEvent (e_quarterEvent) ;
         }
       }
 
       // Send out the 'hour-events'
       if (t_curDateTime.u8_hour != t_oldDateTime.u8_hour)
       {
-        for (u8_index = 0; u8_index < RTC_MAX_EVENTS; u8_index ++)
-        {
-          if ( (pt_client[u8_index].t_event  == e_hourEvent) &&
-               (pt_client[u8_index].t_procId != NULL         )    )
-          {
-            (void)KE_MBoxSend (pt_client[u8_index].t_procId, pt_client[u8_index].pt_instance) ;
-          }
-        }
+        RTC_SendEvent (e_hourEvent) ;
       }
 
       // Send out the 'day-events'
       if (t_curDateTime.u8_day != t_oldDateTime.u8_day)
       {
-        for (u8_index = 0; u8_index < RTC_MAX_EVENTS; u8_index ++)
+        RTC_SendEvent (e_dayEvent) ;
+
+        // Send out the 'week-events', weeks start on monday
+        if (t_curDateTime.u8_dayOfWeek == 1)
         {
-          if ( (pt_client[u8_index].t_event  == e_dayEvent) &&
-               (pt_client[u8_index].t_procId != NULL         )    )
-          {
-            (void)KE_MBoxSend (pt_client[u8_index].t_procId, pt_client[u8_index].pt_instance) ;
-          }
+          RTC_SendEvent (e_weekEvent) ;
         }
       }
 
+      // Send out the 'month-events'
+      if (t_curDateTime.u8_month != t_oldDateTime.u8_month)
+      {
+        RTC_SendEvent (e_monthEvent) ;
+      }
+
+      // Send out the 'year-events'
+      if (t_curDateTime.u16_year != t_oldDateTime.u16_year)
+      {
+        RTC_SendEvent (e_yearEvent) ;
+      }
+
       // Update the edge-detection buffer
       u32_oldTime   = u32_curTime ;
       t_oldDateTime = t_curDateTime ;
@@ -585,3 +908,124 @@ static void RTC_WriteDateTime (RTC_DateTime_struct const * const pt_curDateTime)
 
   return ;
 }
+
+
+static void RTC_Local2Seconds (unsigned long   const u32_localSeconds,
+                               unsigned long * const pu32_seconds)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_Local2Seconds                                          //
+//                 - Converts local time to RTC time. DST changes at 02:00,   //
+//                   so the hour before the result tells if DST applies. The  //
+//                   lost and doubled hour on the changeover night are not    //
+//                   resolved                                                 //
+////////////////////////////////////////////////////////////////////////////////
+{
+  RTC_DateTime_struct t_dateTime ;
+  unsigned long       u32_seconds = u32_localSeconds - RTC_LOCAL ;
+
+  RTC_Seconds2Date (u32_seconds - RTC_SECS_PER_HOUR, &t_dateTime) ;
+  if (t_dateTime.b_daylightSavingTime != FALSE)
+  {
+    u32_seconds -= RTC_SECS_PER_HOUR ;
+  }
+
+  *pu32_seconds = u32_seconds ;
+
+  return ;
+}
+// End: RTC_Local2Seconds
+
+
+static unsigned long RTC_PeriodLength (t_event_enum const t_period)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_PeriodLength                                           //
+//                 - Returns the number of seconds of a fixed length period   //
+//                   (up to a day; longer periods depend on the calendar)     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long u32_length ;
+
+  switch (t_period)
+  {
+    case e_minuteEvent:
+      u32_length = RTC_SECS_PER_MIN ;
+      break ;
+
+    case e_quarterEvent:
+      u32_length = RTC_SECS_PER_QUARTER ;
+      break ;
+
+    case e_hourEvent:
+      u32_length = RTC_SECS_PER_HOUR ;
+      break ;
+
+    case e_dayEvent:
+      u32_length = RTC_SECS_PER_DAY ;
+      break ;
+
+    default:
+      u32_length = 1UL ;
+      break ;
+  }
+
+  return (u32_length) ;
+}
+// End: RTC_PeriodLength
+
+
+static unsigned char RTC_DaysPerMonth (unsigned char  const u8_month,
+                                       unsigned short const u16_year)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_DaysPerMonth                                           //
+//                 - Returns the number of days of a month (1 = january)      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char u8_daysPerMonth ;
+
+  switch (u8_month)
+  {
+    case 1:   case 3:   case 5:   case 7:   case 8:   case 10: case 12:
+      u8_daysPerMonth = 31 ;
+      break ;
+
+    case 4:   case 6:   case 9:   case 11:
+      u8_daysPerMonth = 30 ;
+      break ;
+
+    default:
+      if (RTC_LEAPYEAR(u16_year))
+      {
+        u8_daysPerMonth = 29 ;
+      }
+      else
+      {
+        u8_daysPerMonth = 28 ;
+      }
+      break ;
+  }
+
+  return (u8_daysPerMonth) ;
+}
+// End: RTC_DaysPerMonth
+
+
+static void RTC_SendEvent (t_event_enum const t_event)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       RTC_SendEvent                                              //
+//                 - Sends an event to all clients registered for it          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned char u8_index ;
+
+  for (u8_index = 0; u8_index < RTC_MAX_EVENTS; u8_index ++)
+  {
+    if ( (pt_client[u8_index].t_event  == t_event) &&
+         (pt_client[u8_index].t_procId != NULL   )    )
+    {
+      (void)KE_MBoxSend (pt_client[u8_index].t_procId, pt_client[u8_index].pt_instance) ;
+    }
+  }
+
+  return ;
+}
+// End: RTC_SendEvent
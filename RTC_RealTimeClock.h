@@ -45,10 +45,14 @@ typedef struct
 
 typedef enum
 {
-  e_secondEvent = 0,
-  e_minuteEvent = 1,
-  e_hourEvent   = 2,
-  e_dayEvent    = 3
+  e_secondEvent  = 0,
+  e_minuteEvent  = 1,
+  e_hourEvent    = 2,
+  e_dayEvent     = 3,
+  e_quarterEvent = 4,                                 // Every 15 minutes
+  e_weekEvent    = 5,                                 // Monday, local midnight
+  e_monthEvent   = 6,
+  e_yearEvent    = 7
 } t_event_enum ;
 
 
@@ -74,5 +78,29 @@ void        RTC_Seconds2UTC         (unsigned long               const u32_secon
 void        RTC_Date2Seconds        (RTC_DateTime_struct const * const pt_dateTime,
                                      unsigned long             * const pu32_seconds) ;
 
+void        RTC_AlignTime           (t_event_enum                const t_period,
+                                     unsigned long               const u32_seconds,
+                                     unsigned long             * const pu32_aligned) ;
+
+void        RTC_AlignGroup          (t_event_enum                const t_period,
+                                     unsigned short              const u16_factor,
+                                     unsigned long               const u32_seconds,
+                                     unsigned long             * const pu32_aligned) ;
+
+void        RTC_AddPeriods          (t_event_enum                const t_period,
+                                     unsigned long               const u32_seconds,
+                                     long                        const s32_periods,
+                                     unsigned long             * const pu32_seconds) ;
+
+void        RTC_CountPeriods        (t_event_enum                const t_period,
+                                     unsigned long               const u32_from,
+                                     unsigned long               const u32_to,
+                                     unsigned short              const u16_maxPeriods,
+                                     unsigned short            * const pu16_nrOfPeriods) ;
+
+void        RTC_NextDate            (t_event_enum                const t_period,
+                                     unsigned long             * const pu32_seconds,
+                                     RTC_DateTime_struct       * const pt_dateTime) ;
+
 
 #endif //RTC_REALTIMECLOCK_H
@@ -27,6 +27,7 @@
 #define B7_MASK           0x80
 
 #define IRQ_EOC_EN  (B0_MASK)
+#define IRQ_EOC     (B0_MASK)
 
 #define TIM_EN      (B0_MASK)
 #define RLD         (B1_MASK)
@@ -43,6 +44,7 @@
 #define BRK_STOP    (B7_MASK)
 
 #define TICKS_PER_10_US       (125)
+#define TMR3_MAX_SUB_US       (999)                     // Highest sub-millisecond value
 #define TMR3_RELOAD_VALUE     (0x30D4)
 #define T3_max_value          0xFFFF
 #define nsecs_per_T3_inc      400
@@ -65,6 +67,7 @@ static       TMR_ticks_struct   t_currentTicks ;
 
 static void ISR_Timer3       (void) ;
 static void TMR_CurrentTicks (TMR_ticks_struct * const currTicks_ptr) ;
+static void TMR_Tick         (void) ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -281,6 +284,66 @@ BOOL TMR_CheckTimeout (TMR_ticks_struct const * const pt_timeout)
 // End: TMR_CheckTimeout
 
 
+unsigned long TMR_TimeoutLeft (TMR_ticks_struct const * const pt_timeout)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_TimeoutLeft                                            //
+//                 - Calculate the ticks left until a given timeout expires,  //
+//                   0 if it has expired already                              //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long       left        = 0 ;
+  TMR_ticks_struct    currentTime ;
+
+  // Fetch the current time
+  TMR_CurrentTicks (&currentTime) ;
+
+  // Check Most Significant Short for past timeouts
+  if (pt_timeout->t_ticksCalc.u16_msShort >= currentTime.t_ticksCalc.u16_msShort)
+  {
+    switch (pt_timeout->t_ticksCalc.u16_msShort - currentTime.t_ticksCalc.u16_msShort)
+    {
+      case 0: // Most Significant Short is the same
+        if (pt_timeout->t_ticksCalc.u32_lsLong > currentTime.t_ticksCalc.u32_lsLong)
+        {
+          // Future timeout: Just subtract the Least Significant LWords
+          left = pt_timeout->t_ticksCalc.u32_lsLong - currentTime.t_ticksCalc.u32_lsLong ;
+        }
+        else
+        {
+          // Past or current timeout
+          left = 0 ;
+        }
+        break ;
+
+      case 1: // Most Significant Short is ahead just by 1
+        if (pt_timeout->t_ticksCalc.u32_lsLong < currentTime.t_ticksCalc.u32_lsLong)
+        {
+          // The Least Significant LWord of the timeout has only wrapped around
+          left = (0xFFFFFFFF - (currentTime.t_ticksCalc.u32_lsLong - pt_timeout->t_ticksCalc.u32_lsLong)) + 1 ;
+        }
+        else
+        {
+          // The timeout lies beyond the maximum
+          left = 0xFFFFFFFF ;
+        }
+        break ;
+
+      default: // Most Significant Short is ahead by two or more
+        left = 0xFFFFFFFF ;
+        break ;
+    }
+  }
+  else
+  {
+    // Past timeout
+    left = 0 ;
+  }
+
+  return (left) ;
+}
+// End: TMR_TimeoutLeft
+
+
 void TMR_SetTimeStamp (TMR_ticks_struct * const pt_timestamp)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       TMR_SetTimeStamp                                           //
@@ -360,6 +423,184 @@ unsigned long TMR_TimeStampAge (TMR_ticks_struct const * const pt_timestamp)
 // End: TMR_TimeStampAge
 
 
+void TMR_SetMicroStamp (TMR_micro_struct * const pt_microstamp)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_SetMicroStamp                                          //
+//                 - Take a time stamp in microseconds, from process context  //
+////////////////////////////////////////////////////////////////////////////////
+{
+  // An interrupt must not take a stamp between reading and counting a reload
+  KE_CriticalBegin () ;
+
+  TMR_SetMicroStampIsr (pt_microstamp) ;
+
+  KE_CriticalEnd () ;
+
+  return ;
+}
+// End: TMR_SetMicroStamp
+
+
+void TMR_SetMicroStampIsr (TMR_micro_struct * const pt_microstamp)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_SetMicroStampIsr                                       //
+//                 - Take a time stamp in microseconds, from the millisecond  //
+//                   ticks and the running TMR3 count (INTERRUPT CONTEXT!)    //
+//                 - A TMR3 reload whose interrupt is still pending is seen   //
+//                   in its end of count flag. Reading the flag clears it, so //
+//                   the tick is counted here and the ISR skips it            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TMR_ticks_struct    t_ticks ;
+  unsigned char       u8_tmr3_dr[2] ;
+  unsigned short      u16_tmr3 ;
+  unsigned char       u8_tickByte ;
+  unsigned long       u32_lowPart ;
+  unsigned long       u32_midPart ;
+  unsigned long       u32_subUs ;
+
+  // Read the ticks and TMR3 until no tick occurred in between
+  do
+  {
+    if ((TMR3_IIR & IRQ_EOC) != 0)
+    {
+      TMR_Tick () ;
+    }
+    u8_tickByte   = t_currentTicks.u8_ticksByte[0] ;
+    u8_tmr3_dr[0] = TMR3_DR_L ; // Read the lower byte first, this will also latch the higher byte
+    u8_tmr3_dr[1] = TMR3_DR_H ; // Read the latched higher byte
+    if ((TMR3_IIR & IRQ_EOC) != 0)
+    {
+      // Reloaded while reading: Count it and read again
+      TMR_Tick () ;
+    }
+    TMR_CurrentTicks (&t_ticks) ;
+  } while (t_ticks.u8_ticksByte[0] != u8_tickByte) ;
+
+  // TMR3 counts down from the reload value at 12.5 counts per microsecond
+  u16_tmr3  = ((unsigned short)u8_tmr3_dr[1] << 8) | u8_tmr3_dr[0] ;
+  u32_subUs = ((unsigned long)(TMR3_RELOAD_VALUE - u16_tmr3) * 10) / TICKS_PER_10_US ;
+  if (u32_subUs > TMR3_MAX_SUB_US)
+  {
+    u32_subUs = TMR3_MAX_SUB_US ;
+  }
+
+  // Multiply the 48-bit ticks by 1000, 16 bits of the Long-part at a time
+  u32_lowPart = (t_ticks.t_ticksCalc.u32_lsLong & 0xFFFF) * TMR_US_PER_MS ;
+  u32_midPart = (t_ticks.t_ticksCalc.u32_lsLong >> 16)    * TMR_US_PER_MS ;
+
+  pt_microstamp->u32_lsLong = u32_lowPart + (u32_midPart << 16) ;
+  pt_microstamp->u32_msLong = (u32_midPart >> 16) +
+                              ((unsigned long)t_ticks.t_ticksCalc.u16_msShort * TMR_US_PER_MS) ;
+  if (pt_microstamp->u32_lsLong < u32_lowPart)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+
+  // Add the sub-millisecond part
+  pt_microstamp->u32_lsLong += u32_subUs ;
+  if (pt_microstamp->u32_lsLong < u32_subUs)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+
+  return ;
+}
+// End: TMR_SetMicroStampIsr
+
+
+void TMR_PostponeMicroStamp (TMR_micro_struct * const pt_microstamp,
+                             unsigned long      const postpone_us)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_PostponeMicroStamp                                     //
+//                 - Add the requested microseconds to the given time stamp   //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long       tempTicksWord ;  // Rollover detection buffer
+
+  // Temporarilly store the Long-part of the given time stamp
+  tempTicksWord = pt_microstamp->u32_lsLong ;
+
+  // Add the microseconds to the Long-part of the given time stamp
+  pt_microstamp->u32_lsLong += postpone_us ;
+
+  // Check if the Long-part has rolled over and increase
+  // the Most Significant part if so
+  if (pt_microstamp->u32_lsLong < tempTicksWord)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+
+  return ;
+}
+// End: TMR_PostponeMicroStamp
+
+
+unsigned long TMR_MicroStampDiff (TMR_micro_struct const * const pt_newStamp,
+                                  TMR_micro_struct const * const pt_oldStamp)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_MicroStampDiff                                         //
+//                 - Calculate the microseconds between two time stamps. The  //
+//                   result saturates at 0 and at 0xFFFFFFFF (71 minutes)     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long       diff = 0 ;
+
+  // Check Most Significant LWord for reversed time stamps
+  if (pt_newStamp->u32_msLong >= pt_oldStamp->u32_msLong)
+  {
+    switch (pt_newStamp->u32_msLong - pt_oldStamp->u32_msLong)
+    {
+      case 0: // Most Significant LWord is the same
+        if (pt_newStamp->u32_lsLong > pt_oldStamp->u32_lsLong)
+        {
+          diff = pt_newStamp->u32_lsLong - pt_oldStamp->u32_lsLong ;
+        }
+        else
+        {
+          diff = 0 ;
+        }
+        break ;
+
+      case 1: // Most Significant LWord is increased just by 1
+        if (pt_newStamp->u32_lsLong < pt_oldStamp->u32_lsLong)
+        {
+          // The Least Significant LWord has only wrapped around
+          diff = (0xFFFFFFFF - (pt_oldStamp->u32_lsLong - pt_newStamp->u32_lsLong)) + 1 ;
+        }
+        else
+        {
+          diff = 0xFFFFFFFF ;
+        }
+        break ;
+
+      default: // Most Significant LWord is increased by two of more
+        diff = 0xFFFFFFFF ;
+        break ;
+    }
+  }
+
+  return (diff) ;
+}
+// End: TMR_MicroStampDiff
+
+
+unsigned long TMR_MicroStampAge (TMR_micro_struct const * const pt_microstamp)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_MicroStampAge                                          //
+//                 - Calculate the microseconds between now and the time the  //
+//                   given time stamp was set                                 //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TMR_micro_struct    t_now ;
+
+  TMR_SetMicroStamp (&t_now) ;
+
+  return (TMR_MicroStampDiff (&t_now, pt_microstamp)) ;
+}
+// End: TMR_MicroStampAge
+
+
 void TMR_Delay (unsigned long const delay)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       TMR_Delay                                                  //
@@ -479,9 +720,25 @@ static void ISR_Timer3 (void)
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
-  // Read Interrupt Identification Register to clear pending TMR3 interrupts
-  const unsigned char tmr3_iir_value = TMR3_IIR ;
+  // Read Interrupt Identification Register to clear pending TMR3 interrupts.
+  // A time stamp taken since the reload may have counted the tick already.
+  if ((TMR3_IIR & IRQ_EOC) != 0)
+  {
+    TMR_Tick () ;
+  }
+
+  return ;
+}
+// End: ISR_Timer0
+
 
+static void TMR_Tick (void)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TMR_Tick                                                   //
+//                 - Increment the 40-bit ticks counter by one millisecond    //
+//                 - Only called with interrupts disabled                     //
+////////////////////////////////////////////////////////////////////////////////
+{
   // There's a neater way to increase the counter, but this is the quickst.
   // Since this occurs ever millisecond, we'll go for the quickest sollution.
   t_currentTicks.u8_ticksByte[0] ++ ; // Takes 1.8us @ 50MHz
@@ -513,4 +770,4 @@ static void ISR_Timer3 (void)
 
   return ;
 }
-// End: ISR_Timer0
+// End: TMR_Tick
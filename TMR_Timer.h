@@ -25,6 +25,7 @@
 #define TMR_SECOND        (1000UL)                    // Number of timer ticks per second
 #define TMR_MINUTE        (60000UL)                   // Number of timer ticks per minute
 #define TMR_HOUR          (3600000UL)                 // Number of timer ticks per hour
+#define TMR_US_PER_MS     (1000UL)                    // Number of microseconds per timer tick
 
 
 // TMR types
@@ -43,6 +44,13 @@ typedef union
   TMR_calc_struct   t_ticksCalc ;
 } TMR_ticks_struct ;
 
+// Storage type used for microsecond time stamps (64-bit, no native type available)
+typedef struct
+{
+  unsigned long     u32_lsLong ;
+  unsigned long     u32_msLong ;
+} TMR_micro_struct ;
+
 
 TMR_status      TMR_Initialize      (void) ;
 
@@ -60,10 +68,24 @@ void            TMR_NeverTimeout    (TMR_ticks_struct       * const pt_timeout)
 
 BOOL            TMR_CheckTimeout    (TMR_ticks_struct const * const pt_timeout) ;
 
+unsigned long   TMR_TimeoutLeft     (TMR_ticks_struct const * const pt_timeout) ;
+
 void            TMR_SetTimeStamp    (TMR_ticks_struct       * const pt_timestamp) ;
 
 unsigned long   TMR_TimeStampAge    (TMR_ticks_struct const * const pt_timestamp) ;
 
+void            TMR_SetMicroStamp   (TMR_micro_struct       * const pt_microstamp) ;
+
+void            TMR_SetMicroStampIsr(TMR_micro_struct       * const pt_microstamp) ;
+
+void            TMR_PostponeMicroStamp (TMR_micro_struct    * const pt_microstamp,
+                                     unsigned long            const postpone_us) ;
+
+unsigned long   TMR_MicroStampDiff  (TMR_micro_struct const * const pt_newStamp,
+                                     TMR_micro_struct const * const pt_oldStamp) ;
+
+unsigned long   TMR_MicroStampAge   (TMR_micro_struct const * const pt_microstamp) ;
+
 void            TMR_Delay           (unsigned long            const delay) ;
 
 void            TMR_MicroDelay      (unsigned short           const delay_us) ;
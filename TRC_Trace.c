@@ -0,0 +1,673 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : TRC_Trace.c
+// Function: Pulse trace recorder and replay module
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#define TRC_TRACE_C
+#include <kernel.h>
+#include "TMR_Timer.h"
+#include "PHD_PulseHandler.h"
+#include "TRC_Trace.h"
+
+#define TRC_SIGNATURE         ('TRC')
+#define TRC_MAX_GAP_MS        (4294967UL)                 // Longest gap record; fits a long in us
+#define TRC_MS_PER_SECOND     (1000UL)
+#define TRC_SLEEP_UNIT_US     (10000UL)                   // Unit of KE_TaskSleep100, in us
+
+#define TRC_PTR_INVALID(p)    (p->u24_signature != TRC_SIGNATURE)
+
+////////////////////////////////////////////////////////////////////////////////
+// Global Data                                                                //
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+  unsigned int        u24_signature ;
+  TRC_record *        pt_record ;
+  unsigned short      u16_nrOfRecords ;
+  unsigned short      u16_oldestRecord ;                    // Index of the oldest record
+  unsigned short      u16_usedRecords ;                     // Number of records in use
+  TMR_micro_struct    t_baseTime ;                          // Time the oldest record is relative to
+  TMR_micro_struct    t_lastTime ;                          // Time of the newest record
+  BOOL                b_recording ;
+} TRC_instance_struct ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local Prototypes                                                           //
+////////////////////////////////////////////////////////////////////////////////
+
+static void TRC_AddRecord (TRC_instance_struct * const pt_this,
+                           TRC_record            const t_record) ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Global Implementations                                                     //
+////////////////////////////////////////////////////////////////////////////////
+
+TRC_status TRC_Create (TRC_handle     * const ppt_instance,
+                       unsigned short   const u16_nrOfRecords)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       Trace construction routine                                 //
+//                 - Creates an instance                                      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status            result      = TRC_OK ;
+  TRC_instance_struct * pt_this ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if ( (ppt_instance    == NULL) ||
+         (u16_nrOfRecords == 0   )    )
+    {
+      (void)xc_printf ("TRC_Create: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Allocate memory for this instance
+    pt_this = getmem (sizeof(TRC_instance_struct)) ;
+    if (pt_this == NULL)
+    {
+      (void)xc_printf ("TRC_Create: Memory error (instance).\n") ;
+      result = TRC_ERR_MEMORY ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Allocate memory for the records
+    pt_this->pt_record = getmem (u16_nrOfRecords * sizeof(TRC_record)) ;
+    if (pt_this->pt_record == NULL)
+    {
+      // Clean up
+      (void)freemem (pt_this, sizeof(TRC_instance_struct)) ;
+
+      (void)xc_printf ("TRC_Create: Memory error (records).\n") ;
+      result = TRC_ERR_MEMORY ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Initialize global variables of this instance
+    pt_this->u24_signature    = TRC_SIGNATURE ;
+    pt_this->u16_nrOfRecords  = u16_nrOfRecords ;
+    pt_this->u16_oldestRecord = 0 ;
+    pt_this->u16_usedRecords  = 0 ;
+    pt_this->b_recording      = FALSE ;
+
+    // Fill out the instance pointer
+    *ppt_instance = pt_this ;
+  }
+
+  return (result) ;
+}
+// End: TRC_Create
+
+
+TRC_status TRC_Delete (TRC_handle const pt_instance)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       Trace destruction routine                                  //
+//                 - Destroys an instance                                     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if (pt_instance == NULL)
+    {
+      (void)xc_printf ("TRC_Delete: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if (TRC_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("TRC_Delete: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Invalidate the pointer
+    pt_this->b_recording   = FALSE ;
+    pt_this->u24_signature = 0x000000 ;
+
+    // Return the memory to the memory manager
+    (void)freemem (pt_this->pt_record, pt_this->u16_nrOfRecords * sizeof(TRC_record)) ;
+    (void)freemem (pt_this, sizeof(TRC_instance_struct)) ;
+  }
+
+  return (result) ;
+}
+// End: TRC_Delete
+
+
+TRC_status TRC_SetRecording (TRC_handle const pt_instance,
+                             BOOL       const b_recording)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_SetRecording                                           //
+//                 - Start or stop recording. Starting discards the records   //
+//                   of a previous recording                                  //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if (pt_instance == NULL)
+    {
+      (void)xc_printf ("TRC_SetRecording: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if (TRC_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("TRC_SetRecording: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if ( (result               == TRC_OK) &&
+       (b_recording          != FALSE ) &&
+       (pt_this->b_recording == FALSE )    )
+  {
+    // Start with an empty trace, relative to now
+    pt_this->u16_oldestRecord = 0 ;
+    pt_this->u16_usedRecords  = 0 ;
+    TMR_SetMicroStamp (&(pt_this->t_baseTime)) ;
+    pt_this->t_lastTime       = pt_this->t_baseTime ;
+  }
+
+  if (result == TRC_OK)
+  {
+    pt_this->b_recording = b_recording ;
+  }
+
+  return (result) ;
+}
+// End: TRC_SetRecording
+
+
+TRC_status TRC_Record (TRC_handle               const pt_instance,
+                       unsigned char            const u8_channel,
+                       TMR_micro_struct const * const pt_pulseTime)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_Record                                                 //
+//                 - Record a pulse of a channel (INTERRUPT CONTEXT!)         //
+//                 - When the trace is full, the oldest record is dropped     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+  unsigned long               u32_delta ;
+  unsigned long               u32_gap ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance  == NULL            ) ||
+         (u8_channel   >= TRC_MAX_CHANNELS) ||
+         (pt_pulseTime == NULL            )    )
+    {
+      (void)xc_printf ("TRC_Record: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if (TRC_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("TRC_Record: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if ( (result               == TRC_OK) &&
+       (pt_this->b_recording != FALSE )    )
+  {
+    // Bridge long pauses with gap records, in ms
+    u32_delta = TMR_MicroStampDiff (pt_pulseTime, &(pt_this->t_lastTime)) ;
+    while (u32_delta > TRC_DELTA_MASK)
+    {
+      u32_gap = u32_delta / TMR_US_PER_MS ;
+      if (u32_gap > TRC_MAX_GAP_MS)
+      {
+        u32_gap = TRC_MAX_GAP_MS ;
+      }
+      TRC_AddRecord (pt_this, ((TRC_record)TRC_GAP_CHANNEL << TRC_CHANNEL_SHIFT) | u32_gap) ;
+      TMR_PostponeMicroStamp (&(pt_this->t_lastTime), u32_gap * TMR_US_PER_MS) ;
+
+      u32_delta = TMR_MicroStampDiff (pt_pulseTime, &(pt_this->t_lastTime)) ;
+    }
+
+    // Record the pulse itself
+    TRC_AddRecord (pt_this, ((TRC_record)u8_channel << TRC_CHANNEL_SHIFT) | u32_delta) ;
+    TMR_PostponeMicroStamp (&(pt_this->t_lastTime), u32_delta) ;
+  }
+
+  return (result) ;
+}
+// End: TRC_Record
+
+
+TRC_status TRC_CopyRecords (TRC_handle                 const pt_instance,
+                            TMR_micro_struct         * const pt_baseTime,
+                            TRC_record               * const pt_records,
+                            unsigned short             const u16_maxRecords,
+                            unsigned short           * const pu16_nrOfRecords)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_CopyRecords                                            //
+//                 - Copy the records, oldest first, and the time the first   //
+//                   record is relative to. Recording must be stopped         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+  unsigned short              u16_index ;
+  unsigned short              u16_record ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance      == NULL) ||
+         (pt_baseTime      == NULL) ||
+         (pt_records       == NULL) ||
+         (pu16_nrOfRecords == NULL)    )
+    {
+      (void)xc_printf ("TRC_CopyRecords: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if (TRC_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("TRC_CopyRecords: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // The records may not change while copying
+    if (pt_this->b_recording != FALSE)
+    {
+      result = TRC_ERR_BUSY ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    *pt_baseTime = pt_this->t_baseTime ;
+
+    u16_record = pt_this->u16_oldestRecord ;
+    for (u16_index = 0;
+         (u16_index < pt_this->u16_usedRecords) && (u16_index < u16_maxRecords);
+         u16_index ++)
+    {
+      pt_records[u16_index] = pt_this->pt_record[u16_record] ;
+
+      u16_record ++ ;
+      if (u16_record >= pt_this->u16_nrOfRecords)
+      {
+        u16_record = 0 ;
+      }
+    }
+    *pu16_nrOfRecords = u16_index ;
+  }
+
+  return (result) ;
+}
+// End: TRC_CopyRecords
+
+
+TRC_status TRC_LoadRecords (TRC_handle                 const pt_instance,
+                            TMR_micro_struct   const * const pt_baseTime,
+                            TRC_record         const * const pt_records,
+                            unsigned short             const u16_nrOfRecords)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_LoadRecords                                            //
+//                 - Replace the records by a trace recorded elsewhere, for   //
+//                   replay. Recording must be stopped                        //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+  unsigned short              u16_index ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance == NULL) ||
+         (pt_baseTime == NULL) ||
+         (pt_records  == NULL)    )
+    {
+      (void)xc_printf ("TRC_LoadRecords: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if ( (TRC_PTR_INVALID(pt_this)                   ) ||
+         (u16_nrOfRecords > pt_this->u16_nrOfRecords)    )
+    {
+      (void)xc_printf ("TRC_LoadRecords: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // The records may not change while recording
+    if (pt_this->b_recording != FALSE)
+    {
+      result = TRC_ERR_BUSY ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    pt_this->t_baseTime       = *pt_baseTime ;
+    pt_this->t_lastTime       = *pt_baseTime ;
+    pt_this->u16_oldestRecord = 0 ;
+    pt_this->u16_usedRecords  = u16_nrOfRecords ;
+
+    for (u16_index = 0; u16_index < u16_nrOfRecords; u16_index ++)
+    {
+      pt_this->pt_record[u16_index] = pt_records[u16_index] ;
+      if ((pt_records[u16_index] >> TRC_CHANNEL_SHIFT) == TRC_GAP_CHANNEL)
+      {
+        TMR_PostponeMicroStamp (&(pt_this->t_lastTime), (pt_records[u16_index] & TRC_DELTA_MASK) * TMR_US_PER_MS) ;
+      }
+      else
+      {
+        TMR_PostponeMicroStamp (&(pt_this->t_lastTime), pt_records[u16_index] & TRC_DELTA_MASK) ;
+      }
+    }
+  }
+
+  return (result) ;
+}
+// End: TRC_LoadRecords
+
+
+TRC_status TRC_Replay (TRC_handle                 const pt_instance,
+                       unsigned char              const u8_channel,
+                       PHD_handle                 const pt_phdInstance,
+                       BOOL                       const b_realTime,
+                       BOOL                       const b_continue,
+                       TRC_report_struct        * const pt_report)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_Replay                                                 //
+//                 - Feed the pulses of one channel into a pulse handler      //
+//                   instance, on a simulated clock. Either at the recorded   //
+//                   speed or as fast as possible                             //
+//                 - With b_continue the simulated clock and the report of    //
+//                   the previous replay are continued, so a long trace can   //
+//                   be replayed in parts using TRC_LoadRecords               //
+//                 - The pulse handler instance must be a scratch channel     //
+//                   without a storage client; PHD_SetRealTime puts it back   //
+//                   on the real clock after the last part                    //
+//                 - Returns TRC_ERR_REPLAY if the instance is not simulated, //
+//                   or stops being simulated; no pulse is fed to it then     //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_status                  result  = TRC_OK ;
+  TRC_instance_struct * const pt_this = pt_instance ;
+  TMR_micro_struct            t_simTime ;
+  TMR_micro_struct            t_wallTime ;
+  TMR_micro_struct            t_wallStart ;
+  TMR_micro_struct            t_now ;
+  TRC_record                  t_record ;
+  unsigned long               u32_delta ;
+  unsigned long               u32_ahead ;
+  unsigned long               u32_elapsedMs ;
+  unsigned int                u24_pulsesPerMinute ;
+  unsigned short              u16_index ;
+  unsigned short              u16_record ;
+  PHD_status                  t_phdResult ;
+
+  if (result == TRC_OK)
+  {
+    // Do parameter check
+    if ( (pt_instance    == NULL            ) ||
+         (u8_channel     >= TRC_MAX_CHANNELS) ||
+         (pt_phdInstance == NULL            ) ||
+         (pt_report      == NULL            )    )
+    {
+      (void)xc_printf ("TRC_Replay: Parameter error.\n") ;
+      result = TRC_ERR_PARAM ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // Check if the pointer is valid
+    if (TRC_PTR_INVALID(pt_this))
+    {
+      (void)xc_printf ("TRC_Replay: Invalid pointer.\n") ;
+      result = TRC_ERR_POINTER ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    // The records may not change while replaying
+    if (pt_this->b_recording != FALSE)
+    {
+      result = TRC_ERR_BUSY ;
+    }
+  }
+
+  if ( (result     == TRC_OK) &&
+       (b_continue == FALSE )    )
+  {
+    // Put the pulse handler on the simulated clock
+    if (PHD_SetSimulated (pt_phdInstance, &(pt_this->t_baseTime)) != PHD_OK)
+    {
+      result = TRC_ERR_REPLAY ;
+    }
+
+    pt_report->u32_pulses             = 0 ;
+    pt_report->u32_accepted           = 0 ;
+    pt_report->u32_rejected           = 0 ;
+    pt_report->u32_elapsedMs          = 0 ;
+    pt_report->u32_pulsesPerSecond    = 0 ;
+    pt_report->u24_pulsesPerMinute    = 0 ;
+    pt_report->u24_pulsesPerMinuteMax = 0 ;
+  }
+
+  if ( (result     == TRC_OK) &&
+       (b_continue != FALSE )    )
+  {
+    // Only continue on a clock which is still simulated; a live instance
+    // refuses the time, so its counters and storage are never fed
+    if (PHD_AdvanceTime (pt_phdInstance, &(pt_this->t_baseTime)) != PHD_OK)
+    {
+      result = TRC_ERR_REPLAY ;
+    }
+  }
+
+  if (result == TRC_OK)
+  {
+    t_simTime  = pt_this->t_baseTime ;
+    TMR_SetMicroStamp (&t_wallStart) ;
+    t_wallTime = t_wallStart ;
+
+    u16_record = pt_this->u16_oldestRecord ;
+    for (u16_index = 0; (u16_index < pt_this->u16_usedRecords) && (result == TRC_OK); u16_index ++)
+    {
+      // Move the simulated clock on
+      t_record  = pt_this->pt_record[u16_record] ;
+      u32_delta = t_record & TRC_DELTA_MASK ;
+      if ((t_record >> TRC_CHANNEL_SHIFT) == TRC_GAP_CHANNEL)
+      {
+        u32_delta *= TMR_US_PER_MS ;
+      }
+      TMR_PostponeMicroStamp (&t_simTime, u32_delta) ;
+
+      if ((t_record >> TRC_CHANNEL_SHIFT) == u8_channel)
+      {
+        if (b_realTime != FALSE)
+        {
+          // Wait until the pulse is due: Sleep for the bulk, spin for the rest
+          TMR_PostponeMicroStamp (&t_wallTime, u32_delta) ;
+          TMR_SetMicroStamp (&t_now) ;
+          u32_ahead = TMR_MicroStampDiff (&t_wallTime, &t_now) ;
+          while (u32_ahead > 0)
+          {
+            if (u32_ahead >= 2 * TRC_SLEEP_UNIT_US)
+            {
+              KE_TaskSleep100 ((u32_ahead / TRC_SLEEP_UNIT_US) - 1) ;
+            }
+            TMR_SetMicroStamp (&t_now) ;
+            u32_ahead = TMR_MicroStampDiff (&t_wallTime, &t_now) ;
+          }
+        }
+
+        // Close the seconds before the pulse, then feed the pulse. Stop as
+        // soon as the pulse handler leaves the simulated clock
+        t_phdResult = PHD_AdvanceTime (pt_phdInstance, &t_simTime) ;
+        if (t_phdResult == PHD_OK)
+        {
+          t_phdResult = PHD_HandlePulseAt (pt_phdInstance, &t_simTime) ;
+        }
+
+        if (t_phdResult == PHD_OK)
+        {
+          pt_report->u32_pulses ++ ;
+          pt_report->u32_accepted ++ ;
+        }
+        else if (t_phdResult == PHD_ERR_DEBOUNCE)
+        {
+          pt_report->u32_pulses ++ ;
+          pt_report->u32_rejected ++ ;
+        }
+        else
+        {
+          result = TRC_ERR_REPLAY ;
+        }
+
+        // Track the per-minute rate
+        (void)PHD_GetPulsesPerMinute (pt_phdInstance, &u24_pulsesPerMinute) ;
+        pt_report->u24_pulsesPerMinute = u24_pulsesPerMinute ;
+        if (u24_pulsesPerMinute > pt_report->u24_pulsesPerMinuteMax)
+        {
+          pt_report->u24_pulsesPerMinuteMax = u24_pulsesPerMinute ;
+        }
+      }
+      else if (b_realTime != FALSE)
+      {
+        // Keep the real time in step with records of other channels
+        TMR_PostponeMicroStamp (&t_wallTime, u32_delta) ;
+      }
+
+      u16_record ++ ;
+      if (u16_record >= pt_this->u16_nrOfRecords)
+      {
+        u16_record = 0 ;
+      }
+    }
+
+    // Close the seconds up to the end of the trace
+    if ( (result == TRC_OK                                         ) &&
+         (PHD_AdvanceTime (pt_phdInstance, &t_simTime) != PHD_OK)    )
+    {
+      result = TRC_ERR_REPLAY ;
+    }
+
+    // Report the throughput
+    u32_elapsedMs = TMR_MicroStampAge (&t_wallStart) / TMR_US_PER_MS ;
+    pt_report->u32_elapsedMs += u32_elapsedMs ;
+    if (pt_report->u32_elapsedMs == 0)
+    {
+      pt_report->u32_pulsesPerSecond = pt_report->u32_pulses * TRC_MS_PER_SECOND ;
+    }
+    else if (pt_report->u32_pulses < (0xFFFFFFFFUL / TRC_MS_PER_SECOND))
+    {
+      pt_report->u32_pulsesPerSecond = (pt_report->u32_pulses * TRC_MS_PER_SECOND) / pt_report->u32_elapsedMs ;
+    }
+    else
+    {
+      pt_report->u32_pulsesPerSecond = pt_report->u32_pulses / ((pt_report->u32_elapsedMs / TRC_MS_PER_SECOND) + 1) ;
+    }
+  }
+
+  return (result) ;
+}
+// End: TRC_Replay
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local Implementations                                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+static void TRC_AddRecord (TRC_instance_struct * const pt_this,
+                           TRC_record            const t_record)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       TRC_AddRecord                                              //
+//                 - Append a record, dropping the oldest one if full         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  TRC_record     t_oldest ;
+  unsigned short u16_record ;
+
+  if (pt_this->u16_usedRecords >= pt_this->u16_nrOfRecords)
+  {
+    // Move the base time past the oldest record and drop it
+    t_oldest = pt_this->pt_record[pt_this->u16_oldestRecord] ;
+    if ((t_oldest >> TRC_CHANNEL_SHIFT) == TRC_GAP_CHANNEL)
+    {
+      TMR_PostponeMicroStamp (&(pt_this->t_baseTime), (t_oldest & TRC_DELTA_MASK) * TMR_US_PER_MS) ;
+    }
+    else
+    {
+      TMR_PostponeMicroStamp (&(pt_this->t_baseTime), t_oldest & TRC_DELTA_MASK) ;
+    }
+
+    pt_this->u16_oldestRecord ++ ;
+    if (pt_this->u16_oldestRecord >= pt_this->u16_nrOfRecords)
+    {
+      pt_this->u16_oldestRecord = 0 ;
+    }
+    pt_this->u16_usedRecords -- ;
+  }
+
+  // Store the new record behind the newest one
+  u16_record = pt_this->u16_oldestRecord + pt_this->u16_usedRecords ;
+  if (u16_record >= pt_this->u16_nrOfRecords)
+  {
+    u16_record -= pt_this->u16_nrOfRecords ;
+  }
+  pt_this->pt_record[u16_record] = t_record ;
+  pt_this->u16_usedRecords ++ ;
+
+  return ;
+}
+// End: TRC_AddRecord
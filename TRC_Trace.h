@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : TRC_Trace.h
+// Function: Include file of 'TRC_Trace.c'.
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRC_TRACE_H                                   // Include file already compiled ?
+#define TRC_TRACE_H
+
+#ifdef TRC_TRACE_C                                    // Compiled in TRC_Trace.c ?
+#define TRC_EXTERN
+#else
+#ifdef __cplusplus                                    // Compiled for C++ ?
+#define TRC_EXTERN extern "C"
+#else
+#define TRC_EXTERN extern
+#endif // __cplusplus
+#endif // TRC_TRACE_C
+
+
+#define TRC_OK                  (0)                   // All Ok
+#define TRC_ERR_PARAM           (-1)                  // Parameter error
+#define TRC_ERR_MEMORY          (-2)                  // Memory allocation error
+#define TRC_ERR_POINTER         (-3)                  // Invalid pointer supplied
+#define TRC_ERR_BUSY            (-4)                  // Trace is still recording
+#define TRC_ERR_REPLAY          (-5)                  // Pulse handler refused the replay
+
+#define TRC_MAX_CHANNELS        (15)                  // Channels 0..14; 15 marks a gap record
+
+// Record layout: Bit 31..28 hold the channel, bit 27..0 the time since the
+// previous record in us. Gap records (channel 15) only move the time on, by
+// bit 27..0 in ms.
+#define TRC_CHANNEL_SHIFT       (28)
+#define TRC_DELTA_MASK          (0x0FFFFFFFUL)
+#define TRC_GAP_CHANNEL         (0x0F)
+
+
+// TRC types
+typedef void*                   TRC_handle ;
+typedef char                    TRC_status ;          // Status/Error return type
+typedef unsigned long           TRC_record ;
+
+typedef struct
+{
+  unsigned long   u32_pulses ;                        // Pulses of the channel fed to the pulse handler
+  unsigned long   u32_accepted ;                      // Pulses accepted by the pulse handler
+  unsigned long   u32_rejected ;                      // Pulses rejected by the debouncer
+  unsigned long   u32_elapsedMs ;                     // Real time spent replaying
+  unsigned long   u32_pulsesPerSecond ;               // Pulses processed per second of real time
+  unsigned int    u24_pulsesPerMinute ;               // Pulses per minute at the end of the trace
+  unsigned int    u24_pulsesPerMinuteMax ;            // Highest pulses per minute during the trace
+} TRC_report_struct ;
+
+
+TRC_status  TRC_Create          (TRC_handle                * const ppt_instance,
+                                 unsigned short              const u16_nrOfRecords) ;
+
+TRC_status  TRC_Delete          (TRC_handle                  const pt_instance) ;
+
+TRC_status  TRC_SetRecording    (TRC_handle                  const pt_instance,
+                                 BOOL                        const b_recording) ;
+
+TRC_status  TRC_Record          (TRC_handle                  const pt_instance,
+                                 unsigned char               const u8_channel,
+                                 TMR_micro_struct    const * const pt_pulseTime) ;
+
+TRC_status  TRC_CopyRecords     (TRC_handle                  const pt_instance,
+                                 TMR_micro_struct          * const pt_baseTime,
+                                 TRC_record                * const pt_records,
+                                 unsigned short              const u16_maxRecords,
+                                 unsigned short            * const pu16_nrOfRecords) ;
+
+TRC_status  TRC_LoadRecords     (TRC_handle                  const pt_instance,
+                                 TMR_micro_struct    const * const pt_baseTime,
+                                 TRC_record          const * const pt_records,
+                                 unsigned short              const u16_nrOfRecords) ;
+
+TRC_status  TRC_Replay          (TRC_handle                  const pt_instance,
+                                 unsigned char               const u8_channel,
+                                 PHD_handle                  const pt_phdInstance,
+                                 BOOL                        const b_realTime,
+                                 BOOL                        const b_continue,
+                                 TRC_report_struct         * const pt_report) ;
+
+
+#endif //TRC_TRACE_H
@@ -13,10 +13,12 @@
 #include <httpd.h>
 #include "WEB_Site.h"
 
+#include "TMR_Timer.h"
 #include "RTC_RealTimeClock.h"
 #include "CNV_Conversions.h"
 #include "BMM_BucketMemory.h" // ToDo: Remove BMM import, functions should be parsed at 'create'
 #include "PHD_PulseHandler.h" // ToDo: Remove PHD import, functions should be parsed at 'create'
+#include "TRC_Trace.h"
 
 
 #define WEB_MAX_TABLES        (10)
@@ -25,6 +27,12 @@
 #define WEB_MAX_NAME          (50)
 #define WEB_MAX_UNIT          (16)
 
+#define WEB_DATA_BUFFER       (256)                       // Bytes of output buffered by the data pages
+#define WEB_DATA_MAX_ROW      (56)                        // Longest row of the data pages
+#define WEB_DATA_CHUNK        (16)                        // Buckets read at once by the data pages
+
+#define WEB_MAX_ETAG          (16)                        // Quoted web number and version, in hex
+
 #define WEB_TABLE_SIGNATURE   ('TAB')
 #define WEB_METER_SIGNATURE   ('MET')
 
@@ -58,10 +66,28 @@ typedef struct
   unsigned short  u16_webNumber ;
   unsigned short  u16_nrOfEntries ;
   unsigned short  u16_currEntries ;
-  WEB_tableEntry* at_entry ;
+  unsigned short  u16_newestEntry ;                   // Ring index of the newest rendered row
+  unsigned long   u32_generation ;                    // Bucket generation of the newest rendered row
+  WEB_tableEntry* at_entry ;                          // Ring of rendered rows, of a lazy table once requested
+  unsigned int*   au24_value ;                        // Snapshot of the buckets, shares the entries' memory
+  void*           pv_bmmInstance ;                    // Bucket memory of a lazy table, NULL otherwise
+  BOOL            b_busy ;                            // A request is updating the rows of a lazy table
   PID             t_processId ;
 } WEB_tableInst_struct ;
 
+typedef enum
+{
+  e_formatCsv    = 0,
+  e_formatJson   = 1,
+  e_formatBinary = 2                                  // Header and raw counts, see WEB_Site.h
+} WEB_format_enum ;
+
+typedef struct
+{
+  void*           pv_bmmInstance ;                    // Bucket memory holding all tiers of a meter
+  unsigned int    u24_unitsPerKPulses ;
+} WEB_source_struct ;
+
 typedef struct
 {
   unsigned int    u24_signature ;
@@ -78,6 +104,10 @@ typedef struct
 
 static WEB_tableInst_struct * pt_tableInstance[WEB_MAX_TABLES] ;
 static WEB_meterInst_struct * pt_meterInstance[WEB_MAX_METERS] ;
+static WEB_source_struct      at_dataSource[WEB_MAX_METERS] ;   // Bucket memories of the data pages, by meter
+
+static void                 * pv_traceInstance ;         // Pulse trace exported by /trace.bin
+static unsigned short         u16_traceRecords ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,7 +117,54 @@ static WEB_meterInst_struct * pt_meterInstance[WEB_MAX_METERS] ;
 static SYSCALL WEB_Table        (struct http_request *request) ;
 static SYSCALL WEB_Meter        (struct http_request *request) ;
 static SYSCALL WEB_Grahpic      (struct http_request *request) ;
+static SYSCALL WEB_DataCsv      (struct http_request *request) ;
+static SYSCALL WEB_DataJson     (struct http_request *request) ;
+static SYSCALL WEB_DataBin      (struct http_request *request) ;
+static SYSCALL WEB_Trace        (struct http_request *request) ;
+static SYSCALL WEB_Data         (struct http_request *       request,
+                                 WEB_format_enum       const t_format) ;
+static void    WEB_MakeETag     (char                 * const as8_etag,
+                                 unsigned short         const u16_webNumber,
+                                 unsigned long          const u32_version) ;
+static BOOL    WEB_NotModified  (struct http_request  *       request,
+                                 char           const * const as8_etag) ;
+static void    WEB_WriteDump    (struct http_request  * const request,
+                                 void                 * const pv_tier,
+                                 unsigned int           const u24_unitsPerKPulses,
+                                 unsigned short         const u16_meterNumber,
+                                 unsigned short         const u16_tierNumber,
+                                 unsigned long          const u32_from,
+                                 unsigned long          const u32_to,
+                                 BOOL                   const b_toGiven,
+                                 unsigned char        * const au8_header) ;
+static void    WEB_WriteGroups  (struct http_request  * const request,
+                                 void                 * const pv_tier,
+                                 unsigned int           const u24_unitsPerKPulses,
+                                 unsigned short         const u16_factor,
+                                 unsigned long          const u32_from,
+                                 unsigned long          const u32_to,
+                                 BOOL                   const b_json,
+                                 char                 * const as8_buffer,
+                                 unsigned short       * const pu16_used) ;
+static void    WEB_WriteArchive (struct http_request     * const request,
+                                 BMM_archiveReader_struct * const pt_reader,
+                                 unsigned int              const u24_unitsPerKPulses,
+                                 unsigned long             const u32_from,
+                                 unsigned long             const u32_to,
+                                 BOOL                      const b_json,
+                                 char                    * const as8_buffer,
+                                 unsigned short          * const pu16_used) ;
 static PROCESS WEB_FillProcess  (WEB_handle  const pt_instance) ;
+static void    WEB_UpdateRows   (WEB_tableInst_struct * const pt_this,
+                                 void                 * const pv_bmmInstance) ;
+static void    WEB_RenderEntry  (WEB_tableInst_struct * const pt_this,
+                                 char                 * const ps8_entry,
+                                 RTC_DateTime_struct const * const pt_dateTime,
+                                 unsigned int           const u24_value) ;
+static void    WEB_WriteRows    (struct http_request  * const request,
+                                 WEB_tableInst_struct * const pt_this) ;
+static void    WEB_WriteLazyRows(struct http_request  * const request,
+                                 WEB_tableInst_struct * const pt_this) ;
 static PROCESS WEB_MeterProcess (WEB_handle  const pt_instance) ;
 
 
@@ -104,6 +181,10 @@ Webpage at_webSite[] = {
   {HTTP_PAGE_STATIC,  "/main.html",           "text/html", &main_html },
   {HTTP_PAGE_DYNAMIC, "/table.cgi",           "text/html", (struct staticpage *)WEB_Table },
   {HTTP_PAGE_DYNAMIC, "/meter.cgi",           "text/html", (struct staticpage *)WEB_Meter },
+  {HTTP_PAGE_DYNAMIC, "/data.csv",            "text/csv",  (struct staticpage *)WEB_DataCsv },
+  {HTTP_PAGE_DYNAMIC, "/data.json",           "application/json", (struct staticpage *)WEB_DataJson },
+  {HTTP_PAGE_DYNAMIC, "/data.bin",            "application/octet-stream", (struct staticpage *)WEB_DataBin },
+  {HTTP_PAGE_DYNAMIC, "/trace.bin",           "application/octet-stream", (struct staticpage *)WEB_Trace },
   {HTTP_PAGE_STATIC,  "/metermaid.jpg",       "image/jpg", &MeterMaid_jpg },
   {HTTP_PAGE_STATIC,  "/anybrowser.gif",      "image/gif", &anybrowser_gif },
   {0,                 NULL,                   NULL,        NULL }
@@ -131,12 +212,17 @@ WEB_status WEB_Initialize (Webpage * * const ppt_webPage)
     pt_tableInstance[u8_index] = NULL ;
   }
 
-  // Initialize all web meter instances
+  // Initialize all web meter instances and data sources
   for (u8_index = 0; u8_index < WEB_MAX_METERS; u8_index ++)
   {
     pt_meterInstance[u8_index] = NULL ;
+    at_dataSource[u8_index].pv_bmmInstance = NULL ;
   }
 
+  // No pulse trace until one is set
+  pv_traceInstance = NULL ;
+  u16_traceRecords = 0 ;
+
   // Fill out the pointer to the website
   *ppt_webPage = &at_webSite[0] ;
 
@@ -208,12 +294,16 @@ WEB_status WEB_CreateTable (WEB_handle           * const ppt_instance,
     pt_this->u16_webNumber        = u16_webNumber ;
     pt_this->u16_nrOfEntries      = u16_nrOfEntries ;
     pt_this->u16_currEntries      = 0 ;
+    pt_this->u16_newestEntry      = 0 ;
+    pt_this->u32_generation       = 0 ;
+    pt_this->pv_bmmInstance       = NULL ;
+    pt_this->b_busy               = FALSE ;
     strncpy (pt_this->as8_frameName, ps8_frameName, WEB_MAX_NAME) ;
     strncpy (pt_this->as8_tableName, ps8_tableName, WEB_MAX_NAME) ;
     strncpy (pt_this->as8_unitName,  ps8_unitName,  WEB_MAX_UNIT) ;
 
     // Allocate memory for buckets
-    pt_this->at_entry = getmem (pt_this->u16_nrOfEntries * sizeof(WEB_tableEntry)) ;
+    pt_this->at_entry = getmem (pt_this->u16_nrOfEntries * (sizeof(WEB_tableEntry) + sizeof(unsigned int))) ;
     if (pt_this->at_entry == NULL)
     {
       // Clean up
@@ -223,6 +313,10 @@ WEB_status WEB_CreateTable (WEB_handle           * const ppt_instance,
       (void)xc_printf ("WEB_CreateTable: Memory error (entries).\n") ;
       result = WEB_ERR_MEMORY ;
     }
+    else
+    {
+      pt_this->au24_value = (unsigned int*)&(pt_this->at_entry[pt_this->u16_nrOfEntries]) ;
+    }
   }
 
   if (result == WEB_OK)
@@ -239,7 +333,7 @@ WEB_status WEB_CreateTable (WEB_handle           * const ppt_instance,
     {
       // Clean up
       pt_this->u24_signature = 0x000000 ;
-      (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * sizeof(WEB_tableEntry)) ;
+      (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * (sizeof(WEB_tableEntry) + sizeof(unsigned int))) ;
       (void)freemem (pt_this, sizeof(WEB_tableInst_struct)) ;
 
       (void)xc_printf ("WEB_CreateTable: Process error (create).\n") ;
@@ -254,7 +348,7 @@ WEB_status WEB_CreateTable (WEB_handle           * const ppt_instance,
       // Clean up
       pt_this->u24_signature = 0x000000 ;
       (void)KE_TaskDelete (pt_this->t_processId) ;
-      (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * sizeof(WEB_tableEntry)) ;
+      (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * (sizeof(WEB_tableEntry) + sizeof(unsigned int))) ;
       (void)freemem (pt_this, sizeof(WEB_tableInst_struct)) ;
 
       (void)xc_printf ("WEB_CreateTable: Process error (resume).\n") ;
@@ -276,6 +370,96 @@ WEB_status WEB_CreateTable (WEB_handle           * const ppt_instance,
 // End: WEB_CreateTable
 
 
+WEB_status WEB_CreateLazyTable (WEB_handle           * const ppt_instance,
+                                void                 * const pv_bmmInstance,
+                                unsigned short         const u16_nrOfEntries,
+                                unsigned int           const u24_unitsPerKPulses,
+                                unsigned short         const u16_webNumber,
+                                char           const * const ps8_frameName,
+                                char           const * const ps8_tableName,
+                                char           const * const ps8_unitName)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_CreateLazyTable                                        //
+//                 - Creates a table that renders the buckets of a bucket     //
+//                   memory tier when requested. It has no process and needs  //
+//                   no bucket-change events; its ring of rows is allocated   //
+//                   by the first request and brought up to date by the next  //
+////////////////////////////////////////////////////////////////////////////////
+{
+  WEB_status             result      = WEB_OK ;
+  WEB_tableInst_struct * pt_this ;
+  unsigned char          u8_index     = 0 ;
+
+  if (result == WEB_OK)
+  {
+    // Do parameter check
+    if ( (ppt_instance    == NULL) ||
+         (pv_bmmInstance  == NULL) ||
+         (u16_nrOfEntries == 0   )    )
+    {
+      (void)xc_printf ("WEB_CreateLazyTable: Parameter error.\n") ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // Find an empty lut entry
+    while ( (pt_tableInstance[u8_index] != NULL          ) &&
+            (u8_index                    < WEB_MAX_TABLES)    )
+    {
+      u8_index ++ ;
+    }
+
+    if (u8_index >= WEB_MAX_TABLES)
+    {
+      (void)xc_printf ("WEB_CreateLazyTable: No free slot.\n") ;
+      result = WEB_ERR_NOFREESLOT ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // Allocate memory for this instance
+    pt_this = getmem (sizeof(WEB_tableInst_struct)) ;
+    if (pt_this == NULL)
+    {
+      (void)xc_printf ("WEB_CreateLazyTable: Memory error (instance).\n") ;
+      result = WEB_ERR_MEMORY ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // Initialize global variables of this instance
+    pt_this->u24_signature        = WEB_TABLE_SIGNATURE ;
+    pt_this->u24_unitsPerKPulses  = u24_unitsPerKPulses ;
+    pt_this->u16_webNumber        = u16_webNumber ;
+    pt_this->u16_nrOfEntries      = u16_nrOfEntries ;
+    pt_this->u16_currEntries      = 0 ;
+    pt_this->u16_newestEntry      = 0 ;
+    pt_this->u32_generation       = 0 ;
+    pt_this->at_entry             = NULL ;
+    pt_this->au24_value           = NULL ;
+    pt_this->pv_bmmInstance       = pv_bmmInstance ;
+    pt_this->b_busy               = FALSE ;
+    pt_this->t_processId          = 0 ;
+    strncpy (pt_this->as8_frameName, ps8_frameName, WEB_MAX_NAME) ;
+    strncpy (pt_this->as8_tableName, ps8_tableName, WEB_MAX_NAME) ;
+    strncpy (pt_this->as8_unitName,  ps8_unitName,  WEB_MAX_UNIT) ;
+
+    // Fill out lut entry
+    pt_tableInstance[u8_index] = pt_this ;
+
+    // Fill out the instance pointer
+    *ppt_instance = pt_this ;
+  }
+
+  return (result) ;
+}
+// End: WEB_CreateLazyTable
+
+
 WEB_status WEB_DeleteTable (WEB_handle const pt_instance)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       Web table destruction routine                              //
@@ -286,6 +470,7 @@ WEB_status WEB_DeleteTable (WEB_handle const pt_instance)
 {
   WEB_status                   result  = WEB_OK ;
   WEB_tableInst_struct * const pt_this = pt_instance ;
+  unsigned char                u8_index ;
 
   if (result == WEB_OK)
   {
@@ -309,14 +494,31 @@ WEB_status WEB_DeleteTable (WEB_handle const pt_instance)
 
   if (result == WEB_OK)
   {
-    // Kill the task
-    (void)KE_TaskDelete (pt_this->t_processId) ;
-
     // Invalidate the pointer
     pt_this->u24_signature = 0x000000 ;
 
+    if (pt_this->pv_bmmInstance == NULL)
+    {
+      // Kill the task
+      (void)KE_TaskDelete (pt_this->t_processId) ;
+    }
+
+    // Return the rows to the memory manager, a lazy table may have none
+    if (pt_this->at_entry != NULL)
+    {
+      (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * (sizeof(WEB_tableEntry) + sizeof(unsigned int))) ;
+    }
+
+    // Remove the lut entry
+    for (u8_index = 0; u8_index < WEB_MAX_TABLES; u8_index ++)
+    {
+      if (pt_tableInstance[u8_index] == pt_this)
+      {
+        pt_tableInstance[u8_index] = NULL ;
+      }
+    }
+
     // Return the memory to the memory manager
-    (void)freemem (pt_this->at_entry, pt_this->u16_nrOfEntries * sizeof(WEB_tableEntry)) ;
     (void)freemem (pt_this, sizeof(WEB_tableInst_struct)) ;
   }
 
@@ -540,6 +742,71 @@ WEB_status WEB_GetProcessId (WEB_handle   const pt_instance,
 // End: WEB_GetMeterProcId
 
 
+WEB_status WEB_SetDataSource (unsigned short         const u16_meterNumber,
+                              void                 * const pv_bmmInstance,
+                              unsigned int           const u24_unitsPerKPulses)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_SetDataSource                                          //
+//                 - Sets the bucket memory the data pages read a meter from. //
+//                   Their tier parameter selects any of its tiers            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  WEB_status    result = WEB_OK ;
+
+  if (result == WEB_OK)
+  {
+    // Do parameter check
+    if ( (u16_meterNumber >= WEB_MAX_METERS) ||
+         (pv_bmmInstance  == NULL          )    )
+    {
+      (void)xc_printf ("WEB_SetDataSource: Parameter error.\n") ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    at_dataSource[u16_meterNumber].u24_unitsPerKPulses = u24_unitsPerKPulses ;
+    at_dataSource[u16_meterNumber].pv_bmmInstance      = pv_bmmInstance ;
+  }
+
+  return (result) ;
+}
+// End: WEB_SetDataSource
+
+
+WEB_status WEB_SetTrace (void           * const pv_trcInstance,
+                         unsigned short   const u16_nrOfRecords)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_SetTrace                                               //
+//                 - Sets the pulse trace exported by /trace.bin, holding at  //
+//                   most the given number of records                         //
+////////////////////////////////////////////////////////////////////////////////
+{
+  WEB_status result = WEB_OK ;
+
+  if (result == WEB_OK)
+  {
+    // Do parameter check
+    if ( (pv_trcInstance  == NULL) ||
+         (u16_nrOfRecords == 0   )    )
+    {
+      (void)xc_printf ("WEB_SetTrace: Parameter error.\n") ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    pv_traceInstance = pv_trcInstance ;
+    u16_traceRecords = u16_nrOfRecords ;
+  }
+
+  return (result) ;
+}
+// End: WEB_SetTrace
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // CGI Implementations                                                        //
 ////////////////////////////////////////////////////////////////////////////////
@@ -618,6 +885,19 @@ static const char as8_pageEnd[]           =   "</table>" \
                                              "</body>" \
                                             "</html>" ;
 
+static const char as8_headerETag[]        = "ETag" ;
+static const char as8_headerIfNoneMatch[] = "If-None-Match" ;
+
+static const char as8_dataCsvHead[]       = "time,pulses,units\r\n" ;
+static const char as8_dataCsvHeadStats[]  = "time,pulses,units,minload,maxload\r\n" ;
+static const char as8_dataCsvEnd[]        = "\r\n" ;
+static const char as8_dataJsonHead[]      = "{\"meter\":%u,\"tier\":%u,\"rows\":[" ;
+static const char as8_dataJsonEnd[]       = "]" ;
+static const char as8_dataJsonTail[]      = "]}" ;
+static const char as8_dataRow[]           = ",%u,%u.%03u" ;
+static const char as8_dataStats[]         = ",%u,%u" ;
+static const char as8_dataFraction[]      = ".%03u" ;
+
 SYSCALL WEB_Table (struct http_request *request)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       WEB_Table                                                  //
@@ -635,6 +915,10 @@ SYSCALL WEB_Table (struct http_request *request)
   RTC_DateTime_struct t_currDateTime ;
   unsigned char       u8_index ;
   unsigned char       u8_tableIndex ;
+  char                as8_etag[WEB_MAX_ETAG] ;
+  unsigned int        u24_value ;
+  BMM_range_struct    t_range ;
+  BOOL                b_notModified    = FALSE ;
 
   if (result == WEB_OK)
   {
@@ -695,6 +979,22 @@ SYSCALL WEB_Table (struct http_request *request)
   }
 
   if (result == WEB_OK)
+  {
+    // The rows only change with the generation of the buckets
+    if (pt_tableInstance[u8_tableIndex]->pv_bmmInstance != NULL)
+    {
+      (void)BMM_GetBucketRange (pt_tableInstance[u8_tableIndex]->pv_bmmInstance, 0, 1, &u24_value, &t_range) ;
+      WEB_MakeETag (as8_etag, pt_tableInstance[u8_tableIndex]->u16_webNumber, t_range.u32_generation) ;
+    }
+    else
+    {
+      WEB_MakeETag (as8_etag, pt_tableInstance[u8_tableIndex]->u16_webNumber, pt_tableInstance[u8_tableIndex]->u32_generation) ;
+    }
+    b_notModified = WEB_NotModified (request, as8_etag) ;
+  }
+
+  if ( (result == WEB_OK) &&
+       (!b_notModified  )    )
   {
     // Tell the client the request has been granted
     http_output_reply (request, HTTP_200_OK) ;
@@ -724,11 +1024,14 @@ SYSCALL WEB_Table (struct http_request *request)
 
     __http_write (request, as8_pageTableTitle_c, strlen(as8_pageTableTitle_c)) ;
 
-    for (u8_index = 0; u8_index < pt_tableInstance[u8_tableIndex]->u16_currEntries; u8_index ++)
+    if (pt_tableInstance[u8_tableIndex]->pv_bmmInstance != NULL)
     {
-      __http_write (request,
-                    pt_tableInstance[u8_tableIndex]->at_entry[u8_index],
-                    strlen(pt_tableInstance[u8_tableIndex]->at_entry[u8_index])) ;
+      // Bring the rows of a lazy table up to date first
+      WEB_WriteLazyRows (request, pt_tableInstance[u8_tableIndex]) ;
+    }
+    else
+    {
+      WEB_WriteRows (request, pt_tableInstance[u8_tableIndex]) ;
     }
 
     // Show meaning of the numbers at the bottom of the table
@@ -763,6 +1066,8 @@ SYSCALL WEB_Meter (struct http_request *request)
   char *              as8_buffer       = getmem (1024) ;
   unsigned char       u8_index ;
   unsigned char       u8_meterIndex ;
+  char                as8_etag[WEB_MAX_ETAG] ;
+  BOOL                b_notModified    = FALSE ;
 
   if (result == WEB_OK)
   {
@@ -823,6 +1128,14 @@ SYSCALL WEB_Meter (struct http_request *request)
   }
 
   if (result == WEB_OK)
+  {
+    // The meter only changes with the published load
+    WEB_MakeETag (as8_etag, pt_meterInstance[u8_meterIndex]->u16_webNumber, pt_meterInstance[u8_meterIndex]->u24_currentLoad) ;
+    b_notModified = WEB_NotModified (request, as8_etag) ;
+  }
+
+  if ( (result == WEB_OK) &&
+       (!b_notModified  )    )
   {
     // Tell the client the request has been granted
     http_output_reply (request, HTTP_200_OK) ;
@@ -869,38 +1182,979 @@ SYSCALL WEB_Meter (struct http_request *request)
   return (OK) ;
 }
 
+static SYSCALL WEB_DataCsv (struct http_request *request)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_DataCsv                                                //
+//                 - Sends the buckets of a table as comma separated values   //
+////////////////////////////////////////////////////////////////////////////////
+{
+  return (WEB_Data (request, e_formatCsv)) ;
+}
+
+
+static SYSCALL WEB_DataJson (struct http_request *request)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_DataJson                                               //
+//                 - Sends the buckets of a table as a JSON object            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  return (WEB_Data (request, e_formatJson)) ;
+}
+
+
+static SYSCALL WEB_DataBin (struct http_request *request)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_DataBin                                                //
+//                 - Sends the buckets of a table as a binary dump            //
+////////////////////////////////////////////////////////////////////////////////
+{
+  return (WEB_Data (request, e_formatBinary)) ;
+}
+
+
+static SYSCALL WEB_Trace (struct http_request *request)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_Trace                                                  //
+//                 - Sends the recorded pulses of all meters as they are in   //
+//                   memory, see WEB_Site.h for the layout                    //
+//                 - Recording stops for the copy and restarts with an empty  //
+//                   trace, so each export holds the pulses since the last    //
+////////////////////////////////////////////////////////////////////////////////
+{
+  WEB_status            result           = WEB_OK ;
+  unsigned char         au8_header[WEB_TRACE_HEADER_SIZE] ;
+  TRC_record *          at_record        = NULL ;
+  TMR_micro_struct      t_baseTime ;
+  unsigned short        u16_nrOfRecords  = 0 ;
+
+  if (result == WEB_OK)
+  {
+    // Check the number of parameters and the trace
+    if ( (request->numparams != 0   ) ||
+         (pv_traceInstance   == NULL)    )
+    {
+      (void)xc_printf ("WEB_Trace: Parameter error.\n") ;
+      // Tell the client the request is erroneous
+      http_output_reply (request, HTTP_404_NOT_FOUND) ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    at_record = getmem (u16_traceRecords * sizeof(TRC_record)) ;
+    if (at_record == NULL)
+    {
+      (void)xc_printf ("WEB_Trace: Memory error.\n") ;
+      // Tell the client the request is erroneous
+      http_output_reply (request, HTTP_404_NOT_FOUND) ;
+      result = WEB_ERR_MEMORY ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // The records may only be copied while recording is stopped
+    (void)TRC_SetRecording (pv_traceInstance, FALSE) ;
+    (void)TRC_CopyRecords  (pv_traceInstance, &t_baseTime, at_record, u16_traceRecords, &u16_nrOfRecords) ;
+    (void)TRC_SetRecording (pv_traceInstance, TRUE) ;
+
+    // Tell the client the request has been granted
+    http_output_reply (request, HTTP_200_OK) ;
+
+    // Fill out the header, little endian
+    au8_header[WEB_TRACE_VERSION_OFS] = WEB_TRACE_VERSION ;
+    au8_header[WEB_TRACE_COUNT_OFS]   = (unsigned char)(u16_nrOfRecords     ) ;
+    au8_header[WEB_TRACE_COUNT_OFS+1] = (unsigned char)(u16_nrOfRecords >> 8) ;
+    au8_header[WEB_TRACE_BASE_OFS]    = (unsigned char)(t_baseTime.u32_lsLong      ) ;
+    au8_header[WEB_TRACE_BASE_OFS+1]  = (unsigned char)(t_baseTime.u32_lsLong >>  8) ;
+    au8_header[WEB_TRACE_BASE_OFS+2]  = (unsigned char)(t_baseTime.u32_lsLong >> 16) ;
+    au8_header[WEB_TRACE_BASE_OFS+3]  = (unsigned char)(t_baseTime.u32_lsLong >> 24) ;
+    au8_header[WEB_TRACE_BASE_OFS+4]  = (unsigned char)(t_baseTime.u32_msLong      ) ;
+    au8_header[WEB_TRACE_BASE_OFS+5]  = (unsigned char)(t_baseTime.u32_msLong >>  8) ;
+    au8_header[WEB_TRACE_BASE_OFS+6]  = (unsigned char)(t_baseTime.u32_msLong >> 16) ;
+    au8_header[WEB_TRACE_BASE_OFS+7]  = (unsigned char)(t_baseTime.u32_msLong >> 24) ;
+    __http_write (request, (char *)au8_header, WEB_TRACE_HEADER_SIZE) ;
+
+    // The records as they are in memory, no formatting
+    if (u16_nrOfRecords > 0)
+    {
+      __http_write (request, (char *)at_record, u16_nrOfRecords * sizeof(TRC_record)) ;
+    }
+  }
+
+  if (at_record != NULL)
+  {
+    freemem (at_record, u16_traceRecords * sizeof(TRC_record)) ;
+  }
+
+  return (OK) ;
+}
+
+
+static SYSCALL WEB_Data (struct http_request *       request,
+                         WEB_format_enum       const t_format)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_Data                                                   //
+//                 - Streams the buckets of a tier, oldest first, a chunk at  //
+//                   a time through a fixed-size buffer, or sends a binary    //
+//                   dump of one snapshot. Parameters: meter (hex) selects    //
+//                   the bucket memory set by WEB_SetDataSource, tier (hex)   //
+//                   any of its tiers (0 = the first described), optional     //
+//                   from and to (seconds) limit the buckets to those         //
+//                   starting in [from, to), optional factor (decimal) adds   //
+//                   them up in groups, see WEB_WriteGroups, optional archive //
+//                   (decimal) set to 1 reads the tier's archive instead,     //
+//                   see WEB_WriteArchive                                     //
+//                 - Rows of a tier with statistics also hold the lowest and  //
+//                   highest load of the bucket, in pulses per hour           //
+////////////////////////////////////////////////////////////////////////////////
+{
+  WEB_status            result           = WEB_OK ;
+
+  static const BYTE     at_meterParam[]  = "meter" ;
+  static const BYTE     at_tierParam[]   = "tier" ;
+  static const BYTE     at_fromParam[]   = "from" ;
+  static const BYTE     at_toParam[]     = "to" ;
+  static const BYTE     at_factorParam[] = "factor" ;
+  static const BYTE     at_archiveParam[]= "archive" ;
+  unsigned short        u16_meterNumber  = 0 ;
+  unsigned short        u16_tierNumber   = 0 ;
+  unsigned long         u32_from         = 0 ;
+  unsigned long         u32_to           = 0xFFFFFFFFUL ;
+  BOOL                  b_toGiven        = FALSE ;
+  unsigned short        u16_factor       = 1 ;
+  unsigned short        u16_archive      = 0 ;
+  unsigned char         u8_required      = 0 ;
+  char *                as8_buffer       = getmem (WEB_DATA_BUFFER) ;
+  unsigned short        u16_used ;
+  unsigned int          au24_chunk[WEB_DATA_CHUNK] ;
+  BMM_statistics_struct* at_stats        = NULL ;
+  unsigned int          u24_units ;
+  BMM_range_struct      t_range ;
+  BMM_range_struct      t_statsRange ;
+  BMM_archiveReader_struct t_reader ;
+  void*                 pv_tier          = NULL ;
+  unsigned int          u24_unitsPerKPulses ;
+  unsigned short        u16_bucketNr ;
+  unsigned short        u16_shift ;
+  unsigned short        u16_index ;
+  unsigned long         u32_nextTime ;
+  BOOL                  b_json           = (t_format == e_formatJson) ;
+  BOOL                  b_first          = TRUE ;
+  BOOL                  b_done           = FALSE ;
+  unsigned char         u8_index ;
+
+  if (result == WEB_OK)
+  {
+    // Check the number of parameters and the buffer
+    if ( (request->numparams < 2   ) ||
+         (request->numparams > 6   ) ||
+         (as8_buffer         == NULL)    )
+    {
+      (void)xc_printf ("WEB_Data: Parameter error (number).\n") ;
+      // Tell the client the request is erroneous
+      http_output_reply (request, HTTP_404_NOT_FOUND) ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // Retrieve the values of the parameters
+    for (u8_index = 0; (u8_index < request->numparams) && (result == WEB_OK); u8_index ++)
+    {
+      // Fill out a pointer to the parameter name for easier reference
+      char const * const ps8_paramName = (char *)(request->params[u8_index].key) ;
+
+      if (strcmp(at_meterParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt16 (&u16_meterNumber,
+                            http_find_argument (request, at_meterParam),
+                            e_radix_hexadecimal) ;
+        u8_required |= 0x01 ;
+      }
+      else if (strcmp(at_tierParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt16 (&u16_tierNumber,
+                            http_find_argument (request, at_tierParam),
+                            e_radix_hexadecimal) ;
+        u8_required |= 0x02 ;
+      }
+      else if (strcmp(at_fromParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt32 (&u32_from,
+                            http_find_argument (request, at_fromParam),
+                            e_radix_decimal) ;
+      }
+      else if (strcmp(at_toParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt32 (&u32_to,
+                            http_find_argument (request, at_toParam),
+                            e_radix_decimal) ;
+        b_toGiven = TRUE ;
+      }
+      else if (strcmp(at_factorParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt16 (&u16_factor,
+                            http_find_argument (request, at_factorParam),
+                            e_radix_decimal) ;
+      }
+      else if (strcmp(at_archiveParam, ps8_paramName) == 0)
+      {
+        CNV_StringToUInt16 (&u16_archive,
+                            http_find_argument (request, at_archiveParam),
+                            e_radix_decimal) ;
+      }
+      else
+      {
+        (void)xc_printf ("WEB_Data: Parameter error (name).\n") ;
+        // Tell the client the request is erroneous
+        http_output_reply (request, HTTP_404_NOT_FOUND) ;
+        result = WEB_ERR_PARAM ;
+      }
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    // Lookup the tier of the requested meter
+    if ( (u8_required                                   == 0x03          ) &&
+         (u16_meterNumber                               <  WEB_MAX_METERS) &&
+         (at_dataSource[u16_meterNumber].pv_bmmInstance != NULL          ) &&
+         (u16_tierNumber                                <= 0xFF          )    )
+    {
+      (void)BMM_GetTier (at_dataSource[u16_meterNumber].pv_bmmInstance, (unsigned char)u16_tierNumber, &pv_tier) ;
+    }
+
+    // The binary dump holds the tier's own buckets only, the archive
+    // is read as it was stored
+    if ( (pv_tier     == NULL              ) ||
+         (u16_factor  == 0                 ) ||
+         (u16_archive >  1                 ) ||
+         ( (u16_factor >  1             ) &&
+           (t_format   == e_formatBinary)    ) ||
+         ( (u16_archive == 1             ) &&
+           ( (u16_factor >  1             ) ||
+             (t_format   == e_formatBinary)    )    )    )
+    {
+      (void)xc_printf ("WEB_Data: Parameter error (value).\n") ;
+      // Tell the client the request is erroneous
+      http_output_reply (request, HTTP_404_NOT_FOUND) ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if ( (result      == WEB_OK) &&
+       (u16_archive == 1     )    )
+  {
+    // Only a tier with an archive can be read from it
+    if (BMM_OpenArchive (pv_tier, &t_reader) != BMM_OK)
+    {
+      (void)xc_printf ("WEB_Data: Parameter error (archive).\n") ;
+      // Tell the client the request is erroneous
+      http_output_reply (request, HTTP_404_NOT_FOUND) ;
+      result = WEB_ERR_PARAM ;
+    }
+  }
+
+  if (result == WEB_OK)
+  {
+    u24_unitsPerKPulses = at_dataSource[u16_meterNumber].u24_unitsPerKPulses ;
+
+    // Tell the client the request has been granted
+    http_output_reply (request, HTTP_200_OK) ;
+  }
+
+  if ( (result   == WEB_OK        ) &&
+       (t_format == e_formatBinary)    )
+  {
+    // Send one snapshot without formatting, the buffer holds the header
+    WEB_WriteDump (request, pv_tier, u24_unitsPerKPulses, u16_meterNumber, u16_tierNumber, u32_from, u32_to, b_toGiven, (unsigned char *)as8_buffer) ;
+  }
+  else if (result == WEB_OK)
+  {
+    // Find the first bucket that starts at or after 'from'
+    (void)BMM_GetBucketRange (pv_tier, 0, 1, au24_chunk, &t_range) ;
+
+    // The load columns need a chunk of statistics next to the counts
+    if ( (t_range.b_statistics) &&
+         (u16_factor  == 1    ) &&
+         (u16_archive == 0    )    )
+    {
+      at_stats = getmem (WEB_DATA_CHUNK * sizeof(BMM_statistics_struct)) ;
+      if (at_stats == NULL)
+      {
+        (void)xc_printf ("WEB_Data: Memory error (statistics).\n") ;
+      }
+    }
+
+    if (b_json)
+    {
+      xc_sprintf (as8_buffer, as8_dataJsonHead, u16_meterNumber, u16_tierNumber) ;
+    }
+    else
+    {
+      strcpy (as8_buffer, (at_stats != NULL) ? as8_dataCsvHeadStats : as8_dataCsvHead) ;
+    }
+    u16_used = strlen (as8_buffer) ;
+
+    if (u16_archive == 1)
+    {
+      // The archived buckets, which go back beyond the tier's own
+      WEB_WriteArchive (request, &t_reader, u24_unitsPerKPulses, u32_from, u32_to,
+                        b_json, as8_buffer, &u16_used) ;
+    }
+    else if (u16_factor > 1)
+    {
+      // Groups of buckets, from the oldest one if 'from' lies before it
+      WEB_WriteGroups (request, pv_tier, u24_unitsPerKPulses, u16_factor,
+                       (u32_from > t_range.u32_timeStamp) ? u32_from : t_range.u32_timeStamp,
+                       u32_to, b_json, as8_buffer, &u16_used) ;
+    }
+    else
+    {
+      u16_bucketNr = 0 ;
+      u32_nextTime = t_range.u32_timeStamp ;
+      if ( (t_range.u16_nrCopied > 0           ) &&
+           (u32_from             > u32_nextTime)    )
+      {
+        RTC_AlignTime    (t_range.t_period, u32_from, &u32_from) ;
+        RTC_CountPeriods (t_range.t_period, u32_nextTime, u32_from, t_range.u16_nrOfBuckets, &u16_bucketNr) ;
+        RTC_AddPeriods   (t_range.t_period, u32_nextTime, u16_bucketNr, &u32_nextTime) ;
+      }
+
+      while (!b_done)
+      {
+        (void)BMM_GetBucketRange (pv_tier, u16_bucketNr, WEB_DATA_CHUNK, au24_chunk, &t_range) ;
+
+        if (at_stats != NULL)
+        {
+          (void)BMM_GetStatsRange (pv_tier, u16_bucketNr, WEB_DATA_CHUNK, at_stats, &t_statsRange) ;
+          if (t_statsRange.u32_generation != t_range.u32_generation)
+          {
+            // A bucket changed between the two copies, read the chunk again
+            continue ;
+          }
+        }
+
+        if ( (t_range.u16_nrCopied  > 0           ) &&
+             (t_range.u32_timeStamp > u32_nextTime)    )
+        {
+          // A bucket change dropped the oldest bucket, the others moved down
+          RTC_CountPeriods (t_range.t_period, u32_nextTime, t_range.u32_timeStamp, u16_bucketNr, &u16_shift) ;
+          if (u16_shift > 0)
+          {
+            u16_bucketNr -= u16_shift ;
+            continue ;
+          }
+
+          // The bucket expected was dropped itself, continue from here
+          u32_nextTime = t_range.u32_timeStamp ;
+        }
+
+        for (u16_index = 0; (u16_index < t_range.u16_nrCopied) && (!b_done); u16_index ++)
+        {
+          if (u32_nextTime >= u32_to)
+          {
+            b_done = TRUE ;
+          }
+          else
+          {
+            u24_units = (au24_chunk[u16_index] * u24_unitsPerKPulses + 500) / 1000 ;
+
+            // Time stamp, pulses and units of one bucket, and its load
+            if (b_json)
+            {
+              if (!b_first)
+              {
+                as8_buffer[u16_used ++] = ',' ;
+              }
+              as8_buffer[u16_used ++] = '[' ;
+            }
+            CNV_UInt32ToString (&(as8_buffer[u16_used]), u32_nextTime, 1, '0', e_radix_decimal) ;
+            u16_used += strlen (&(as8_buffer[u16_used])) ;
+            xc_sprintf (&(as8_buffer[u16_used]), as8_dataRow,
+                        au24_chunk[u16_index], u24_units / 1000, u24_units % 1000) ;
+            u16_used += strlen (&(as8_buffer[u16_used])) ;
+            if (at_stats != NULL)
+            {
+              xc_sprintf (&(as8_buffer[u16_used]), as8_dataStats,
+                          at_stats[u16_index].u24_minRate, at_stats[u16_index].u24_maxRate) ;
+              u16_used += strlen (&(as8_buffer[u16_used])) ;
+            }
+            strcpy (&(as8_buffer[u16_used]), b_json ? as8_dataJsonEnd : as8_dataCsvEnd) ;
+            u16_used += strlen (&(as8_buffer[u16_used])) ;
+            b_first = FALSE ;
+
+            // Send the buffer before the next row could overflow it
+            if (u16_used > WEB_DATA_BUFFER - WEB_DATA_MAX_ROW)
+            {
+              __http_write (request, as8_buffer, u16_used) ;
+              u16_used = 0 ;
+            }
+
+            RTC_AddPeriods (t_range.t_period, u32_nextTime, 1, &u32_nextTime) ;
+          }
+        }
+
+        // A short chunk holds the newest closed bucket
+        if (t_range.u16_nrCopied < WEB_DATA_CHUNK)
+        {
+          b_done = TRUE ;
+        }
+        u16_bucketNr += t_range.u16_nrCopied ;
+      }
+    }
+
+    if (b_json)
+    {
+      strcpy (&(as8_buffer[u16_used]), as8_dataJsonTail) ;
+      u16_used += strlen (&(as8_buffer[u16_used])) ;
+    }
+    __http_write (request, as8_buffer, u16_used) ;
+  }
+
+  if (at_stats != NULL)
+  {
+    freemem (at_stats, WEB_DATA_CHUNK * sizeof(BMM_statistics_struct)) ;
+  }
+
+  if (as8_buffer != NULL)
+  {
+    freemem (as8_buffer, WEB_DATA_BUFFER) ;
+  }
+
+  return (OK) ;
+}
+
+
+static void WEB_MakeETag (char           * const as8_etag,
+                          unsigned short   const u16_webNumber,
+                          unsigned long    const u32_version)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_MakeETag                                               //
+//                 - Fills out the entity tag of a page: its web number and   //
+//                   the version of the data it shows, in hex and quoted      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  as8_etag[0] = '"' ;
+  CNV_UInt16ToString (&(as8_etag[1]), u16_webNumber, 1, '0', e_radix_hexadecimal) ;
+  strcat (as8_etag, "-") ;
+  CNV_UInt32ToString (&(as8_etag[strlen(as8_etag)]), u32_version, 1, '0', e_radix_hexadecimal) ;
+  strcat (as8_etag, "\"") ;
+
+  return ;
+}
+
+
+static BOOL WEB_NotModified (struct http_request *       request,
+                             char          const * const as8_etag)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_NotModified                                            //
+//                 - Adds the entity tag to the reply and checks it against   //
+//                   the If-None-Match header of the request. If the client   //
+//                   has this version already, replies 304 without a body.    //
+//                   The only function that reads or writes HTTP headers, so  //
+//                   an httpd with other header calls only changes this one   //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BOOL         b_notModified = FALSE ;
+  char const * ps8_tags ;
+
+  http_add_header (request, as8_headerETag, as8_etag) ;
+
+  // The header may list several tags, or '*' for any version
+  ps8_tags = http_find_header (request, as8_headerIfNoneMatch) ;
+  if ( (ps8_tags != NULL                    ) &&
+       ( (strstr(ps8_tags, as8_etag) != NULL) ||
+         (strcmp(ps8_tags, "*")      == 0   )    )    )
+  {
+    http_output_reply (request, HTTP_304_NOT_MODIFIED) ;
+    b_notModified = TRUE ;
+  }
+
+  return (b_notModified) ;
+}
+
+
+static void WEB_WriteDump (struct http_request  * const request,
+                           void                 * const pv_tier,
+                           unsigned int           const u24_unitsPerKPulses,
+                           unsigned short         const u16_meterNumber,
+                           unsigned short         const u16_tierNumber,
+                           unsigned long          const u32_from,
+                           unsigned long          const u32_to,
+                           BOOL                   const b_toGiven,
+                           unsigned char        * const au8_header)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_WriteDump                                              //
+//                 - Sends a header and the buckets of one snapshot as they   //
+//                   are in memory, see WEB_Site.h for the layout             //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned int *        au24_value ;
+  unsigned int          u24_first ;
+  unsigned short        u16_nrOfValues ;
+  unsigned short        u16_bucketNr     = 0 ;
+  unsigned short        u16_nrOfBuckets  = 0 ;
+  unsigned long         u32_aligned ;
+  BMM_range_struct      t_range ;
+
+  // Find the first bucket that starts at or after 'from'
+  (void)BMM_GetBucketRange (pv_tier, 0, 1, &u24_first, &t_range) ;
+  if ( (t_range.u16_nrCopied > 0                    ) &&
+       (u32_from             > t_range.u32_timeStamp)    )
+  {
+    RTC_AlignTime    (t_range.t_period, u32_from, &u32_aligned) ;
+    RTC_CountPeriods (t_range.t_period, t_range.u32_timeStamp, u32_aligned, t_range.u16_nrOfBuckets, &u16_bucketNr) ;
+  }
+
+  // Take one snapshot of all buckets from there, one more may close meanwhile
+  u16_nrOfValues = t_range.u16_nrOfBuckets - u16_bucketNr + 1 ;
+  au24_value     = getmem (u16_nrOfValues * sizeof(unsigned int)) ;
+  if (au24_value == NULL)
+  {
+    (void)xc_printf ("WEB_Data: Memory error (snapshot).\n") ;
+    t_range.u16_nrCopied = 0 ;
+  }
+  else
+  {
+    (void)BMM_GetBucketRange (pv_tier, u16_bucketNr, u16_nrOfValues, au24_value, &t_range) ;
+  }
+
+  // Leave out the buckets that start at or after 'to', if given
+  u16_nrOfBuckets = t_range.u16_nrCopied ;
+  if ( (b_toGiven           ) &&
+       (u16_nrOfBuckets > 0 )    )
+  {
+    if (u32_to <= t_range.u32_timeStamp)
+    {
+      u16_nrOfBuckets = 0 ;
+    }
+    else
+    {
+      // Count the buckets before the one holding 'to', which is only sent
+      // if it starts before 'to'. Nothing is added to 'to', so it can't wrap
+      RTC_AlignTime    (t_range.t_period, u32_to, &u32_aligned) ;
+      RTC_CountPeriods (t_range.t_period, t_range.u32_timeStamp, u32_aligned, t_range.u16_nrCopied, &u16_nrOfBuckets) ;
+      if ( (u32_aligned     < u32_to              ) &&
+           (u16_nrOfBuckets < t_range.u16_nrCopied)    )
+      {
+        u16_nrOfBuckets ++ ;
+      }
+    }
+  }
+
+  // Fill out the header, little endian
+  au8_header[WEB_DUMP_VERSION_OFS]      = WEB_DUMP_VERSION ;
+  au8_header[WEB_DUMP_METER_OFS]        = (unsigned char)u16_meterNumber ;
+  au8_header[WEB_DUMP_TIER_OFS]         = (unsigned char)u16_tierNumber ;
+  au8_header[WEB_DUMP_PERIOD_OFS]       = (unsigned char)t_range.t_period ;
+  au8_header[WEB_DUMP_TIME_OFS]         = (unsigned char)(t_range.u32_timeStamp       ) ;
+  au8_header[WEB_DUMP_TIME_OFS+1]       = (unsigned char)(t_range.u32_timeStamp >>  8) ;
+  au8_header[WEB_DUMP_TIME_OFS+2]       = (unsigned char)(t_range.u32_timeStamp >> 16) ;
+  au8_header[WEB_DUMP_TIME_OFS+3]       = (unsigned char)(t_range.u32_timeStamp >> 24) ;
+  au8_header[WEB_DUMP_GENERATION_OFS]   = (unsigned char)(t_range.u32_generation       ) ;
+  au8_header[WEB_DUMP_GENERATION_OFS+1] = (unsigned char)(t_range.u32_generation >>  8) ;
+  au8_header[WEB_DUMP_GENERATION_OFS+2] = (unsigned char)(t_range.u32_generation >> 16) ;
+  au8_header[WEB_DUMP_GENERATION_OFS+3] = (unsigned char)(t_range.u32_generation >> 24) ;
+  au8_header[WEB_DUMP_COUNT_OFS]        = (unsigned char)(u16_nrOfBuckets     ) ;
+  au8_header[WEB_DUMP_COUNT_OFS+1]      = (unsigned char)(u16_nrOfBuckets >> 8) ;
+  au8_header[WEB_DUMP_WIDTH_OFS]        = (unsigned char)sizeof(unsigned int) ;
+  au8_header[WEB_DUMP_UNITS_OFS]        = (unsigned char)(u24_unitsPerKPulses       ) ;
+  au8_header[WEB_DUMP_UNITS_OFS+1]      = (unsigned char)(u24_unitsPerKPulses >>  8) ;
+  au8_header[WEB_DUMP_UNITS_OFS+2]      = (unsigned char)(u24_unitsPerKPulses >> 16) ;
+  __http_write (request, (char *)au8_header, WEB_DUMP_HEADER_SIZE) ;
+
+  if (au24_value != NULL)
+  {
+    // The counts as they are in memory, no formatting
+    if (u16_nrOfBuckets > 0)
+    {
+      __http_write (request, (char *)au24_value, u16_nrOfBuckets * sizeof(unsigned int)) ;
+    }
+    freemem (au24_value, u16_nrOfValues * sizeof(unsigned int)) ;
+  }
+
+  return ;
+}
+
+
+static void WEB_WriteGroups (struct http_request  * const request,
+                             void                 * const pv_tier,
+                             unsigned int           const u24_unitsPerKPulses,
+                             unsigned short         const u16_factor,
+                             unsigned long          const u32_from,
+                             unsigned long          const u32_to,
+                             BOOL                   const b_json,
+                             char                 * const as8_buffer,
+                             unsigned short       * const pu16_used)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_WriteGroups                                            //
+//                 - Streams the buckets of a tier added up in groups of      //
+//                   u16_factor, on the boundaries of BMM_Resample, from the  //
+//                   group holding u32_from up to and including the one       //
+//                   holding the current bucket, which makes it partial.      //
+//                   Groups starting at or after u32_to are left out          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long         au32_chunk[WEB_DATA_CHUNK] ;
+  unsigned long         u32_start        = u32_from ;
+  unsigned long         u32_expected     = 0 ;
+  unsigned long         u32_groupTime ;
+  unsigned long         u32_units ;
+  unsigned short        u16_index ;
+  BMM_range_struct      t_range ;
+  BOOL                  b_first          = TRUE ;
+  BOOL                  b_done           = FALSE ;
+
+  while (!b_done)
+  {
+    (void)BMM_Resample (pv_tier, u32_start, u16_factor, WEB_DATA_CHUNK, au32_chunk, &t_range) ;
+
+    if (t_range.u32_timeStamp < u32_expected)
+    {
+      // The previous chunk ended with the group of the current bucket
+      b_done = TRUE ;
+    }
+    else
+    {
+      u32_groupTime = t_range.u32_timeStamp ;
+      for (u16_index = 0; (u16_index < t_range.u16_nrCopied) && (!b_done); u16_index ++)
+      {
+        if (u32_groupTime >= u32_to)
+        {
+          b_done = TRUE ;
+        }
+        else
+        {
+          // Thousandths of units, without overflowing on large groups
+          u32_units = (au32_chunk[u16_index] / 1000) * u24_unitsPerKPulses +
+                      ((au32_chunk[u16_index] % 1000) * u24_unitsPerKPulses + 500) / 1000 ;
+
+          // Time stamp, pulses and units of one group
+          if (b_json)
+          {
+            if (!b_first)
+            {
+              as8_buffer[(*pu16_used) ++] = ',' ;
+            }
+            as8_buffer[(*pu16_used) ++] = '[' ;
+          }
+          CNV_UInt32ToString (&(as8_buffer[*pu16_used]), u32_groupTime, 1, '0', e_radix_decimal) ;
+          *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+          as8_buffer[(*pu16_used) ++] = ',' ;
+          CNV_UInt32ToString (&(as8_buffer[*pu16_used]), au32_chunk[u16_index], 1, '0', e_radix_decimal) ;
+          *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+          as8_buffer[(*pu16_used) ++] = ',' ;
+          CNV_UInt32ToString (&(as8_buffer[*pu16_used]), u32_units / 1000, 1, '0', e_radix_decimal) ;
+          *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+          xc_sprintf (&(as8_buffer[*pu16_used]), as8_dataFraction, (unsigned int)(u32_units % 1000)) ;
+          *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+          strcpy (&(as8_buffer[*pu16_used]), b_json ? as8_dataJsonEnd : as8_dataCsvEnd) ;
+          *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+          b_first = FALSE ;
+
+          // Send the buffer before the next row could overflow it
+          if (*pu16_used > WEB_DATA_BUFFER - WEB_DATA_MAX_ROW)
+          {
+            __http_write (request, as8_buffer, *pu16_used) ;
+            *pu16_used = 0 ;
+          }
+
+          RTC_AddPeriods (t_range.t_period, u32_groupTime, u16_factor, &u32_groupTime) ;
+        }
+      }
+
+      // A short chunk ends with the group of the current bucket
+      if (t_range.u16_nrCopied < WEB_DATA_CHUNK)
+      {
+        b_done = TRUE ;
+      }
+      u32_start    = u32_groupTime ;
+      u32_expected = u32_groupTime ;
+    }
+  }
+
+  return ;
+}
+
+
+static void WEB_WriteArchive (struct http_request      * const request,
+                              BMM_archiveReader_struct * const pt_reader,
+                              unsigned int               const u24_unitsPerKPulses,
+                              unsigned long              const u32_from,
+                              unsigned long              const u32_to,
+                              BOOL                       const b_json,
+                              char                     * const as8_buffer,
+                              unsigned short           * const pu16_used)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_WriteArchive                                           //
+//                 - Streams the buckets of an opened archive, oldest first,  //
+//                   up to the newest closed bucket, in the rows of the tier  //
+//                   itself without load columns. Buckets starting before     //
+//                   u32_from or at or after u32_to are left out. If the      //
+//                   block being read is dropped, the archive is opened again //
+//                   and the buckets sent already are skipped                 //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BMM_bucket            t_bucket ;
+  BMM_status            t_status ;
+  unsigned long         u32_nextTime     = u32_from ;
+  unsigned int          u24_units ;
+  BOOL                  b_first          = TRUE ;
+  BOOL                  b_done           = FALSE ;
+
+  while (!b_done)
+  {
+    t_status = BMM_ReadArchive (pt_reader, &t_bucket) ;
+
+    if (t_status == BMM_ERR_CHANGED)
+    {
+      // The oldest block was dropped under the reader, start over
+      (void)BMM_OpenArchive (pt_reader->pt_tier, pt_reader) ;
+    }
+    else if ( (t_status               != BMM_OK) ||
+              (t_bucket.u32_timeStamp >= u32_to)    )
+    {
+      b_done = TRUE ;
+    }
+    else if (t_bucket.u32_timeStamp >= u32_nextTime)
+    {
+      u24_units = (t_bucket.u24_value * u24_unitsPerKPulses + 500) / 1000 ;
+
+      // Time stamp, pulses and units of one bucket
+      if (b_json)
+      {
+        if (!b_first)
+        {
+          as8_buffer[(*pu16_used) ++] = ',' ;
+        }
+        as8_buffer[(*pu16_used) ++] = '[' ;
+      }
+      CNV_UInt32ToString (&(as8_buffer[*pu16_used]), t_bucket.u32_timeStamp, 1, '0', e_radix_decimal) ;
+      *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+      xc_sprintf (&(as8_buffer[*pu16_used]), as8_dataRow,
+                  t_bucket.u24_value, u24_units / 1000, u24_units % 1000) ;
+      *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+      strcpy (&(as8_buffer[*pu16_used]), b_json ? as8_dataJsonEnd : as8_dataCsvEnd) ;
+      *pu16_used += strlen (&(as8_buffer[*pu16_used])) ;
+      b_first = FALSE ;
+
+      // Send the buffer before the next row could overflow it
+      if (*pu16_used > WEB_DATA_BUFFER - WEB_DATA_MAX_ROW)
+      {
+        __http_write (request, as8_buffer, *pu16_used) ;
+        *pu16_used = 0 ;
+      }
+
+      u32_nextTime = t_bucket.u32_timeStamp + 1 ;
+    }
+  }
+
+  return ;
+}
+
+
 static PROCESS WEB_FillProcess (WEB_handle  const pt_instance)
 {
   WEB_tableInst_struct * const  pt_this = pt_instance ;
-  RTC_DateTime_struct           t_currTime ;
   void*                         pv_bmmInstance ;
-  unsigned short                u16_entryIndex ;
-  BMM_bucket                    t_bucket ;
 
   for (;;)
   {
     // Wait for a bucket-change event
     pv_bmmInstance = KE_MBoxReceive () ;
 
-    // Retrieve the new number of buckets
-    (void)BMM_GetNrOfBuckets (pv_bmmInstance, &(pt_this->u16_currEntries)) ;
+    // Render the buckets closed since the last event
+    WEB_UpdateRows (pt_this, pv_bmmInstance) ;
+  }
+
+  return (OK) ;
+}
+
+
+static void WEB_UpdateRows (WEB_tableInst_struct * const pt_this,
+                            void                 * const pv_bmmInstance)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_UpdateRows                                             //
+//                 - Renders the buckets closed since the last update over    //
+//                   the oldest rows of the ring; the other rows stay. If     //
+//                   more closed than the ring holds, all rows are rendered   //
+//                   again. Only the first row converts its time stamp, the   //
+//                   next rows step the date                                  //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned short                u16_nrOfBuckets ;
+  unsigned short                u16_firstBucket ;
+  unsigned short                u16_entryIndex ;
+  unsigned long                 u32_nrOfNew ;
+  unsigned long                 u32_nrOfRows ;
+  unsigned long                 u32_timeStamp ;
+  unsigned int                  u24_value ;
+  RTC_DateTime_struct           t_dateTime ;
+  BMM_range_struct              t_newest ;
+  BMM_range_struct              t_range ;
+  BOOL                          b_allRows ;
+
+  do
+  {
+    // The newest closed bucket tells how many closed since the last update
+    (void)BMM_GetNrOfBuckets (pv_bmmInstance, &u16_nrOfBuckets) ;
+    (void)BMM_GetBucketRange (pv_bmmInstance, (u16_nrOfBuckets > 0) ? u16_nrOfBuckets-1 : 0, 1, &u24_value, &t_newest) ;
+    u32_nrOfNew = t_newest.u32_generation - pt_this->u32_generation ;
+
+    // The ring must end up holding the newest buckets, as many as fit. If
+    // adding the new rows doesn't get it there, all rows are rendered again
+    u16_nrOfBuckets = (t_newest.u16_nrOfBuckets < pt_this->u16_nrOfEntries) ? t_newest.u16_nrOfBuckets : pt_this->u16_nrOfEntries ;
+    u32_nrOfRows    = pt_this->u16_currEntries + u32_nrOfNew ;
+    if (u32_nrOfRows > pt_this->u16_nrOfEntries)
+    {
+      u32_nrOfRows = pt_this->u16_nrOfEntries ;
+    }
+    b_allRows       = (u32_nrOfNew  > u16_nrOfBuckets) ||
+                      (u32_nrOfRows != u16_nrOfBuckets) ;
+    if (b_allRows)
+    {
+      u16_firstBucket = t_newest.u16_nrOfBuckets - u16_nrOfBuckets ;
+    }
+    else
+    {
+      u16_firstBucket = t_newest.u16_nrOfBuckets - (unsigned short)u32_nrOfNew ;
+    }
+
+    // Take a snapshot of the buckets to render, oldest first
+    (void)BMM_GetBucketRange (pv_bmmInstance, u16_firstBucket, pt_this->u16_nrOfEntries, pt_this->au24_value, &t_range) ;
+
+    // Count again if a bucket closed in between
+  } while (t_range.u32_generation != t_newest.u32_generation) ;
+
+  if (b_allRows)
+  {
+    // The first row rendered goes to the start of the ring
+    pt_this->u16_currEntries = 0 ;
+    pt_this->u16_newestEntry = pt_this->u16_nrOfEntries - 1 ;
+  }
 
-    for (u16_entryIndex = 0; u16_entryIndex < pt_this->u16_currEntries; u16_entryIndex ++)
+  u32_timeStamp = t_range.u32_timeStamp ;
+  RTC_Seconds2Date (u32_timeStamp, &t_dateTime) ;
+  for (u16_entryIndex = 0; u16_entryIndex < t_range.u16_nrCopied; u16_entryIndex ++)
+  {
+    if (u16_entryIndex > 0)
     {
-      (void)BMM_GetBucketCont (pv_bmmInstance, (pt_this->u16_currEntries-1) - u16_entryIndex, &t_bucket) ;
+      RTC_NextDate (t_range.t_period, &u32_timeStamp, &t_dateTime) ;
+    }
 
-      RTC_Seconds2Date (t_bucket.u32_timeStamp, &t_currTime) ;
+    pt_this->u16_newestEntry ++ ;
+    if (pt_this->u16_newestEntry >= pt_this->u16_nrOfEntries)
+    {
+      pt_this->u16_newestEntry = 0 ;
+    }
+    WEB_RenderEntry (pt_this, pt_this->at_entry[pt_this->u16_newestEntry], &t_dateTime, pt_this->au24_value[u16_entryIndex]) ;
 
-      xc_sprintf (pt_this->at_entry[u16_entryIndex], as8_pageTableNumEntry,
-                  t_currTime.u8_day, t_currTime.u8_month, t_currTime.u16_year,
-                  t_currTime.u8_hour, t_currTime.u8_minute, t_currTime.u8_second,
-                  t_bucket.u24_value,
-                  ((t_bucket.u24_value * pt_this->u24_unitsPerKPulses + 500) / 1000) / 1000,
-                  ((t_bucket.u24_value * pt_this->u24_unitsPerKPulses + 500) / 1000) % 1000) ;
+    if (pt_this->u16_currEntries < pt_this->u16_nrOfEntries)
+    {
+      pt_this->u16_currEntries ++ ;
     }
   }
+  pt_this->u32_generation = t_range.u32_generation ;
 
-  return (OK) ;
+  return ;
+}
+
+
+static void WEB_RenderEntry (WEB_tableInst_struct      * const pt_this,
+                             char                      * const ps8_entry,
+                             RTC_DateTime_struct const * const pt_dateTime,
+                             unsigned int                const u24_value)
+{
+  xc_sprintf (ps8_entry, as8_pageTableNumEntry,
+              pt_dateTime->u8_day, pt_dateTime->u8_month, pt_dateTime->u16_year,
+              pt_dateTime->u8_hour, pt_dateTime->u8_minute, pt_dateTime->u8_second,
+              u24_value,
+              ((u24_value * pt_this->u24_unitsPerKPulses + 500) / 1000) / 1000,
+              ((u24_value * pt_this->u24_unitsPerKPulses + 500) / 1000) % 1000) ;
+
+  return ;
+}
+
+
+static void WEB_WriteRows (struct http_request  * const request,
+                           WEB_tableInst_struct * const pt_this)
+{
+  unsigned short                u16_entryIndex ;
+  unsigned short                u16_nrOfEntries ;
+
+  // Walk the ring of rows, newest first
+  u16_entryIndex = pt_this->u16_newestEntry ;
+  for (u16_nrOfEntries = 0; u16_nrOfEntries < pt_this->u16_currEntries; u16_nrOfEntries ++)
+  {
+    __http_write (request, pt_this->at_entry[u16_entryIndex], strlen(pt_this->at_entry[u16_entryIndex])) ;
+
+    if (u16_entryIndex == 0)
+    {
+      u16_entryIndex = pt_this->u16_nrOfEntries ;
+    }
+    u16_entryIndex -- ;
+  }
+
+  return ;
+}
+
+
+static void WEB_WriteLazyRows (struct http_request  * const request,
+                               WEB_tableInst_struct * const pt_this)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       WEB_WriteLazyRows                                          //
+//                 - Sends the rows of a lazy table, after rendering the      //
+//                   buckets closed since the previous request. The first     //
+//                   request allocates the ring, so a table nobody reads      //
+//                   takes no memory                                          //
+////////////////////////////////////////////////////////////////////////////////
+{
+  BOOL                          b_claimed = FALSE ;
+
+  // Wait for a concurrent request to finish with the rows
+  for (;;)
+  {
+    KE_CriticalBegin () ;
+    if (!pt_this->b_busy)
+    {
+      pt_this->b_busy = TRUE ;
+      b_claimed       = TRUE ;
+    }
+    KE_CriticalEnd () ;
+
+    if (b_claimed)
+    {
+      break ;
+    }
+    KE_TaskSleep10 (1) ;
+  }
+
+  if (pt_this->at_entry == NULL)
+  {
+    pt_this->at_entry = getmem (pt_this->u16_nrOfEntries * (sizeof(WEB_tableEntry) + sizeof(unsigned int))) ;
+    if (pt_this->at_entry == NULL)
+    {
+      (void)xc_printf ("WEB_Table: Memory error (entries).\n") ;
+    }
+    else
+    {
+      pt_this->au24_value = (unsigned int*)&(pt_this->at_entry[pt_this->u16_nrOfEntries]) ;
+    }
+  }
+
+  if (pt_this->at_entry != NULL)
+  {
+    WEB_UpdateRows (pt_this, pt_this->pv_bmmInstance) ;
+    WEB_WriteRows  (request, pt_this) ;
+  }
+
+  pt_this->b_busy = FALSE ;
+
+  return ;
 }
 
 
@@ -916,14 +2170,13 @@ static PROCESS WEB_MeterProcess (WEB_handle  const pt_instance)
     // Wait for a measurement-change event
     pv_phdInstance = KE_MBoxReceive () ;
 
-    // Retrieve the new measurement data
-    PHD_GetPulsesPerMinute (pv_phdInstance, &u24_nrOfPulses) ;
+    // Retrieve the new measurement data, as pulses per hour
+    PHD_GetPulsesPerHour (pv_phdInstance, &u24_nrOfPulses) ;
 
-    // Extrapolate minute to an hour
-    pt_this->u24_currentLoad = u24_nrOfPulses * 60 ;
+    pt_this->u24_currentLoad = u24_nrOfPulses ;
 
-    // Fill out the load percentage
-    pt_this->u8_currentPerc  = (100 * u24_nrOfPulses) / pt_this->u24_maxCapacity ;
+    // Fill out the load percentage (the capacity is in pulses per minute)
+    pt_this->u8_currentPerc  = (100UL * u24_nrOfPulses) / (60UL * pt_this->u24_maxCapacity) ;
   }
 
   return (OK) ;
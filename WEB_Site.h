@@ -26,6 +26,30 @@
 #define WEB_ERR_PROCESS         (-4)                  // Process allocation errord
 #define WEB_ERR_NOFREESLOT      (-5)                  // No free client slot was found
 
+// Layout of /data.bin: a header of WEB_DUMP_HEADER_SIZE bytes, followed by
+// 'count' buckets of 'width' bytes each, oldest first. All fields and
+// buckets are little endian; bucket i starts 'i' periods after 'time'.
+#define WEB_DUMP_VERSION        (1)
+#define WEB_DUMP_VERSION_OFS    (0)                   // u8:  Layout version, WEB_DUMP_VERSION
+#define WEB_DUMP_METER_OFS      (1)                   // u8:  Meter, as requested
+#define WEB_DUMP_TIER_OFS       (2)                   // u8:  Tier of the bucket memory, as requested
+#define WEB_DUMP_PERIOD_OFS     (3)                   // u8:  Period of each bucket, t_event_enum
+#define WEB_DUMP_TIME_OFS       (4)                   // u32: Start of the first bucket, seconds since 1970
+#define WEB_DUMP_GENERATION_OFS (8)                   // u32: Bucket changes since creation
+#define WEB_DUMP_COUNT_OFS      (12)                  // u16: Number of buckets that follow
+#define WEB_DUMP_WIDTH_OFS      (14)                  // u8:  Bytes per bucket (3 on the eZ80)
+#define WEB_DUMP_UNITS_OFS      (15)                  // u24: Units per 1000 pulses
+#define WEB_DUMP_HEADER_SIZE    (18)
+
+// Layout of /trace.bin: a header of WEB_TRACE_HEADER_SIZE bytes, followed by
+// 'count' trace records of 4 bytes each, oldest first, see TRC_Trace.h. All
+// fields and records are little endian.
+#define WEB_TRACE_VERSION       (1)
+#define WEB_TRACE_VERSION_OFS   (0)                   // u8:  Layout version, WEB_TRACE_VERSION
+#define WEB_TRACE_COUNT_OFS     (1)                   // u16: Number of records that follow
+#define WEB_TRACE_BASE_OFS      (3)                   // u64: Time the first record is relative to, in us
+#define WEB_TRACE_HEADER_SIZE   (11)
+
 // WEB types
 typedef void*                   WEB_handle ;
 typedef char                    WEB_status ;          // Status/Error return type
@@ -42,6 +66,15 @@ WEB_status  WEB_CreateTable       (WEB_handle           * const ppt_instance,
                                    char           const * const ps8_tableName,
                                    char           const * const ps8_unitName) ;
 
+WEB_status  WEB_CreateLazyTable   (WEB_handle           * const ppt_instance,
+                                   void                 * const pv_bmmInstance,
+                                   unsigned short         const u16_nrOfEntries,
+                                   unsigned int           const u24_unitsPerKPulses,
+                                   unsigned short         const u16_webNumber,
+                                   char           const * const ps8_frameName,
+                                   char           const * const ps8_tableName,
+                                   char           const * const ps8_unitName) ;
+
 WEB_status  WEB_DeleteTable       (WEB_handle             const pt_instance) ;
 
 WEB_status  WEB_CreateMeter       (WEB_handle           * const ppt_instance,
@@ -57,4 +90,11 @@ WEB_status  WEB_DeleteMeter       (WEB_handle             const pt_instance) ;
 WEB_status  WEB_GetProcessId      (WEB_handle             const pt_instance,
                                    PID                  * const pt_processId) ;
 
+WEB_status  WEB_SetDataSource     (unsigned short         const u16_meterNumber,
+                                   void                 * const pv_bmmInstance,
+                                   unsigned int           const u24_unitsPerKPulses) ;
+
+WEB_status  WEB_SetTrace          (void                 * const pv_trcInstance,
+                                   unsigned short         const u16_nrOfRecords) ;
+
 #endif //WEB_SITE_H
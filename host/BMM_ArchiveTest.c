@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : BMM_ArchiveTest.c
+// Function: Host test of the bucket archive of BMM_BucketMemory.c. Feeds five
+//           years of hourly buckets of a synthetic gas, water and electricity
+//           profile into an archive, reads them back while it is written and
+//           reports the bytes taken per bucket, and the hours of history the
+//           archive size of main.c holds. The profiles are made up, the
+//           figures of a real meter depend on its consumption.
+//           Build and run from the root of the project:
+//             gcc -Wno-multichar -I host -I . -o archivetest host/BMM_ArchiveTest.c
+//             ./archivetest
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include "BMM_BucketMemory.c"                             // Reaches BMM_Archive
+
+#define TST_NOF_BUCKETS       (24UL * 365UL * 5UL)        // Five years of hours
+#define TST_BIG_BLOCKS        (4096)                      // Holds all buckets of any profile
+#define TST_MAIN_BLOCKS       (64)                        // NOF_ARCHIVE_BLOCKS of main.c
+#define TST_SECONDS_PER_HOUR  (3600UL)
+#define TST_START_TIME        (1072915200UL)              // 1 Jan 2004 00:00 UTC
+#define TST_GAP_BUCKET        (5000UL)                    // A power cut before this bucket
+#define TST_GAP_HOURS         (50UL)
+
+typedef enum
+{
+  e_profileGas = 0,
+  e_profileWater,
+  e_profileElectricity,
+  e_nrOfProfiles
+} TST_profile_enum ;
+
+static char const * const as8_profileName[e_nrOfProfiles] = { "gas", "water", "electricity" } ;
+
+static unsigned long        u32_random ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel and RTC stand-ins. The archive is fed directly, so no process       //
+// runs and only the hour arithmetic of the RTC is needed                     //
+////////////////////////////////////////////////////////////////////////////////
+
+void * getmem (unsigned long const u32_nrOfBytes)
+{
+  return (malloc (u32_nrOfBytes)) ;
+}
+
+int freemem (void * const pv_memory, unsigned long const u32_nrOfBytes)
+{
+  free (pv_memory) ;
+  return (OK) ;
+}
+
+int xc_printf (char const * const as8_format, ...)
+{
+  return (0) ;
+}
+
+PID KE_TaskCreate (procptr const func_process, int const s24_stackSize, int const s24_priority,
+                   char const * const as8_name, int const s24_nrOfArgs, ...)
+{
+  return ((PID)1) ;
+}
+
+int KE_TaskResume (PID const t_processId)
+{
+  return (OK) ;
+}
+
+int KE_TaskDelete (PID const t_processId)
+{
+  return (OK) ;
+}
+
+void KE_TaskSleep100 (int const s24_ticks)
+{
+  return ;
+}
+
+int KE_MBoxSend (PID const t_processId, void * const pv_message)
+{
+  return (OK) ;
+}
+
+void * KE_MBoxReceive (void)
+{
+  return (NULL) ;
+}
+
+RTC_status RTC_GetTime (unsigned long * const pu32_seconds)
+{
+  *pu32_seconds = TST_START_TIME ;
+  return (RTC_OK) ;
+}
+
+RTC_status RTC_AddClient (t_event_enum const t_event, PID const t_processId, void const * const pv_message)
+{
+  return (RTC_OK) ;
+}
+
+RTC_status RTC_RemoveClient (PID const t_processId, void const * const pv_message)
+{
+  return (RTC_OK) ;
+}
+
+void RTC_AlignTime (t_event_enum const t_period, unsigned long const u32_seconds, unsigned long * const pu32_aligned)
+{
+  *pu32_aligned = u32_seconds - (u32_seconds % TST_SECONDS_PER_HOUR) ;
+}
+
+void RTC_AlignGroup (t_event_enum const t_period, unsigned short const u16_factor,
+                     unsigned long const u32_seconds, unsigned long * const pu32_aligned)
+{
+  *pu32_aligned = u32_seconds - (u32_seconds % (TST_SECONDS_PER_HOUR * u16_factor)) ;
+}
+
+void RTC_AddPeriods (t_event_enum const t_period, unsigned long const u32_seconds,
+                     long const s32_nrOfPeriods, unsigned long * const pu32_result)
+{
+  *pu32_result = u32_seconds + (long)TST_SECONDS_PER_HOUR * s32_nrOfPeriods ;
+}
+
+void RTC_CountPeriods (t_event_enum const t_period, unsigned long const u32_from, unsigned long const u32_to,
+                       unsigned short const u16_max, unsigned short * const pu16_nrOfPeriods)
+{
+  unsigned long u32_nrOfPeriods = (u32_to - u32_from) / TST_SECONDS_PER_HOUR ;
+
+  *pu16_nrOfPeriods = (u32_nrOfPeriods < u16_max) ? (unsigned short)u32_nrOfPeriods : u16_max ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Test                                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int TST_Random (unsigned int const u24_range)
+{
+  // Same numbers on every host
+  u32_random = (u32_random * 1103515245UL + 12345UL) & 0x7FFFFFFFUL ;
+  return ((unsigned int)((u32_random >> 8) % u24_range)) ;
+}
+
+
+static unsigned int TST_Pulses (TST_profile_enum const t_profile,
+                                unsigned long    const u32_bucket)
+{
+  unsigned int u24_hour = (unsigned int)(u32_bucket % 24UL) ;
+  unsigned int u24_pulses ;
+
+  switch (t_profile)
+  {
+    case e_profileGas:
+      // Heating and hot water by day, now and then
+      u24_pulses = ( (u24_hour >= 6) && (u24_hour < 23) && (TST_Random (3) == 0) ) ? TST_Random (40) : 0 ;
+      break ;
+
+    case e_profileWater:
+      // A tap now and then, day and night
+      u24_pulses = (TST_Random (5) == 0) ? TST_Random (30) : 0 ;
+      break ;
+
+    default:
+      // A base load that never stops, cooking in the evening
+      u24_pulses = 300 + TST_Random (700) + ( (u24_hour > 17) && (u24_hour < 22) ? 1500 : 0 ) ;
+      break ;
+  }
+
+  return (u24_pulses) ;
+}
+
+
+static unsigned long TST_Time (unsigned long const u32_bucket)
+{
+  unsigned long u32_time = TST_START_TIME + u32_bucket * TST_SECONDS_PER_HOUR ;
+
+  if (u32_bucket >= TST_GAP_BUCKET)
+  {
+    u32_time += TST_GAP_HOURS * TST_SECONDS_PER_HOUR ;
+  }
+
+  return (u32_time) ;
+}
+
+
+static BMM_tier_struct * TST_CreateTier (unsigned short const u16_nrOfBlocks,
+                                         BMM_handle     * const ppt_instance)
+{
+  BMM_tier_desc const t_desc  = { e_hourEvent, 24, BMM_NO_PARENT } ;
+  BMM_handle          pt_tier = NULL ;
+
+  if ( (BMM_Create     (ppt_instance, 1, &t_desc)         != BMM_OK) ||
+       (BMM_SetArchive (*ppt_instance, 0, u16_nrOfBlocks) != BMM_OK) ||
+       (BMM_GetTier    (*ppt_instance, 0, &pt_tier)       != BMM_OK)    )
+  {
+    printf ("Can't create a bucket memory of %u blocks.\n", u16_nrOfBlocks) ;
+    exit (EXIT_FAILURE) ;
+  }
+
+  return (pt_tier) ;
+}
+
+
+static unsigned long TST_Profile (TST_profile_enum const t_profile)
+{
+  BMM_handle                  pt_big ;
+  BMM_handle                  pt_main ;
+  BMM_tier_struct *           pt_bigTier  = TST_CreateTier (TST_BIG_BLOCKS,  &pt_big) ;
+  BMM_tier_struct *           pt_mainTier = TST_CreateTier (TST_MAIN_BLOCKS, &pt_main) ;
+  BMM_archiveReader_struct    t_reader ;
+  BMM_bucket                  t_bucket ;
+  unsigned int *              au24_pulses = malloc (TST_NOF_BUCKETS * sizeof(unsigned int)) ;
+  unsigned long               u32_bucket ;
+  unsigned long               u32_nrRead     = 0 ;
+  unsigned long               u32_nrOfErrors = 0 ;
+  unsigned long               u32_nrOfBuckets ;
+  unsigned long               u32_nrOfBytes ;
+  unsigned long               u32_mainBuckets ;
+  unsigned long               u32_mainBytes ;
+
+  u32_random = 1 ;
+  (void)BMM_OpenArchive (pt_bigTier, &t_reader) ;
+
+  for (u32_bucket = 0; u32_bucket < TST_NOF_BUCKETS; u32_bucket ++)
+  {
+    au24_pulses[u32_bucket] = TST_Pulses (t_profile, u32_bucket) ;
+    BMM_Archive (pt_bigTier->pt_archive,  e_hourEvent, TST_Time (u32_bucket), au24_pulses[u32_bucket]) ;
+    BMM_Archive (pt_mainTier->pt_archive, e_hourEvent, TST_Time (u32_bucket), au24_pulses[u32_bucket]) ;
+
+    // Read back now and then, also in the middle of a run
+    if ( (TST_Random (7) == 0                  ) ||
+         (u32_bucket     == TST_NOF_BUCKETS - 1)    )
+    {
+      while (BMM_ReadArchive (&t_reader, &t_bucket) == BMM_OK)
+      {
+        if ( (u32_nrRead             >= TST_NOF_BUCKETS        ) ||
+             (t_bucket.u24_value     != au24_pulses[u32_nrRead]) ||
+             (t_bucket.u32_timeStamp != TST_Time (u32_nrRead)  )    )
+        {
+          u32_nrOfErrors ++ ;
+        }
+        u32_nrRead ++ ;
+      }
+    }
+  }
+
+  // Pending runs count as the buckets they hold
+  (void)BMM_GetArchiveUse (pt_bigTier,  &u32_nrOfBuckets, &u32_nrOfBytes) ;
+  (void)BMM_GetArchiveUse (pt_mainTier, &u32_mainBuckets, &u32_mainBytes) ;
+  printf ("%-12s %6lu/%-6lu buckets read back, %lu errors, %5.2f bytes per bucket, "
+          "%u blocks hold %lu hours\n",
+          as8_profileName[t_profile], u32_nrRead, TST_NOF_BUCKETS, u32_nrOfErrors,
+          (double)u32_nrOfBytes / (double)u32_nrOfBuckets,
+          TST_MAIN_BLOCKS, u32_mainBuckets) ;
+
+  free (au24_pulses) ;
+  (void)BMM_Delete (pt_main) ;
+  (void)BMM_Delete (pt_big) ;
+
+  return (u32_nrOfErrors + (TST_NOF_BUCKETS - u32_nrRead)) ;
+}
+
+
+int main (void)
+{
+  TST_profile_enum t_profile ;
+  unsigned long    u32_nrOfErrors = 0 ;
+
+  for (t_profile = e_profileGas; t_profile < e_nrOfProfiles; t_profile ++)
+  {
+    u32_nrOfErrors += TST_Profile (t_profile) ;
+  }
+
+  return ((u32_nrOfErrors == 0) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
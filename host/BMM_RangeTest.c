@@ -0,0 +1,321 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : BMM_RangeTest.c
+// Function: Host test of the range index of BMM_BucketMemory.c. Runs the
+//           real process of a bucket memory with a small hour tier, one
+//           message at a time, and compares BMM_GetRangeSum for every range
+//           with the sum of the buckets copied by BMM_GetBucketRange. The
+//           index is set on a tier that has wrapped its ring already, then
+//           the tier is rotated far past the ring, with gaps, and fed well
+//           over 2^32 pulses. On a host with 64-bit longs the totals don't
+//           wrap at 32 bits, so they are also moved close to the top of an
+//           unsigned long, where they wrap on any host.
+//           Build and run from the root of the project:
+//             gcc -Wno-multichar -I host -I . -o rangetest host/BMM_RangeTest.c
+//             ./rangetest
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include <limits.h>
+#include <setjmp.h>
+#include "BMM_BucketMemory.c"                             // Reaches BMM_Process and the index
+
+#define TST_NOF_BUCKETS       (24)                        // Closed buckets of the tier
+#define TST_SECONDS_PER_HOUR  (3600UL)
+#define TST_START_TIME        (1072915200UL)              // 1 Jan 2004 00:00 UTC
+#define TST_MAX_FETCH         (0x400000UL)                // Pulses per fetch; four fit a bucket of 24 bits
+#define TST_FETCHES_PER_HOUR  (4)
+#define TST_PREFILL_HOURS     (30)                        // Wraps the ring before the index is set
+#define TST_NOF_HOURS         (3000)
+#define TST_LONG_GAP_HOUR     (1500)                      // A power cut longer than the ring
+#define TST_LONG_GAP_HOURS    (40)
+#define TST_TOTAL_OFFSET      (ULONG_MAX - 3UL * TST_MAX_FETCH)
+
+static unsigned long        u32_now      = TST_START_TIME ;
+static unsigned long        u32_random   = 1 ;
+static unsigned int         u24_fetched ;
+static void *               pv_message ;
+static jmp_buf              t_idle ;
+static unsigned long long   u64_nrOfPulses ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel and RTC stand-ins. The process runs until it waits for a message    //
+// that isn't there, then the wait jumps back to the test                     //
+////////////////////////////////////////////////////////////////////////////////
+
+void * getmem (unsigned long const u32_nrOfBytes)
+{
+  return (malloc (u32_nrOfBytes)) ;
+}
+
+int freemem (void * const pv_memory, unsigned long const u32_nrOfBytes)
+{
+  free (pv_memory) ;
+  return (OK) ;
+}
+
+int xc_printf (char const * const as8_format, ...)
+{
+  return (0) ;
+}
+
+PID KE_TaskCreate (procptr const func_process, int const s24_stackSize, int const s24_priority,
+                   char const * const as8_name, int const s24_nrOfArgs, ...)
+{
+  return ((PID)1) ;
+}
+
+int KE_TaskResume (PID const t_processId)
+{
+  return (OK) ;
+}
+
+int KE_TaskDelete (PID const t_processId)
+{
+  return (OK) ;
+}
+
+void KE_TaskSleep100 (int const s24_ticks)
+{
+  return ;
+}
+
+int KE_MBoxSend (PID const t_processId, void * const pv_message)
+{
+  return (OK) ;
+}
+
+void * KE_MBoxReceive (void)
+{
+  void * pv_received = pv_message ;
+
+  if (pv_received == NULL)
+  {
+    longjmp (t_idle, 1) ;
+  }
+  pv_message = NULL ;
+
+  return (pv_received) ;
+}
+
+RTC_status RTC_GetTime (unsigned long * const pu32_seconds)
+{
+  *pu32_seconds = u32_now ;
+  return (RTC_OK) ;
+}
+
+RTC_status RTC_AddClient (t_event_enum const t_event, PID const t_processId, void const * const pv_message)
+{
+  return (RTC_OK) ;
+}
+
+RTC_status RTC_RemoveClient (PID const t_processId, void const * const pv_message)
+{
+  return (RTC_OK) ;
+}
+
+void RTC_AlignTime (t_event_enum const t_period, unsigned long const u32_seconds, unsigned long * const pu32_aligned)
+{
+  *pu32_aligned = u32_seconds - (u32_seconds % TST_SECONDS_PER_HOUR) ;
+}
+
+void RTC_AlignGroup (t_event_enum const t_period, unsigned short const u16_factor,
+                     unsigned long const u32_seconds, unsigned long * const pu32_aligned)
+{
+  *pu32_aligned = u32_seconds - (u32_seconds % (TST_SECONDS_PER_HOUR * u16_factor)) ;
+}
+
+void RTC_AddPeriods (t_event_enum const t_period, unsigned long const u32_seconds,
+                     long const s32_nrOfPeriods, unsigned long * const pu32_result)
+{
+  *pu32_result = u32_seconds + (long)TST_SECONDS_PER_HOUR * s32_nrOfPeriods ;
+}
+
+void RTC_CountPeriods (t_event_enum const t_period, unsigned long const u32_from, unsigned long const u32_to,
+                       unsigned short const u16_max, unsigned short * const pu16_nrOfPeriods)
+{
+  unsigned long u32_nrOfPeriods = (u32_to - u32_from) / TST_SECONDS_PER_HOUR ;
+
+  *pu16_nrOfPeriods = (u32_nrOfPeriods < u16_max) ? (unsigned short)u32_nrOfPeriods : u16_max ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Test                                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long TST_Random (unsigned long const u32_range)
+{
+  // Same numbers on every host
+  u32_random = (u32_random * 1103515245UL + 12345UL) & 0x7FFFFFFFUL ;
+  return ((u32_random >> 8) % u32_range) ;
+}
+
+
+static char TST_Fetch (BMM_handle const pt_instance, unsigned int * const pu24_pulses)
+{
+  *pu24_pulses = u24_fetched ;
+  return (0) ;
+}
+
+
+static void TST_Deliver (BMM_handle const pt_instance,
+                         void     * const pv_event)
+{
+  // Run the process until it has handled the message
+  pv_message = pv_event ;
+  if (setjmp (t_idle) == 0)
+  {
+    (void)BMM_Process (pt_instance) ;
+  }
+}
+
+
+static void TST_Feed (BMM_handle const pt_instance)
+{
+  u24_fetched     = (unsigned int)TST_Random (TST_MAX_FETCH) ;
+  u64_nrOfPulses += u24_fetched ;
+  TST_Deliver (pt_instance, &u24_fetched) ;
+}
+
+
+static void TST_NextHours (BMM_instance_struct * const pt_this,
+                           unsigned long         const u32_nrOfHours)
+{
+  u32_now += u32_nrOfHours * TST_SECONDS_PER_HOUR ;
+  TST_Deliver (pt_this, &(pt_this->at_tier[0])) ;
+}
+
+
+static unsigned long TST_CheckRanges (BMM_tier_struct * const pt_tier)
+{
+  unsigned int        au24_values[TST_NOF_BUCKETS + 1] ;
+  BMM_range_struct    t_range ;
+  BMM_bucket          t_running ;
+  unsigned short      u16_nrOfBuckets ;
+  unsigned short      u16_from ;
+  unsigned short      u16_to ;
+  unsigned short      u16_bucket ;
+  unsigned long       u32_sum ;
+  unsigned long       u32_bruteSum ;
+  unsigned long       u32_nrOfErrors = 0 ;
+
+  // The closed buckets, then the running one as the last value
+  (void)BMM_GetNrOfBuckets (pt_tier, &u16_nrOfBuckets) ;
+  (void)BMM_GetBucketRange (pt_tier, 0, TST_NOF_BUCKETS, au24_values, &t_range) ;
+  (void)BMM_GetBucketCont  (pt_tier, u16_nrOfBuckets, &t_running) ;
+  au24_values[u16_nrOfBuckets] = t_running.u24_value ;
+  if (t_range.u16_nrCopied != u16_nrOfBuckets)
+  {
+    u32_nrOfErrors ++ ;
+  }
+
+  for (u16_from = 0; u16_from <= u16_nrOfBuckets; u16_from ++)
+  {
+    for (u16_to = u16_from; u16_to <= u16_nrOfBuckets; u16_to ++)
+    {
+      u32_bruteSum = 0 ;
+      for (u16_bucket = u16_from; u16_bucket <= u16_to; u16_bucket ++)
+      {
+        u32_bruteSum += au24_values[u16_bucket] ;
+      }
+
+      if ( (BMM_GetRangeSum (pt_tier, u16_from, u16_to, &u32_sum) != BMM_OK) ||
+           (u32_sum != u32_bruteSum                                        )    )
+      {
+        printf ("Buckets %u..%u of %u: %lu, expected %lu\n", u16_from, u16_to, u16_nrOfBuckets, u32_sum, u32_bruteSum) ;
+        u32_nrOfErrors ++ ;
+      }
+    }
+  }
+
+  // A range past the running bucket is refused
+  if (BMM_GetRangeSum (pt_tier, 0, u16_nrOfBuckets + 1, &u32_sum) != BMM_ERR_PARAM)
+  {
+    u32_nrOfErrors ++ ;
+  }
+
+  return (u32_nrOfErrors) ;
+}
+
+
+int main (void)
+{
+  BMM_tier_desc const   t_desc = { e_hourEvent, TST_NOF_BUCKETS, BMM_NO_PARENT } ;
+  BMM_handle            pt_instance ;
+  BMM_instance_struct * pt_this ;
+  BMM_tier_struct *     pt_tier ;
+  unsigned short        u16_bucket ;
+  unsigned int          u24_hour ;
+  unsigned int          u24_fetch ;
+  unsigned long         u32_nrOfChecks = 0 ;
+  unsigned long         u32_nrOfErrors = 0 ;
+
+  if ( (BMM_Create          (&pt_instance, 1, &t_desc)    != BMM_OK) ||
+       (BMM_SetMeteringFunc (pt_instance, TST_Fetch)      != BMM_OK)    )
+  {
+    printf ("Can't create a bucket memory.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+  pt_this = pt_instance ;
+  pt_tier = &(pt_this->at_tier[0]) ;
+
+  // Fill the tier past its ring before it gets an index
+  for (u24_hour = 0; u24_hour < TST_PREFILL_HOURS; u24_hour ++)
+  {
+    TST_Feed      (pt_this) ;
+    TST_NextHours (pt_this, 1) ;
+  }
+  TST_Feed (pt_this) ;
+
+  // The index is built from the buckets filled so far
+  if ( (BMM_SetRangeIndex (pt_instance, 0) != BMM_OK) ||
+       (BMM_Start         (pt_instance)    != BMM_OK)    )
+  {
+    printf ("Can't add a range index.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+  u32_nrOfErrors += TST_CheckRanges (pt_tier) ;
+  u32_nrOfChecks ++ ;
+
+  // Move the totals close to the top, so they wrap within a few fetches
+  for (u16_bucket = 0; u16_bucket < pt_tier->u16_nrOfBuckets; u16_bucket ++)
+  {
+    pt_tier->au32_pulseTotal[u16_bucket] += TST_TOTAL_OFFSET ;
+  }
+  pt_tier->u32_pulseTotal += TST_TOTAL_OFFSET ;
+
+  for (u24_hour = 0; u24_hour < TST_NOF_HOURS; u24_hour ++)
+  {
+    for (u24_fetch = 0; u24_fetch < TST_FETCHES_PER_HOUR; u24_fetch ++)
+    {
+      TST_Feed (pt_this) ;
+
+      // Also while a bucket is running
+      u32_nrOfErrors += TST_CheckRanges (pt_tier) ;
+      u32_nrOfChecks ++ ;
+    }
+
+    if (u24_hour == TST_LONG_GAP_HOUR)
+    {
+      TST_NextHours (pt_this, TST_LONG_GAP_HOURS) ;
+    }
+    else
+    {
+      // Now and then a few hours are missed
+      TST_NextHours (pt_this, (TST_Random (20) == 0) ? 2 + TST_Random (4) : 1) ;
+    }
+    u32_nrOfErrors += TST_CheckRanges (pt_tier) ;
+    u32_nrOfChecks ++ ;
+  }
+
+  printf ("%lu pulses over %lu bucket changes, %lu times all ranges compared, %lu errors\n",
+          (unsigned long)u64_nrOfPulses, pt_tier->u32_generation, u32_nrOfChecks, u32_nrOfErrors) ;
+
+  (void)BMM_Delete (pt_instance) ;
+
+  return ( ( (u32_nrOfErrors == 0            ) &&
+             (u64_nrOfPulses >  0xFFFFFFFFULL)    ) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : DMP_DumpDecoder.c
+// Function: Host decoder of the bucket dump of /data.bin (format=bin), see
+//           WEB_Site.h for its layout. Builds on any host with a C library;
+//           the dump is read byte by byte, so the endianness and the size of
+//           an int of the host don't matter.
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#define DMP_DUMPDECODER_C
+#include <kernel.h>
+#include <time.h>
+#include "RTC_RealTimeClock.h"
+typedef void                    Webpage ;             // Only WEB_Initialize uses it
+#include "WEB_Site.h"
+#include "DMP_DumpDecoder.h"
+
+#define DMP_MAX_WIDTH         (4)                         // Bytes of an unsigned long
+#define DMP_SECS_PER_MIN      (60UL)
+#define DMP_SECS_PER_QUARTER  (900UL)
+#define DMP_SECS_PER_HOUR     (3600UL)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local Prototypes                                                           //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long DMP_GetLittle (unsigned char const * const au8_data,
+                                    unsigned char         const u8_nrOfBytes) ;
+static unsigned long DMP_BucketTime (DMP_dump_struct const * const pt_dump,
+                                     unsigned short          const u16_bucketNr) ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Exported functions                                                         //
+////////////////////////////////////////////////////////////////////////////////
+
+DMP_status DMP_Open (unsigned char   const * const au8_data,
+                     unsigned long           const u32_nrOfBytes,
+                     DMP_dump_struct       * const pt_dump)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       DMP_Open                                                   //
+//                 - Checks the header of a dump and fills in its fields. The //
+//                   dump must stay in memory while its buckets are read      //
+////////////////////////////////////////////////////////////////////////////////
+{
+  DMP_status result = DMP_OK ;
+
+  if (result == DMP_OK)
+  {
+    // Do parameter check
+    if ( (au8_data == NULL) ||
+         (pt_dump  == NULL)    )
+    {
+      (void)fprintf (stderr, "DMP_Open: Parameter error.\n") ;
+      result = DMP_ERR_PARAM ;
+    }
+  }
+
+  if (result == DMP_OK)
+  {
+    // Check the header
+    if (u32_nrOfBytes < WEB_DUMP_HEADER_SIZE)
+    {
+      result = DMP_ERR_SIZE ;
+    }
+    else if (au8_data[WEB_DUMP_VERSION_OFS] != WEB_DUMP_VERSION)
+    {
+      result = DMP_ERR_VERSION ;
+    }
+  }
+
+  if (result == DMP_OK)
+  {
+    pt_dump->u8_meter            = au8_data[WEB_DUMP_METER_OFS] ;
+    pt_dump->u8_tier             = au8_data[WEB_DUMP_TIER_OFS] ;
+    pt_dump->u8_period           = au8_data[WEB_DUMP_PERIOD_OFS] ;
+    pt_dump->u8_width            = au8_data[WEB_DUMP_WIDTH_OFS] ;
+    pt_dump->u32_time            = DMP_GetLittle (&au8_data[WEB_DUMP_TIME_OFS],       4) ;
+    pt_dump->u32_generation      = DMP_GetLittle (&au8_data[WEB_DUMP_GENERATION_OFS], 4) ;
+    pt_dump->u32_unitsPerKPulses = DMP_GetLittle (&au8_data[WEB_DUMP_UNITS_OFS],      3) ;
+    pt_dump->u16_count           = (unsigned short)DMP_GetLittle (&au8_data[WEB_DUMP_COUNT_OFS], 2) ;
+    pt_dump->pu8_buckets         = &au8_data[WEB_DUMP_HEADER_SIZE] ;
+
+    // A bucket must fit an unsigned long, and all of them the dump
+    if ( (pt_dump->u8_width == 0            ) ||
+         (pt_dump->u8_width >  DMP_MAX_WIDTH)    )
+    {
+      result = DMP_ERR_VERSION ;
+    }
+    else if ( (u32_nrOfBytes - WEB_DUMP_HEADER_SIZE) <
+              (unsigned long)pt_dump->u16_count * pt_dump->u8_width )
+    {
+      result = DMP_ERR_SIZE ;
+    }
+  }
+
+  return (result) ;
+}
+// End: DMP_Open
+
+
+DMP_status DMP_GetBucket (DMP_dump_struct const * const pt_dump,
+                          unsigned short          const u16_bucketNr,
+                          unsigned long         * const pu32_value,
+                          unsigned long         * const pu32_timeStamp)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       DMP_GetBucket                                              //
+//                 - Gets the pulses of a bucket, oldest first, and the start //
+//                   of its period. Either pointer may be NULL                //
+////////////////////////////////////////////////////////////////////////////////
+{
+  DMP_status result = DMP_OK ;
+
+  if (result == DMP_OK)
+  {
+    // Do parameter check
+    if ( (pt_dump      == NULL              ) ||
+         (u16_bucketNr >= pt_dump->u16_count)    )
+    {
+      (void)fprintf (stderr, "DMP_GetBucket: Parameter error.\n") ;
+      result = DMP_ERR_PARAM ;
+    }
+  }
+
+  if (result == DMP_OK)
+  {
+    if (pu32_value != NULL)
+    {
+      *pu32_value = DMP_GetLittle (&pt_dump->pu8_buckets[(unsigned long)u16_bucketNr * pt_dump->u8_width],
+                                   pt_dump->u8_width) ;
+    }
+    if (pu32_timeStamp != NULL)
+    {
+      *pu32_timeStamp = DMP_BucketTime (pt_dump, u16_bucketNr) ;
+    }
+  }
+
+  return (result) ;
+}
+// End: DMP_GetBucket
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local functions                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long DMP_GetLittle (unsigned char const * const au8_data,
+                                    unsigned char         const u8_nrOfBytes)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       DMP_GetLittle                                              //
+//                 - Reads a little endian value of up to 4 bytes             //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long u32_value = 0 ;
+  unsigned char u8_byte   = u8_nrOfBytes ;
+
+  while (u8_byte > 0)
+  {
+    u8_byte -- ;
+    u32_value = (u32_value << 8) | au8_data[u8_byte] ;
+  }
+
+  return (u32_value) ;
+}
+// End: DMP_GetLittle
+
+
+static unsigned long DMP_BucketTime (DMP_dump_struct const * const pt_dump,
+                                     unsigned short          const u16_bucketNr)
+////////////////////////////////////////////////////////////////////////////////
+// Function:       DMP_BucketTime                                             //
+//                 - Start of a bucket, like RTC_AddPeriods on the device.    //
+//                   Days and up are stepped in local time, see DMP_DEVICE_TZ //
+////////////////////////////////////////////////////////////////////////////////
+{
+  unsigned long u32_seconds = pt_dump->u32_time ;
+  time_t        t_time      = (time_t)pt_dump->u32_time ;
+  struct tm     t_local ;
+
+  switch (pt_dump->u8_period)
+  {
+    case e_secondEvent:
+      u32_seconds += u16_bucketNr ;
+      break ;
+
+    case e_minuteEvent:
+      u32_seconds += u16_bucketNr * DMP_SECS_PER_MIN ;
+      break ;
+
+    case e_quarterEvent:
+      u32_seconds += u16_bucketNr * DMP_SECS_PER_QUARTER ;
+      break ;
+
+    case e_hourEvent:
+      u32_seconds += u16_bucketNr * DMP_SECS_PER_HOUR ;
+      break ;
+
+    default:
+      // Let mktime sort out the calendar and the DST changes
+      (void)localtime_r (&t_time, &t_local) ;
+      switch (pt_dump->u8_period)
+      {
+        case e_dayEvent:   t_local.tm_mday += u16_bucketNr ;     break ;
+        case e_weekEvent:  t_local.tm_mday += u16_bucketNr * 7 ; break ;
+        case e_monthEvent: t_local.tm_mon  += u16_bucketNr ;     break ;
+        default:           t_local.tm_year += u16_bucketNr ;     break ;
+      }
+      t_local.tm_isdst = -1 ;
+      u32_seconds      = (unsigned long)mktime (&t_local) ;
+      break ;
+  }
+
+  return (u32_seconds) ;
+}
+// End: DMP_BucketTime
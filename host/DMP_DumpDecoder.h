@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : DMP_DumpDecoder.h
+// Function: Include file of 'DMP_DumpDecoder.h'.
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DMP_DUMPDECODER_H                             // Include file already compiled ?
+#define DMP_DUMPDECODER_H
+
+#ifdef DMP_DUMPDECODER_C                              // Compiled in DMP_DumpDecoder.c ?
+#define DMP_EXTERN
+#else
+#ifdef __cplusplus                                    // Compiled for C++ ?
+#define DMP_EXTERN extern "C"
+#else
+#define DMP_EXTERN extern
+#endif // __cplusplus
+#endif // DMP_DUMPDECODER_C
+
+
+#define DMP_OK                  (0)                   // All Ok
+#define DMP_ERR_PARAM           (-1)                  // Parameter error
+#define DMP_ERR_VERSION         (-2)                  // Dump has an unknown layout
+#define DMP_ERR_SIZE            (-3)                  // Dump is shorter than its header says
+
+// Time zone of the Meter Maid, see RTC_LOCAL and RTC_DST of
+// RTC_RealTimeClock.c. Days and up start at local midnight, so TZ has to be
+// set to this before the buckets of such a dump are given a time.
+#define DMP_DEVICE_TZ           "CET-1CEST,M3.5.0,M10.5.0/3"
+
+
+// DMP types
+typedef char                    DMP_status ;          // Status/Error return type
+typedef struct
+{
+  unsigned char         u8_meter ;                    // Meter, as requested
+  unsigned char         u8_tier ;                     // Tier of the bucket memory, as requested
+  unsigned char         u8_period ;                   // Period of each bucket, t_event_enum
+  unsigned char         u8_width ;                    // Bytes per bucket
+  unsigned long         u32_time ;                    // Start of the first bucket, seconds since 1970
+  unsigned long         u32_generation ;              // Bucket changes since creation
+  unsigned long         u32_unitsPerKPulses ;         // Units per 1000 pulses
+  unsigned short        u16_count ;                   // Number of buckets
+  unsigned char const * pu8_buckets ;                 // First bucket, inside the dump
+} DMP_dump_struct ;
+
+
+DMP_status  DMP_Open            (unsigned char   const * const au8_data,
+                                 unsigned long           const u32_nrOfBytes,
+                                 DMP_dump_struct       * const pt_dump) ;
+
+DMP_status  DMP_GetBucket       (DMP_dump_struct const * const pt_dump,
+                                 unsigned short          const u16_bucketNr,
+                                 unsigned long         * const pu32_value,
+                                 unsigned long         * const pu32_timeStamp) ;
+
+
+#endif //DMP_DUMPDECODER_H
@@ -0,0 +1,282 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : DMP_DumpTest.c
+// Function: Host test of DMP_DumpDecoder.c. Builds a year of hourly buckets
+//           both as a dump of /data.bin and as the rows table.cgi sends,
+//           checks that both give back the same buckets, and reports the
+//           bytes per row and the rows per second the host decodes of each.
+//           The device side isn't timed: the dump copies the ring as is,
+//           where table.cgi formats a date and two numbers per row.
+//           Build and run from the root of the project:
+//             gcc -O2 -Wno-multichar -I host -I . -o dumptest host/DMP_DumpTest.c host/DMP_DumpDecoder.c
+//             ./dumptest
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include <time.h>
+#include "RTC_RealTimeClock.h"
+typedef void                    Webpage ;             // Only WEB_Initialize uses it
+#include "WEB_Site.h"
+#include "DMP_DumpDecoder.h"
+
+#define TST_NOF_BUCKETS       (24U * 366U)                // A year of hours
+#define TST_NOF_DAYS          (800U)                      // Crosses a few DST changes
+#define TST_NOF_RUNS          (20)
+#define TST_WIDTH             (3)                         // Bytes per bucket on the eZ80
+#define TST_UNITS             (1000UL)                    // Units per 1000 pulses
+#define TST_START_TIME        (1072911600UL)              // 1 Jan 2004 00:00 CET
+#define TST_SECONDS_PER_HOUR  (3600UL)
+#define TST_ROW_SIZE          (160)                       // Longest row of TST_ROW
+
+// A row as as8_pageTableNumEntry of WEB_Site.c formats it
+#define TST_ROW               "<tr>" \
+                              "<td><b>%02u/%02u/%04u %02u:%02u.%02u</b></td>" \
+                              "<td align=\"right\"><b>%u</b></td>" \
+                              "<td align=\"right\"><b>%u.%03u</b></td>" \
+                              "</tr>"
+
+static unsigned long        u32_random = 1 ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Test                                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int TST_Random (unsigned int const u24_range)
+{
+  // Same numbers on every host
+  u32_random = (u32_random * 1103515245UL + 12345UL) & 0x7FFFFFFFUL ;
+  return ((unsigned int)((u32_random >> 8) % u24_range)) ;
+}
+
+
+static unsigned long TST_MakeDump (unsigned char * const au8_dump,
+                                   unsigned int    const u24_period,
+                                   unsigned short  const u16_nrOfBuckets,
+                                   unsigned int  * const au24_pulses)
+{
+  unsigned char * pu8_bucket = &au8_dump[WEB_DUMP_HEADER_SIZE] ;
+  unsigned short  u16_bucket ;
+
+  // As WEB_WriteDump puts it together
+  memset (au8_dump, 0, WEB_DUMP_HEADER_SIZE) ;
+  au8_dump[WEB_DUMP_VERSION_OFS]      = WEB_DUMP_VERSION ;
+  au8_dump[WEB_DUMP_METER_OFS]        = 1 ;
+  au8_dump[WEB_DUMP_TIER_OFS]         = 2 ;
+  au8_dump[WEB_DUMP_PERIOD_OFS]       = (unsigned char)u24_period ;
+  au8_dump[WEB_DUMP_TIME_OFS + 0]     = (unsigned char)(TST_START_TIME      ) ;
+  au8_dump[WEB_DUMP_TIME_OFS + 1]     = (unsigned char)(TST_START_TIME >>  8) ;
+  au8_dump[WEB_DUMP_TIME_OFS + 2]     = (unsigned char)(TST_START_TIME >> 16) ;
+  au8_dump[WEB_DUMP_TIME_OFS + 3]     = (unsigned char)(TST_START_TIME >> 24) ;
+  au8_dump[WEB_DUMP_GENERATION_OFS]   = 7 ;
+  au8_dump[WEB_DUMP_COUNT_OFS + 0]    = (unsigned char)(u16_nrOfBuckets      ) ;
+  au8_dump[WEB_DUMP_COUNT_OFS + 1]    = (unsigned char)(u16_nrOfBuckets >>  8) ;
+  au8_dump[WEB_DUMP_WIDTH_OFS]        = TST_WIDTH ;
+  au8_dump[WEB_DUMP_UNITS_OFS + 0]    = (unsigned char)(TST_UNITS      ) ;
+  au8_dump[WEB_DUMP_UNITS_OFS + 1]    = (unsigned char)(TST_UNITS >>  8) ;
+  au8_dump[WEB_DUMP_UNITS_OFS + 2]    = (unsigned char)(TST_UNITS >> 16) ;
+
+  for (u16_bucket = 0; u16_bucket < u16_nrOfBuckets; u16_bucket ++)
+  {
+    au24_pulses[u16_bucket] = TST_Random (60000) ;
+    *pu8_bucket ++ = (unsigned char)(au24_pulses[u16_bucket]      ) ;
+    *pu8_bucket ++ = (unsigned char)(au24_pulses[u16_bucket] >>  8) ;
+    *pu8_bucket ++ = (unsigned char)(au24_pulses[u16_bucket] >> 16) ;
+  }
+
+  return ((unsigned long)(pu8_bucket - au8_dump)) ;
+}
+
+
+static unsigned long TST_MakeTable (char         * const as8_table,
+                                    unsigned int * const au24_pulses)
+{
+  char *        ps8_row = as8_table ;
+  unsigned int  u24_bucket ;
+  unsigned long u32_value ;
+  time_t        t_time ;
+  struct tm     t_local ;
+
+  // Newest first, as WEB_WriteRows sends them
+  for (u24_bucket = TST_NOF_BUCKETS; u24_bucket > 0; u24_bucket --)
+  {
+    t_time    = (time_t)(TST_START_TIME + (u24_bucket - 1) * TST_SECONDS_PER_HOUR) ;
+    u32_value = (au24_pulses[u24_bucket - 1] * TST_UNITS + 500) / 1000 ;
+    (void)localtime_r (&t_time, &t_local) ;
+    ps8_row += sprintf (ps8_row, TST_ROW,
+                        t_local.tm_mday, t_local.tm_mon + 1, t_local.tm_year + 1900,
+                        t_local.tm_hour, t_local.tm_min,     t_local.tm_sec,
+                        au24_pulses[u24_bucket - 1],
+                        (unsigned int)(u32_value / 1000), (unsigned int)(u32_value % 1000)) ;
+  }
+
+  return ((unsigned long)(ps8_row - as8_table)) ;
+}
+
+
+static unsigned long TST_ReadDump (unsigned char const * const au8_dump,
+                                   unsigned long         const u32_nrOfBytes,
+                                   unsigned int  const * const au24_pulses)
+{
+  DMP_dump_struct t_dump ;
+  unsigned short  u16_bucket ;
+  unsigned long   u32_value ;
+  unsigned long   u32_time ;
+  unsigned long   u32_nrOfErrors = 0 ;
+
+  if ( (DMP_Open (au8_dump, u32_nrOfBytes, &t_dump) != DMP_OK         ) ||
+       (t_dump.u16_count                            != TST_NOF_BUCKETS)    )
+  {
+    return (TST_NOF_BUCKETS) ;
+  }
+
+  for (u16_bucket = 0; u16_bucket < t_dump.u16_count; u16_bucket ++)
+  {
+    (void)DMP_GetBucket (&t_dump, u16_bucket, &u32_value, &u32_time) ;
+    if ( (u32_value != au24_pulses[u16_bucket]                             ) ||
+         (u32_time  != TST_START_TIME + u16_bucket * TST_SECONDS_PER_HOUR)    )
+    {
+      u32_nrOfErrors ++ ;
+    }
+  }
+
+  return (u32_nrOfErrors) ;
+}
+
+
+static unsigned long TST_ReadTable (char         const * const as8_table,
+                                    unsigned int const * const au24_pulses)
+{
+  char const *  ps8_row        = as8_table ;
+  unsigned int  u24_bucket     = TST_NOF_BUCKETS ;
+  unsigned long u32_nrOfErrors = 0 ;
+  unsigned long u32_time ;
+  unsigned int  u24_pulses ;
+  struct tm     t_local ;
+  struct tm     t_other ;
+
+  memset (&t_local, 0, sizeof(t_local)) ;
+  while ( ((ps8_row = strstr (ps8_row, "<tr>")) != NULL) &&
+          (u24_bucket                           >  0   )    )
+  {
+    u24_bucket -- ;
+    if (sscanf (ps8_row, "<tr><td><b>%d/%d/%d %d:%d.%d</b></td><td align=\"right\"><b>%u<",
+                &t_local.tm_mday, &t_local.tm_mon, &t_local.tm_year,
+                &t_local.tm_hour, &t_local.tm_min, &t_local.tm_sec, &u24_pulses) != 7)
+    {
+      u32_nrOfErrors ++ ;
+    }
+    else
+    {
+      t_local.tm_mon  -= 1 ;
+      t_local.tm_year -= 1900 ;
+      t_local.tm_isdst = -1 ;
+      t_other          = t_local ;
+      u32_time         = (unsigned long)mktime (&t_local) ;
+      if (u32_time != TST_START_TIME + u24_bucket * TST_SECONDS_PER_HOUR)
+      {
+        // The hour DST ends is shown twice, the rows don't tell which is
+        // which. The collector has to guess, this one knows the answer
+        t_other.tm_isdst = !t_local.tm_isdst ;
+        u32_time         = (unsigned long)mktime (&t_other) ;
+      }
+      if ( (u24_pulses != au24_pulses[u24_bucket]                             ) ||
+           (u32_time   != TST_START_TIME + u24_bucket * TST_SECONDS_PER_HOUR)    )
+      {
+        u32_nrOfErrors ++ ;
+      }
+    }
+    ps8_row ++ ;
+  }
+
+  return (u32_nrOfErrors + u24_bucket) ;
+}
+
+
+static unsigned long TST_Days (void)
+{
+  unsigned char * au8_dump    = malloc (WEB_DUMP_HEADER_SIZE + TST_NOF_DAYS * TST_WIDTH) ;
+  unsigned int *  au24_pulses = malloc (TST_NOF_DAYS * sizeof(unsigned int)) ;
+  DMP_dump_struct t_dump ;
+  unsigned short  u16_bucket ;
+  unsigned long   u32_time ;
+  unsigned long   u32_lastTime   = 0 ;
+  unsigned long   u32_nrOfErrors = 0 ;
+  time_t          t_time ;
+  struct tm       t_local ;
+
+  // Each day must start at local midnight, 23, 24 or 25 hours after the last
+  (void)DMP_Open (au8_dump, TST_MakeDump (au8_dump, e_dayEvent, TST_NOF_DAYS, au24_pulses), &t_dump) ;
+  for (u16_bucket = 0; u16_bucket < t_dump.u16_count; u16_bucket ++)
+  {
+    (void)DMP_GetBucket (&t_dump, u16_bucket, NULL, &u32_time) ;
+    t_time = (time_t)u32_time ;
+    (void)localtime_r (&t_time, &t_local) ;
+    if ( (t_local.tm_hour != 0) ||
+         (t_local.tm_min  != 0) ||
+         (t_local.tm_sec  != 0) ||
+         ( (u16_bucket > 0                                           ) &&
+           ( (u32_time - u32_lastTime < 23 * TST_SECONDS_PER_HOUR) ||
+             (u32_time - u32_lastTime > 25 * TST_SECONDS_PER_HOUR)    ) ) )
+    {
+      u32_nrOfErrors ++ ;
+    }
+    u32_lastTime = u32_time ;
+  }
+
+  free (au24_pulses) ;
+  free (au8_dump) ;
+
+  return (u32_nrOfErrors) ;
+}
+
+
+int main (void)
+{
+  unsigned char * au8_dump    = malloc (WEB_DUMP_HEADER_SIZE + TST_NOF_BUCKETS * TST_WIDTH) ;
+  char *          as8_table   = malloc (TST_NOF_BUCKETS * TST_ROW_SIZE) ;
+  unsigned int *  au24_pulses = malloc (TST_NOF_BUCKETS * sizeof(unsigned int)) ;
+  unsigned long   u32_dumpBytes ;
+  unsigned long   u32_tableBytes ;
+  unsigned long   u32_nrOfErrors ;
+  clock_t         t_dumpTicks ;
+  clock_t         t_tableTicks ;
+  int             s24_run ;
+
+  // Dates as the Meter Maid shows them
+  (void)setenv ("TZ", DMP_DEVICE_TZ, 1) ;
+  tzset () ;
+
+  u32_dumpBytes  = TST_MakeDump  (au8_dump, e_hourEvent, TST_NOF_BUCKETS, au24_pulses) ;
+  u32_tableBytes = TST_MakeTable (as8_table, au24_pulses) ;
+  u32_nrOfErrors = TST_Days () ;
+
+  t_dumpTicks = clock () ;
+  for (s24_run = 0; s24_run < TST_NOF_RUNS; s24_run ++)
+  {
+    u32_nrOfErrors += TST_ReadDump (au8_dump, u32_dumpBytes, au24_pulses) ;
+  }
+  t_dumpTicks = clock () - t_dumpTicks ;
+
+  t_tableTicks = clock () ;
+  for (s24_run = 0; s24_run < TST_NOF_RUNS; s24_run ++)
+  {
+    u32_nrOfErrors += TST_ReadTable (as8_table, au24_pulses) ;
+  }
+  t_tableTicks = clock () - t_tableTicks ;
+
+  printf ("%-10s %6.2f bytes per row, %10.0f rows per second\n", "data.bin",
+          (double)u32_dumpBytes / TST_NOF_BUCKETS,
+          (double)TST_NOF_BUCKETS * TST_NOF_RUNS * CLOCKS_PER_SEC / (double)(t_dumpTicks  + 1)) ;
+  printf ("%-10s %6.2f bytes per row, %10.0f rows per second\n", "table.cgi",
+          (double)u32_tableBytes / TST_NOF_BUCKETS,
+          (double)TST_NOF_BUCKETS * TST_NOF_RUNS * CLOCKS_PER_SEC / (double)(t_tableTicks + 1)) ;
+  printf ("%lu errors\n", u32_nrOfErrors) ;
+
+  free (au24_pulses) ;
+  free (as8_table) ;
+  free (au8_dump) ;
+
+  return ((u32_nrOfErrors == 0) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : PHD_DebounceTest.c
+// Function: Host test of the adaptive debouncer of PHD_PulseHandler.c. Feeds
+//           a synthetic trace of a gas meter whose sensor bounces for up to
+//           40 ms on every pulse into a simulated instance, through
+//           PHD_HandlePulseAt, with the debounce bounds of main.c. The trace
+//           runs slow, jumps to the highest rate, chatters hard and slows down
+//           again. No bounce may be counted, no real pulse may be lost but for
+//           a short run at the start of the jump, and the chatter must not
+//           pull the debounce time down.
+//           Build and run from the root of the project:
+//             gcc -Wno-multichar -I host -I . -o debouncetest host/PHD_DebounceTest.c PHD_PulseHandler.c
+//             ./debouncetest
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include "TMR_Timer.h"
+#include "PHD_PulseHandler.h"
+
+#define TST_MAX_PPM           (100)                       // GAS_MAX_PPM of main.c
+#define TST_MIN_DEB_US        (50000UL)                   // GAS_MIN_DEB_US of main.c
+#define TST_MAX_DEB_US        (1000000UL)                 // GAS_MAX_DEB_US of main.c
+#define TST_BOUNCE_US         (40000UL)                   // Longest bounce after a pulse
+#define TST_SPIKE_LOSSES      (10)                        // Spike pulses which may be lost
+#define TST_US_MASK           (0xFFFFFFFFUL)              // The Long-parts are 32 bits on the target
+
+typedef struct
+{
+  char const *  as8_name ;
+  unsigned int  u24_nrOfPulses ;
+  unsigned long u32_minInterval ;                         // us
+  unsigned long u32_maxInterval ;                         // us
+  unsigned int  u24_maxBounces ;                          // Bounces after each pulse, at most
+} TST_phase_struct ;
+
+static TST_phase_struct const at_phase[] =
+{
+  { "slow",     200,  8000000UL, 20000000UL,  8 },
+  { "spike",    300,   680000UL,   720000UL,  8 },
+  { "chatter",  500,  2000000UL,  4000000UL, 20 },
+  { "slow",     100,  8000000UL, 20000000UL,  8 }
+} ;
+
+#define TST_NOF_PHASES        (sizeof(at_phase) / sizeof(at_phase[0]))
+#define TST_SPIKE_PHASE       (1)
+
+static unsigned long        u32_random = 1 ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel and timer stand-ins. No process runs; the instance is simulated     //
+////////////////////////////////////////////////////////////////////////////////
+
+void * getmem (unsigned long const u32_nrOfBytes)
+{
+  return (malloc (u32_nrOfBytes)) ;
+}
+
+int freemem (void * const pv_memory, unsigned long const u32_nrOfBytes)
+{
+  free (pv_memory) ;
+  return (OK) ;
+}
+
+int xc_printf (char const * const as8_format, ...)
+{
+  return (0) ;
+}
+
+PID KE_TaskCreate (procptr const func_process, int const s24_stackSize, int const s24_priority,
+                   char const * const as8_name, int const s24_nrOfArgs, ...)
+{
+  return ((PID)1) ;
+}
+
+int KE_TaskResume (PID const t_processId)
+{
+  return (OK) ;
+}
+
+int KE_TaskDelete (PID const t_processId)
+{
+  return (OK) ;
+}
+
+void KE_TaskSleep100 (int const s24_ticks)
+{
+  return ;
+}
+
+void KE_CriticalBegin (void)
+{
+  return ;
+}
+
+void KE_CriticalEnd (void)
+{
+  return ;
+}
+
+int KE_MBoxSend (PID const t_processId, void * const pv_message)
+{
+  return (OK) ;
+}
+
+void TMR_SetTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const timeout)
+{
+  return ;
+}
+
+void TMR_PostponeTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const postpone)
+{
+  return ;
+}
+
+BOOL TMR_CheckTimeout (TMR_ticks_struct const * const pt_timeout)
+{
+  return (FALSE) ;
+}
+
+unsigned long TMR_TimeoutLeft (TMR_ticks_struct const * const pt_timeout)
+{
+  return (TMR_SECOND) ;
+}
+
+void TMR_SetMicroStampIsr (TMR_micro_struct * const pt_microstamp)
+{
+  pt_microstamp->u32_lsLong = 0 ;
+  pt_microstamp->u32_msLong = 0 ;
+}
+
+void TMR_PostponeMicroStamp (TMR_micro_struct * const pt_microstamp, unsigned long const postpone_us)
+{
+  unsigned long u32_old = pt_microstamp->u32_lsLong ;
+
+  pt_microstamp->u32_lsLong = (u32_old + postpone_us) & TST_US_MASK ;
+  if (pt_microstamp->u32_lsLong < u32_old)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+}
+
+unsigned long TMR_MicroStampDiff (TMR_micro_struct const * const pt_newStamp,
+                                  TMR_micro_struct const * const pt_oldStamp)
+{
+  unsigned long long u64_new = ((unsigned long long)pt_newStamp->u32_msLong << 32) | pt_newStamp->u32_lsLong ;
+  unsigned long long u64_old = ((unsigned long long)pt_oldStamp->u32_msLong << 32) | pt_oldStamp->u32_lsLong ;
+
+  if (u64_new <= u64_old)
+  {
+    return (0) ;
+  }
+  return ((u64_new - u64_old > TST_US_MASK) ? TST_US_MASK : (unsigned long)(u64_new - u64_old)) ;
+}
+
+unsigned long TMR_MicroStampAge (TMR_micro_struct const * const pt_microstamp)
+{
+  return (0) ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Test                                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long TST_Random (unsigned long const u32_range)
+{
+  // Same numbers on every host
+  u32_random = (u32_random * 1103515245UL + 12345UL) & 0x7FFFFFFFUL ;
+  return ((u32_random >> 8) % u32_range) ;
+}
+
+
+static PHD_status TST_Pulse (PHD_handle               const pt_instance,
+                             TMR_micro_struct const * const pt_time)
+{
+  (void)PHD_AdvanceTime (pt_instance, pt_time) ;
+  return (PHD_HandlePulseAt (pt_instance, pt_time)) ;
+}
+
+
+int main (void)
+{
+  PHD_handle            pt_instance ;
+  PHD_statistics_struct t_statistics ;
+  TMR_micro_struct      t_now = { 0, 0 } ;
+  TMR_micro_struct      t_pulse ;
+  TMR_micro_struct      t_bounce ;
+  unsigned long         au32_offset[32] ;
+  unsigned long         u32_swap ;
+  unsigned int          u24_phase ;
+  unsigned int          u24_pulse ;
+  unsigned int          u24_bounce ;
+  unsigned int          u24_nrOfBounces ;
+  unsigned int          u24_index ;
+  unsigned int          u24_lost ;
+  unsigned int          u24_lateLost ;
+  unsigned int          u24_counted ;
+  unsigned long         u32_nrOfErrors = 0 ;
+
+  if ( (PHD_Initialize          (1)                                        != PHD_OK) ||
+       (PHD_Create              (&pt_instance, 0, TST_MAX_PPM)             != PHD_OK) ||
+       (PHD_SetAdaptiveDebounce (pt_instance, TST_MIN_DEB_US, TST_MAX_DEB_US) != PHD_OK) ||
+       (PHD_SetSimulated        (pt_instance, &t_now)                      != PHD_OK)    )
+  {
+    printf ("Can't create a simulated pulse handler.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+
+  for (u24_phase = 0; u24_phase < TST_NOF_PHASES; u24_phase ++)
+  {
+    u24_lost     = 0 ;
+    u24_lateLost = 0 ;
+    u24_counted  = 0 ;
+
+    for (u24_pulse = 0; u24_pulse < at_phase[u24_phase].u24_nrOfPulses; u24_pulse ++)
+    {
+      // The real pulse
+      TMR_PostponeMicroStamp (&t_now, at_phase[u24_phase].u32_minInterval +
+                                      TST_Random (at_phase[u24_phase].u32_maxInterval -
+                                                  at_phase[u24_phase].u32_minInterval + 1)) ;
+      t_pulse = t_now ;
+      if (TST_Pulse (pt_instance, &t_pulse) != PHD_OK)
+      {
+        u24_lost ++ ;
+        if (u24_pulse >= TST_SPIKE_LOSSES)
+        {
+          u24_lateLost ++ ;
+        }
+      }
+
+      // Its bounces, in order
+      u24_nrOfBounces = 1 + TST_Random (at_phase[u24_phase].u24_maxBounces) ;
+      for (u24_bounce = 0; u24_bounce < u24_nrOfBounces; u24_bounce ++)
+      {
+        au32_offset[u24_bounce] = 1000UL + TST_Random (TST_BOUNCE_US - 1000UL) ;
+        for (u24_index = u24_bounce; (u24_index > 0) && (au32_offset[u24_index - 1] > au32_offset[u24_index]); u24_index --)
+        {
+          u32_swap                    = au32_offset[u24_index] ;
+          au32_offset[u24_index]      = au32_offset[u24_index - 1] ;
+          au32_offset[u24_index - 1]  = u32_swap ;
+        }
+      }
+      for (u24_bounce = 0; u24_bounce < u24_nrOfBounces; u24_bounce ++)
+      {
+        t_bounce = t_pulse ;
+        TMR_PostponeMicroStamp (&t_bounce, au32_offset[u24_bounce]) ;
+        if (TST_Pulse (pt_instance, &t_bounce) == PHD_OK)
+        {
+          u24_counted ++ ;
+        }
+      }
+      t_now = t_bounce ;
+    }
+
+    (void)PHD_GetStatistics (pt_instance, &t_statistics) ;
+    printf ("%-8s %3u pulses, %2u lost (%u after the first %u), %u bounces counted, debounce %lu ms\n",
+            at_phase[u24_phase].as8_name, at_phase[u24_phase].u24_nrOfPulses,
+            u24_lost, u24_lateLost, TST_SPIKE_LOSSES, u24_counted,
+            t_statistics.u32_debounce / TMR_US_PER_MS) ;
+
+    // Bounces are never counted, real pulses only lost at the start of the jump
+    if ( (u24_counted != 0                                         ) ||
+         ( (u24_phase == TST_SPIKE_PHASE) && (u24_lateLost != 0) ) ||
+         ( (u24_phase != TST_SPIKE_PHASE) && (u24_lost     != 0) )    )
+    {
+      u32_nrOfErrors ++ ;
+    }
+
+    // Chatter must not pull the debounce time down to the lower bound
+    if (t_statistics.u32_debounce <= 2 * TST_MIN_DEB_US)
+    {
+      u32_nrOfErrors ++ ;
+    }
+  }
+
+  (void)PHD_Delete    (pt_instance) ;
+  (void)PHD_Terminate () ;
+
+  printf ("%lu errors\n", u32_nrOfErrors) ;
+
+  return ((u32_nrOfErrors == 0) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
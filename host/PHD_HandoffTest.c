@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : PHD_HandoffTest.c
+// Function: Host stress test of the pulse handoff of PHD_PulseHandler.c. One
+//           thread plays the interrupt and fires pulses through the ISR path,
+//           another plays the bucket memory and fetches them with
+//           PHD_GetPulses as fast as it can. The total fetched must equal the
+//           pulses fired: none lost, none counted twice. The pulse handler is
+//           built on its own, like on the target, so every fetch reads the
+//           counter again. Only atomic reads of the counter are assumed, as
+//           on the eZ80; a host with 32-bit ints gives that.
+//           Build and run from the root of the project:
+//             gcc -O2 -pthread -Wno-multichar -I host -I . -o handofftest host/PHD_HandoffTest.c PHD_PulseHandler.c
+//             ./handofftest
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include <pthread.h>
+#include "TMR_Timer.h"
+#include "PHD_PulseHandler.h"
+
+#define TST_NOF_PULSES        (20000000UL)
+#define TST_MAX_PPM           (6000)                      // Debounces 2 ms
+#define TST_PULSE_SPACING     (2500UL)                    // us between the pulses fired
+#define TST_US_MASK           (0xFFFFFFFFUL)              // The Long-parts are 32 bits on the target
+
+static TMR_micro_struct     t_isrClock ;                  // Only touched by the interrupt thread
+static unsigned long        u32_nrFired ;
+static unsigned long        u32_nrRefused ;
+static volatile BOOL        b_firing ;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel and timer stand-ins. No process runs; the fetching thread takes the //
+// place of the bucket memory process                                         //
+////////////////////////////////////////////////////////////////////////////////
+
+void * getmem (unsigned long const u32_nrOfBytes)
+{
+  return (malloc (u32_nrOfBytes)) ;
+}
+
+int freemem (void * const pv_memory, unsigned long const u32_nrOfBytes)
+{
+  free (pv_memory) ;
+  return (OK) ;
+}
+
+int xc_printf (char const * const as8_format, ...)
+{
+  return (0) ;
+}
+
+PID KE_TaskCreate (procptr const func_process, int const s24_stackSize, int const s24_priority,
+                   char const * const as8_name, int const s24_nrOfArgs, ...)
+{
+  return ((PID)1) ;
+}
+
+int KE_TaskResume (PID const t_processId)
+{
+  return (OK) ;
+}
+
+int KE_TaskDelete (PID const t_processId)
+{
+  return (OK) ;
+}
+
+void KE_TaskSleep100 (int const s24_ticks)
+{
+  return ;
+}
+
+void KE_CriticalBegin (void)
+{
+  return ;
+}
+
+void KE_CriticalEnd (void)
+{
+  return ;
+}
+
+int KE_MBoxSend (PID const t_processId, void * const pv_message)
+{
+  return (OK) ;
+}
+
+void TMR_SetTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const timeout)
+{
+  return ;
+}
+
+void TMR_PostponeTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const postpone)
+{
+  return ;
+}
+
+BOOL TMR_CheckTimeout (TMR_ticks_struct const * const pt_timeout)
+{
+  return (FALSE) ;
+}
+
+unsigned long TMR_TimeoutLeft (TMR_ticks_struct const * const pt_timeout)
+{
+  return (TMR_SECOND) ;
+}
+
+void TMR_PostponeMicroStamp (TMR_micro_struct * const pt_microstamp, unsigned long const postpone_us)
+{
+  unsigned long u32_old = pt_microstamp->u32_lsLong ;
+
+  pt_microstamp->u32_lsLong = (u32_old + postpone_us) & TST_US_MASK ;
+  if (pt_microstamp->u32_lsLong < u32_old)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+}
+
+void TMR_SetMicroStampIsr (TMR_micro_struct * const pt_microstamp)
+{
+  // The clock of the interrupt thread moves on one spacing per pulse
+  TMR_PostponeMicroStamp (&t_isrClock, TST_PULSE_SPACING) ;
+  *pt_microstamp = t_isrClock ;
+}
+
+unsigned long TMR_MicroStampDiff (TMR_micro_struct const * const pt_newStamp,
+                                  TMR_micro_struct const * const pt_oldStamp)
+{
+  unsigned long long u64_new = ((unsigned long long)pt_newStamp->u32_msLong << 32) | pt_newStamp->u32_lsLong ;
+  unsigned long long u64_old = ((unsigned long long)pt_oldStamp->u32_msLong << 32) | pt_oldStamp->u32_lsLong ;
+
+  if (u64_new <= u64_old)
+  {
+    return (0) ;
+  }
+  return ((u64_new - u64_old > TST_US_MASK) ? TST_US_MASK : (unsigned long)(u64_new - u64_old)) ;
+}
+
+unsigned long TMR_MicroStampAge (TMR_micro_struct const * const pt_microstamp)
+{
+  return (0) ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Test                                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+static void * TST_Interrupt (void * const pv_instance)
+{
+  unsigned long u32_pulse ;
+
+  for (u32_pulse = 0; u32_pulse < TST_NOF_PULSES; u32_pulse ++)
+  {
+    if (PHD_HandlePulse (pv_instance) == PHD_OK)
+    {
+      u32_nrFired ++ ;
+    }
+    else
+    {
+      u32_nrRefused ++ ;
+    }
+  }
+  b_firing = FALSE ;
+
+  return (NULL) ;
+}
+
+
+int main (void)
+{
+  PHD_handle            pt_instance ;
+  PHD_statistics_struct t_statistics ;
+  pthread_t             t_thread ;
+  unsigned int          u24_pulses ;
+  unsigned long         u32_nrFetched = 0 ;
+  unsigned long         u32_nrOfFetches = 0 ;
+  unsigned long         u32_nrEmpty = 0 ;
+
+  if ( (PHD_Initialize (1)                            != PHD_OK) ||
+       (PHD_Create     (&pt_instance, 0, TST_MAX_PPM) != PHD_OK)    )
+  {
+    printf ("Can't create a pulse handler.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+
+  b_firing = TRUE ;
+  if (pthread_create (&t_thread, NULL, TST_Interrupt, pt_instance) != 0)
+  {
+    printf ("Can't start the interrupt thread.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+
+  // Fetch while the pulses come in
+  while (b_firing != FALSE)
+  {
+    (void)PHD_GetPulses (pt_instance, &u24_pulses) ;
+    u32_nrFetched += u24_pulses ;
+    u32_nrOfFetches ++ ;
+    if (u24_pulses == 0)
+    {
+      u32_nrEmpty ++ ;
+    }
+  }
+  (void)pthread_join (t_thread, NULL) ;
+
+  // Pick up what came in after the last fetch
+  (void)PHD_GetPulses (pt_instance, &u24_pulses) ;
+  u32_nrFetched += u24_pulses ;
+  (void)PHD_GetStatistics (pt_instance, &t_statistics) ;
+
+  printf ("%lu pulses fired, %lu refused, %lu accepted, %lu fetched in %lu fetches (%lu empty)\n",
+          u32_nrFired, u32_nrRefused, t_statistics.u32_accepted,
+          u32_nrFetched, u32_nrOfFetches + 1, u32_nrEmpty) ;
+
+  (void)PHD_Delete (pt_instance) ;
+  (void)PHD_Terminate () ;
+
+  return ( ( (u32_nrFetched == u32_nrFired                ) &&
+             (u32_nrFetched == t_statistics.u32_accepted  ) &&
+             (u32_nrRefused == 0                          )    ) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
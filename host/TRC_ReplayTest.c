@@ -0,0 +1,457 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : TRC_ReplayTest.c
+// Function: Host replay engine of TRC_Trace.c. Loads a /trace.bin dump, see
+//           WEB_Site.h for its layout, through TRC_LoadRecords and replays one
+//           channel into a simulated pulse handler with TRC_Replay, at the
+//           recorded speed or as fast as possible, then prints its report.
+//           Without a dump it replays a synthetic trace and checks the report,
+//           a replay in two parts, and that a live instance is never fed.
+//           Build and run from the root of the project:
+//             gcc -O2 -Wno-multichar -I host -I . -o replaytest host/TRC_ReplayTest.c TRC_Trace.c PHD_PulseHandler.c
+//             ./replaytest
+//             ./replaytest trace.bin <channel> [<max pulses per minute> [realtime]]
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#include <kernel.h>
+#include <time.h>
+#include <unistd.h>
+#include "TMR_Timer.h"
+#include "RTC_RealTimeClock.h"
+#include "PHD_PulseHandler.h"
+#include "TRC_Trace.h"
+typedef void                    Webpage ;             // Only WEB_Initialize uses it
+#include "WEB_Site.h"
+
+#define TST_MAX_RECORDS       (0xFFFFU)                   // Count of a dump is a u16
+#define TST_DEFAULT_PPM       (100)
+#define TST_US_MASK           (0xFFFFFFFFUL)              // The Long-parts are 32 bits on the target
+#define TST_SYNTH_PULSES      (20000U)
+#define TST_SYNTH_CHANNEL     (1)                         // GAS_CHANNEL of main.c
+#define TST_SYNTH_PPM         (100)                       // Debounces 150 ms
+#define TST_SYNTH_BOUNCE_US   (4000UL)                    // A bounce after every 8th pulse
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel and timer stand-ins. No process runs; time stamps come from the     //
+// monotonic clock of the host                                                //
+////////////////////////////////////////////////////////////////////////////////
+
+void * getmem (unsigned long const u32_nrOfBytes)
+{
+  return (malloc (u32_nrOfBytes)) ;
+}
+
+int freemem (void * const pv_memory, unsigned long const u32_nrOfBytes)
+{
+  free (pv_memory) ;
+  return (OK) ;
+}
+
+int xc_printf (char const * const as8_format, ...)
+{
+  return (0) ;
+}
+
+PID KE_TaskCreate (procptr const func_process, int const s24_stackSize, int const s24_priority,
+                   char const * const as8_name, int const s24_nrOfArgs, ...)
+{
+  return ((PID)1) ;
+}
+
+int KE_TaskResume (PID const t_processId)
+{
+  return (OK) ;
+}
+
+int KE_TaskDelete (PID const t_processId)
+{
+  return (OK) ;
+}
+
+void KE_TaskSleep100 (int const s24_ticks)
+{
+  (void)usleep ((useconds_t)s24_ticks * 10000) ;
+}
+
+void KE_CriticalBegin (void)
+{
+  return ;
+}
+
+void KE_CriticalEnd (void)
+{
+  return ;
+}
+
+int KE_MBoxSend (PID const t_processId, void * const pv_message)
+{
+  return (OK) ;
+}
+
+void TMR_SetTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const timeout)
+{
+  return ;
+}
+
+void TMR_PostponeTimeout (TMR_ticks_struct * const pt_timeout, unsigned long const postpone)
+{
+  return ;
+}
+
+BOOL TMR_CheckTimeout (TMR_ticks_struct const * const pt_timeout)
+{
+  return (FALSE) ;
+}
+
+unsigned long TMR_TimeoutLeft (TMR_ticks_struct const * const pt_timeout)
+{
+  return (TMR_SECOND) ;
+}
+
+void TMR_SetMicroStampIsr (TMR_micro_struct * const pt_microstamp)
+{
+  struct timespec    t_now ;
+  unsigned long long u64_us ;
+
+  (void)clock_gettime (CLOCK_MONOTONIC, &t_now) ;
+  u64_us = (unsigned long long)t_now.tv_sec * 1000000ULL + (unsigned long long)(t_now.tv_nsec / 1000) ;
+  pt_microstamp->u32_lsLong = (unsigned long)(u64_us & TST_US_MASK) ;
+  pt_microstamp->u32_msLong = (unsigned long)(u64_us >> 32) ;
+}
+
+void TMR_SetMicroStamp (TMR_micro_struct * const pt_microstamp)
+{
+  TMR_SetMicroStampIsr (pt_microstamp) ;
+}
+
+void TMR_PostponeMicroStamp (TMR_micro_struct * const pt_microstamp, unsigned long const postpone_us)
+{
+  unsigned long u32_old = pt_microstamp->u32_lsLong ;
+
+  pt_microstamp->u32_lsLong = (u32_old + postpone_us) & TST_US_MASK ;
+  if (pt_microstamp->u32_lsLong < u32_old)
+  {
+    pt_microstamp->u32_msLong ++ ;
+  }
+}
+
+unsigned long TMR_MicroStampDiff (TMR_micro_struct const * const pt_newStamp,
+                                  TMR_micro_struct const * const pt_oldStamp)
+{
+  unsigned long long u64_new = ((unsigned long long)pt_newStamp->u32_msLong << 32) | pt_newStamp->u32_lsLong ;
+  unsigned long long u64_old = ((unsigned long long)pt_oldStamp->u32_msLong << 32) | pt_oldStamp->u32_lsLong ;
+
+  if (u64_new <= u64_old)
+  {
+    return (0) ;
+  }
+  return ((u64_new - u64_old > TST_US_MASK) ? TST_US_MASK : (unsigned long)(u64_new - u64_old)) ;
+}
+
+unsigned long TMR_MicroStampAge (TMR_micro_struct const * const pt_microstamp)
+{
+  TMR_micro_struct t_now ;
+
+  TMR_SetMicroStamp (&t_now) ;
+  return (TMR_MicroStampDiff (&t_now, pt_microstamp)) ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Replay                                                                     //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long TST_GetLittle (unsigned char const * const au8_data,
+                                    unsigned char         const u8_nrOfBytes)
+{
+  unsigned long u32_value = 0 ;
+  unsigned char u8_byte   = u8_nrOfBytes ;
+
+  while (u8_byte > 0)
+  {
+    u8_byte -- ;
+    u32_value = (u32_value << 8) | au8_data[u8_byte] ;
+  }
+
+  return (u32_value) ;
+}
+
+
+static void TST_PrintReport (TRC_report_struct const * const pt_report)
+{
+  printf ("%lu pulses, %lu accepted, %lu rejected, %lu ms, %lu pulses/s, "
+          "%u pulses/min at the end, %u pulses/min at most\n",
+          pt_report->u32_pulses, pt_report->u32_accepted, pt_report->u32_rejected,
+          pt_report->u32_elapsedMs, pt_report->u32_pulsesPerSecond,
+          pt_report->u24_pulsesPerMinute, pt_report->u24_pulsesPerMinuteMax) ;
+}
+
+
+static int TST_ReplayDump (char          const * const as8_fileName,
+                           unsigned char         const u8_channel,
+                           unsigned short        const u16_maxPulsesPerMinute,
+                           BOOL                  const b_realTime)
+{
+  FILE *            pt_file ;
+  unsigned char *   au8_dump ;
+  long              s32_nrOfBytes ;
+  unsigned short    u16_nrOfRecords ;
+  unsigned short    u16_index ;
+  TRC_record *      pt_records ;
+  TMR_micro_struct  t_baseTime ;
+  TRC_handle        pt_trace ;
+  PHD_handle        pt_phd ;
+  TRC_report_struct t_report ;
+  TRC_status        t_result ;
+
+  // Read the whole dump
+  pt_file = fopen (as8_fileName, "rb") ;
+  if (pt_file == NULL)
+  {
+    printf ("Can't open %s.\n", as8_fileName) ;
+    return (EXIT_FAILURE) ;
+  }
+  (void)fseek (pt_file, 0, SEEK_END) ;
+  s32_nrOfBytes = ftell (pt_file) ;
+  (void)fseek (pt_file, 0, SEEK_SET) ;
+  au8_dump = malloc ((s32_nrOfBytes > 0) ? (size_t)s32_nrOfBytes : 1) ;
+  if ( (s32_nrOfBytes < WEB_TRACE_HEADER_SIZE                                      ) ||
+       (fread (au8_dump, 1, (size_t)s32_nrOfBytes, pt_file) != (size_t)s32_nrOfBytes)    )
+  {
+    printf ("%s is too short.\n", as8_fileName) ;
+    return (EXIT_FAILURE) ;
+  }
+  (void)fclose (pt_file) ;
+
+  // Check the header, then unpack the records
+  u16_nrOfRecords = (unsigned short)TST_GetLittle (&au8_dump[WEB_TRACE_COUNT_OFS], 2) ;
+  if (au8_dump[WEB_TRACE_VERSION_OFS] != WEB_TRACE_VERSION)
+  {
+    printf ("%s has an unknown layout.\n", as8_fileName) ;
+    return (EXIT_FAILURE) ;
+  }
+  if ((unsigned long)s32_nrOfBytes < WEB_TRACE_HEADER_SIZE + 4UL * u16_nrOfRecords)
+  {
+    printf ("%s is shorter than its header says.\n", as8_fileName) ;
+    return (EXIT_FAILURE) ;
+  }
+  t_baseTime.u32_lsLong = TST_GetLittle (&au8_dump[WEB_TRACE_BASE_OFS],     4) ;
+  t_baseTime.u32_msLong = TST_GetLittle (&au8_dump[WEB_TRACE_BASE_OFS + 4], 4) ;
+  pt_records = malloc ((u16_nrOfRecords + 1) * sizeof(TRC_record)) ;
+  for (u16_index = 0; u16_index < u16_nrOfRecords; u16_index ++)
+  {
+    pt_records[u16_index] = TST_GetLittle (&au8_dump[WEB_TRACE_HEADER_SIZE + 4UL * u16_index], 4) ;
+  }
+
+  if ( (PHD_Initialize  (1)                                            != PHD_OK) ||
+       (PHD_Create      (&pt_phd, 0, u16_maxPulsesPerMinute)           != PHD_OK) ||
+       (TRC_Create      (&pt_trace, (u16_nrOfRecords > 0) ? u16_nrOfRecords : 1) != TRC_OK) ||
+       (TRC_LoadRecords (pt_trace, &t_baseTime, pt_records, u16_nrOfRecords) != TRC_OK)    )
+  {
+    printf ("Can't load %u records.\n", u16_nrOfRecords) ;
+    return (EXIT_FAILURE) ;
+  }
+
+  printf ("%s: %u records, channel %u, %u pulses per minute at most, %s\n",
+          as8_fileName, u16_nrOfRecords, u8_channel, u16_maxPulsesPerMinute,
+          (b_realTime != FALSE) ? "at the recorded speed" : "as fast as possible") ;
+  t_result = TRC_Replay (pt_trace, u8_channel, pt_phd, b_realTime, FALSE, &t_report) ;
+  TST_PrintReport (&t_report) ;
+
+  (void)TRC_Delete    (pt_trace) ;
+  (void)PHD_Delete    (pt_phd) ;
+  (void)PHD_Terminate () ;
+  free (pt_records) ;
+  free (au8_dump) ;
+
+  return ((t_result == TRC_OK) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Self test                                                                  //
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long        u32_random = 1 ;
+
+static unsigned long TST_Random (unsigned long const u32_range)
+{
+  // Same numbers on every host
+  u32_random = (u32_random * 1103515245UL + 12345UL) & 0x7FFFFFFFUL ;
+  return ((u32_random >> 8) % u32_range) ;
+}
+
+
+static unsigned short TST_Synthesize (TRC_record       * const pt_records,
+                                      unsigned short     const u16_maxRecords,
+                                      unsigned long    * const pu32_nrOfPulses,
+                                      unsigned long    * const pu32_nrOfBounces)
+{
+  unsigned short u16_nrOfRecords = 0 ;
+  unsigned long  u32_delta ;
+
+  *pu32_nrOfPulses  = 0 ;
+  *pu32_nrOfBounces = 0 ;
+  while ( (*pu32_nrOfPulses  <  TST_SYNTH_PULSES  ) &&
+          (u16_nrOfRecords   <  u16_maxRecords - 3)    )
+  {
+    // A pulse every 0.4 to 2 seconds, in between the other channels
+    u32_delta = 400000UL + TST_Random (1600000UL) ;
+    if (TST_Random (4) == 0)
+    {
+      pt_records[u16_nrOfRecords ++] = (0UL << TRC_CHANNEL_SHIFT) | (u32_delta / 2) ;
+      u32_delta    -= u32_delta / 2 ;
+    }
+    if (TST_Random (500) == 0)
+    {
+      // Now and then a power cut of up to an hour
+      pt_records[u16_nrOfRecords ++] = ((unsigned long)TRC_GAP_CHANNEL << TRC_CHANNEL_SHIFT) | TST_Random (3600000UL) ;
+    }
+    pt_records[u16_nrOfRecords ++] = ((unsigned long)TST_SYNTH_CHANNEL << TRC_CHANNEL_SHIFT) | u32_delta ;
+    (*pu32_nrOfPulses) ++ ;
+
+    if ((*pu32_nrOfPulses % 8) == 0)
+    {
+      pt_records[u16_nrOfRecords ++] = ((unsigned long)TST_SYNTH_CHANNEL << TRC_CHANNEL_SHIFT) | TST_SYNTH_BOUNCE_US ;
+      (*pu32_nrOfBounces) ++ ;
+    }
+  }
+
+  return (u16_nrOfRecords) ;
+}
+
+
+static unsigned long TST_Check (char const * const as8_what, BOOL const b_ok)
+{
+  printf ("%-58s %s\n", as8_what, (b_ok != FALSE) ? "ok" : "FAILED") ;
+  return ((b_ok != FALSE) ? 0 : 1) ;
+}
+
+
+static int TST_SelfTest (void)
+{
+  TRC_record *          pt_records = malloc (TST_MAX_RECORDS * sizeof(TRC_record)) ;
+  TMR_micro_struct      t_baseTime = { 123456789UL, 1UL } ;
+  TMR_micro_struct      t_splitTime ;
+  TRC_handle            pt_trace ;
+  PHD_handle            pt_phd ;
+  PHD_handle            pt_live ;
+  TRC_report_struct     t_report ;
+  TRC_report_struct     t_partReport ;
+  PHD_statistics_struct t_statistics ;
+  TRC_status            t_result ;
+  unsigned long         u32_nrOfPulses ;
+  unsigned long         u32_nrOfBounces ;
+  unsigned long         u32_nrOfErrors = 0 ;
+  unsigned short        u16_nrOfRecords ;
+  unsigned short        u16_split ;
+  unsigned short        u16_index ;
+  unsigned long         u32_delta ;
+
+  u16_nrOfRecords = TST_Synthesize (pt_records, TST_MAX_RECORDS, &u32_nrOfPulses, &u32_nrOfBounces) ;
+
+  if ( (PHD_Initialize (2)                                != PHD_OK) ||
+       (PHD_Create     (&pt_phd,  0, TST_SYNTH_PPM)      != PHD_OK) ||
+       (PHD_Create     (&pt_live, 1, TST_SYNTH_PPM)      != PHD_OK) ||
+       (TRC_Create     (&pt_trace, TST_MAX_RECORDS)      != TRC_OK)    )
+  {
+    printf ("Can't create the instances.\n") ;
+    return (EXIT_FAILURE) ;
+  }
+
+  // The whole trace in one go
+  (void)TRC_LoadRecords (pt_trace, &t_baseTime, pt_records, u16_nrOfRecords) ;
+  t_result = TRC_Replay (pt_trace, TST_SYNTH_CHANNEL, pt_phd, FALSE, FALSE, &t_report) ;
+  TST_PrintReport (&t_report) ;
+  u32_nrOfErrors += TST_Check ("Replay succeeds",
+                               t_result == TRC_OK) ;
+  u32_nrOfErrors += TST_Check ("All pulses of the channel are fed",
+                               t_report.u32_pulses == u32_nrOfPulses + u32_nrOfBounces) ;
+  u32_nrOfErrors += TST_Check ("Real pulses are accepted, bounces rejected",
+                               (t_report.u32_accepted == u32_nrOfPulses ) &&
+                               (t_report.u32_rejected == u32_nrOfBounces)    ) ;
+  u32_nrOfErrors += TST_Check ("Per-minute rate is within the maximum",
+                               (t_report.u24_pulsesPerMinuteMax >  0            ) &&
+                               (t_report.u24_pulsesPerMinuteMax <= TST_SYNTH_PPM)    ) ;
+
+  // The same trace in two parts, continued
+  (void)PHD_SetRealTime (pt_phd) ;
+  (void)PHD_Delete (pt_phd) ;
+  (void)PHD_Create (&pt_phd, 0, TST_SYNTH_PPM) ;
+  u16_split   = u16_nrOfRecords / 2 ;
+  t_splitTime = t_baseTime ;
+  for (u16_index = 0; u16_index < u16_split; u16_index ++)
+  {
+    u32_delta = pt_records[u16_index] & TRC_DELTA_MASK ;
+    if ((pt_records[u16_index] >> TRC_CHANNEL_SHIFT) == TRC_GAP_CHANNEL)
+    {
+      u32_delta *= TMR_US_PER_MS ;
+    }
+    TMR_PostponeMicroStamp (&t_splitTime, u32_delta) ;
+  }
+  (void)TRC_LoadRecords (pt_trace, &t_baseTime, pt_records, u16_split) ;
+  t_result = TRC_Replay (pt_trace, TST_SYNTH_CHANNEL, pt_phd, FALSE, FALSE, &t_partReport) ;
+  (void)TRC_LoadRecords (pt_trace, &t_splitTime, &pt_records[u16_split], u16_nrOfRecords - u16_split) ;
+  if (t_result == TRC_OK)
+  {
+    t_result = TRC_Replay (pt_trace, TST_SYNTH_CHANNEL, pt_phd, FALSE, TRUE, &t_partReport) ;
+  }
+  u32_nrOfErrors += TST_Check ("Replay in two parts gives the same counts",
+                               (t_result                            == TRC_OK                            ) &&
+                               (t_partReport.u32_pulses             == t_report.u32_pulses               ) &&
+                               (t_partReport.u32_accepted           == t_report.u32_accepted             ) &&
+                               (t_partReport.u32_rejected           == t_report.u32_rejected             ) &&
+                               (t_partReport.u24_pulsesPerMinuteMax == t_report.u24_pulsesPerMinuteMax)    ) ;
+
+  // A live instance must never be fed
+  t_result = TRC_Replay (pt_trace, TST_SYNTH_CHANNEL, pt_live, FALSE, TRUE, &t_partReport) ;
+  (void)PHD_GetStatistics (pt_live, &t_statistics) ;
+  u32_nrOfErrors += TST_Check ("Continued replay on a live instance is refused",
+                               (t_result                 == TRC_ERR_REPLAY) &&
+                               (t_statistics.u32_accepted == 0            ) &&
+                               (t_statistics.u32_rejected == 0            )    ) ;
+  u32_nrOfErrors += TST_Check ("Live instance refuses simulated pulses",
+                               PHD_HandlePulseAt (pt_live, &t_baseTime) == PHD_ERR_POINTER) ;
+  u32_nrOfErrors += TST_Check ("Simulated instance refuses interrupt pulses",
+                               PHD_HandlePulseIsr (pt_phd, &t_baseTime) == PHD_ERR_BUSY) ;
+  (void)PHD_SetRealTime (pt_phd) ;
+  t_result = TRC_Replay (pt_trace, TST_SYNTH_CHANNEL, pt_phd, FALSE, TRUE, &t_partReport) ;
+  u32_nrOfErrors += TST_Check ("Continued replay after PHD_SetRealTime is refused",
+                               t_result == TRC_ERR_REPLAY) ;
+
+  (void)TRC_Delete    (pt_trace) ;
+  (void)PHD_Delete    (pt_live) ;
+  (void)PHD_Delete    (pt_phd) ;
+  (void)PHD_Terminate () ;
+  free (pt_records) ;
+
+  return ((u32_nrOfErrors == 0) ? EXIT_SUCCESS : EXIT_FAILURE) ;
+}
+
+
+int main (int argc, char * argv[])
+{
+  int result ;
+
+  if (argc == 1)
+  {
+    result = TST_SelfTest () ;
+  }
+  else if ( (argc >= 3) &&
+            (argc <= 5)    )
+  {
+    result = TST_ReplayDump (argv[1],
+                             (unsigned char)atoi (argv[2]),
+                             (argc >= 4) ? (unsigned short)atoi (argv[3]) : TST_DEFAULT_PPM,
+                             ( (argc == 5) && (strcmp (argv[4], "realtime") == 0) ) ? TRUE : FALSE) ;
+  }
+  else
+  {
+    printf ("Usage: %s [<trace.bin> <channel> [<max pulses per minute> [realtime]]]\n", argv[0]) ;
+    result = EXIT_FAILURE ;
+  }
+
+  return (result) ;
+}
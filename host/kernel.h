@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// File    : kernel.h
+// Function: Stand-in for the XINU kernel include file, for building modules
+//           of the Meter Maid on a host computer. Only the types and calls
+//           the host programs in this directory need are declared; the
+//           programs implement the calls themselves.
+// Author  : Robert Delien
+//           Copyright (C) 2004
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef KERNEL_H                                      // Include file already compiled ?
+#define KERNEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define TRUE                    (1)
+#define FALSE                   (0)
+#define OK                      (1)
+#define SYSERR                  (-1)
+
+
+// Kernel types
+typedef int                     BOOL ;
+typedef void *                  PID ;
+typedef int                     PROCESS ;
+typedef int                     SYSCALL ;
+typedef unsigned char           BYTE ;
+typedef int                     (*procptr)() ;
+
+
+// Kernel calls
+void *  getmem                  (unsigned long         const u32_nrOfBytes) ;
+int     freemem                 (void                * const pv_memory,
+                                 unsigned long         const u32_nrOfBytes) ;
+int     xc_printf               (char          const * const as8_format, ...) ;
+int     xc_sprintf              (char                * const as8_buffer,
+                                 char          const * const as8_format, ...) ;
+PID     KE_TaskCreate           (procptr               const func_process,
+                                 int                   const s24_stackSize,
+                                 int                   const s24_priority,
+                                 char          const * const as8_name,
+                                 int                   const s24_nrOfArgs, ...) ;
+int     KE_TaskResume           (PID                   const t_processId) ;
+int     KE_TaskDelete           (PID                   const t_processId) ;
+void    KE_TaskSleep100         (int                   const s24_ticks) ;
+void    KE_CriticalBegin        (void) ;
+void    KE_CriticalEnd          (void) ;
+int     KE_MBoxSend             (PID                   const t_processId,
+                                 void                * const pv_message) ;
+void *  KE_MBoxReceive          (void) ;
+
+
+#endif //KERNEL_H
@@ -16,14 +16,29 @@
 #include "TMR_Timer.h"
 #include "LCD_Driver.h"
 #include "PHD_PulseHandler.h"
-#include "BMM_BucketMemory.h"
+#include "TRC_Trace.h"
 #include "RTC_RealTimeClock.h"
+#include "BMM_BucketMemory.h"
 #include "WEB_Site.h"
 #include "KEY_KeyHandler.h"
 
+#define NOF_YEARS         (10)
+#define NOF_MONTHS        (120)                       // Ten years of monthly history
+#define NOF_WEEKS         (104)
 #define NOF_DAYS          (365)
-#define NOF_HOURS         (24)
+#define NOF_HOURS         (168)                       // A week, for 6-hour views through the data pages
+#define NOF_HOUR_ROWS     (24)                        // Rows of the hour tables
+#define NOF_QUARTERS      (96)
 #define NOF_MINUTES       (60)
+#define NOF_ARCHIVE_BLOCKS (64)                      // Hourly history beyond NOF_HOURS, compressed, on the data pages
+#define MINUTE_TIER       (0)
+#define QUARTER_TIER      (1)
+#define HOUR_TIER         (2)
+#define DAY_TIER          (3)
+#define WEEK_TIER         (4)
+#define MONTH_TIER        (5)
+#define YEAR_TIER         (6)
+#define NOF_TIERS         (7)
 
 #define B0_MASK           0x01
 #define B1_MASK           0x02
@@ -36,10 +51,22 @@
 
 #define ELEC_MAX_PPM      (70)
 #define ELEC_MAX_PPU      (1667)
+#define ELEC_MIN_DEB_US   (2000UL)                    // LED pulses don't bounce; only filter glitches
+#define ELEC_MAX_DEB_US   (200000UL)                  // Just below the fixed 214 ms
 #define GAS_MAX_PPM       (100)
 #define GAS_MAX_PPU       (1000)
+#define GAS_MIN_DEB_US    (50000UL)                   // Above the chatter of the mirror of the last dial
+#define GAS_MAX_DEB_US    (1000000UL)                 // Slow dials chatter longer than the fixed 150 ms
 #define WATER_MAX_PPM     (10)
 #define WATER_MAX_PPU     (1000)
+#define WATER_MIN_DEB_US  (50000UL)                   // Above the chatter of the mirror of the last dial
+#define WATER_MAX_DEB_US  (5000000UL)                 // Slow dials chatter longer than the fixed 1.5 s
+
+#define ELEC_CHANNEL      (0)
+#define GAS_CHANNEL       (1)
+#define WATER_CHANNEL     (2)
+#define NOF_CHANNELS      (3)
+#define NOF_TRACE_RECORDS (1024)
 
 ////////////////////////////////////////////////////////////////////////////////
 // Global Data                                                                //
@@ -73,6 +100,8 @@ static BMM_handle   pt_BMMwaterHourInst = NULL ;
 static BMM_handle   pt_BMMwaterDayInst  = NULL ;
 // LCD handler instance for the display
 static LCD_handle   pt_LCDinstance      = NULL ;
+// Pulse trace of all meters
+static TRC_handle   pt_TRCinstance      = NULL ;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Local Prototypes                                                           //
@@ -99,7 +128,11 @@ static void     initMeter       (PHD_handle           * const ppt_PhdInstance,
                                  BMM_handle           * const ppt_BmmMinuteInstance,
                                  BMM_handle           * const ppt_BmmHourInstance,
                                  BMM_handle           * const ppt_BmmDayInstance,
-                                 unsigned short         const u16_maxPulsesPerMinute) ;
+                                 unsigned char          const u8_channelNr,
+                                 unsigned short         const u16_maxPulsesPerMinute,
+                                 unsigned long          const u32_minDebounce,
+                                 unsigned long          const u32_maxDebounce,
+                                 unsigned int           const u24_unitsPerKPulses) ;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -158,28 +191,6 @@ SYSCALL main (void)
                          "Electricity - Load Meter",
                          "Actual load",
                          "kW") ;
-  // Create the instances of the electricity tables
-  (void)WEB_CreateTable (&pt_TABelectMinInst,
-                         NOF_MINUTES,
-                         ELEC_MAX_PPU,
-                         0x0001,
-                         "Electricity - Minute Table",
-                         "Electricity consumption per minute",
-                         "kW/h") ;
-  (void)WEB_CreateTable (&pt_TABelectHourInst,
-                         NOF_HOURS,
-                         ELEC_MAX_PPU,
-                         0x0002,
-                         "Electricity - Hour Table",
-                         "Electricity consumption per hour",
-                         "kW/h") ;
-  (void)WEB_CreateTable (&pt_TABelectDayInst,
-                         NOF_DAYS,
-                         ELEC_MAX_PPU,
-                         0x0003,
-                         "Electricity - Day Table",
-                         "Electricity consumption per day",
-                         "kW/h") ;
 
   // Create the instance of the gas meter
   (void)WEB_CreateMeter (&pt_METgasLoadInst,
@@ -189,28 +200,6 @@ SYSCALL main (void)
                          "Gas - Flow Meter",
                          "Actual flow",
                          "m<sup>3</sup>/h") ;
-  // Create the instances of the gas tables
-  (void)WEB_CreateTable (&pt_TABgasMinInst,
-                         NOF_MINUTES,
-                         GAS_MAX_PPU,
-                         0x0011,
-                         "Gas - Minute Table",
-                         "Gas consumption per minute",
-                         "m<sup>3</sup>") ;
-  (void)WEB_CreateTable (&pt_TABgasHourInst,
-                         NOF_HOURS,
-                         GAS_MAX_PPU,
-                         0x0012,
-                         "Gas - Hour Table",
-                         "Gas consumption per hour",
-                         "m<sup>3</sup>") ;
-  (void)WEB_CreateTable (&pt_TABgasDayInst,
-                         NOF_DAYS,
-                         GAS_MAX_PPU,
-                         0x0013,
-                         "Gas - Day Table",
-                         "Gas consumption per day",
-                         "m<sup>3</sup>") ;
 
   // Create the instance of the gas meter
   (void)WEB_CreateMeter (&pt_METwaterLoadInst,
@@ -220,28 +209,6 @@ SYSCALL main (void)
                          "Water - Flow Meter",
                          "Actual flow",
                          "m<sup>3</sup>/h") ;
-  // Create the instances of the water tables
-  (void)WEB_CreateTable (&pt_TABwaterMinInst,
-                         NOF_MINUTES,
-                         WATER_MAX_PPU,
-                         0x0021,
-                         "Water - Minute Table",
-                         "Water consumption per minute",
-                         "m<sup>3</sup>") ;
-  (void)WEB_CreateTable (&pt_TABwaterHourInst,
-                         NOF_HOURS,
-                         WATER_MAX_PPU,
-                         0x0022,
-                         "Water - Hour Table",
-                         "Water consumption per hour",
-                         "m<sup>3</sup>") ;
-  (void)WEB_CreateTable (&pt_TABwaterDayInst,
-                         NOF_DAYS,
-                         WATER_MAX_PPU,
-                         0x0023,
-                         "Water - Day Table",
-                         "Water consumption per day",
-                         "m<sup>3</sup>") ;
 
   // Initialize the webserver using default headers and method handlers, our page on port 80
   http_init (http_defmethods, httpdefheaders, pt_webSite, 80) ;
@@ -258,6 +225,14 @@ SYSCALL main (void)
   // Initialize the real time clock
   (void)RTC_Initialize () ;
 
+  // Initialize the pulse handler for all meters
+  (void)PHD_Initialize (NOF_CHANNELS) ;
+
+  // Record the pulses of all meters, exported through /trace.bin
+  (void)TRC_Create       (&pt_TRCinstance, NOF_TRACE_RECORDS) ;
+  (void)TRC_SetRecording (pt_TRCinstance, TRUE) ;
+  (void)WEB_SetTrace     (pt_TRCinstance, NOF_TRACE_RECORDS) ;
+
   // Create an LC-Display instance
   (void)LCD_Create (&pt_LCDinstance,    // Storage for instance pointer
                     &PA_DR,             // Control lines on Port A
@@ -284,49 +259,103 @@ SYSCALL main (void)
   }
 
   // Set up the electricity meter
-  (void)initMeter (&pt_PHDelectInst, &pt_BMMelectMinInst, &pt_BMMelectHourInst, &pt_BMMelectDayInst, ELEC_MAX_PPM) ;
+  (void)initMeter (&pt_PHDelectInst, &pt_BMMelectMinInst, &pt_BMMelectHourInst, &pt_BMMelectDayInst, ELEC_CHANNEL, ELEC_MAX_PPM, ELEC_MIN_DEB_US, ELEC_MAX_DEB_US, ELEC_MAX_PPU) ;
   // Subscribe the electricity meter to the load change event
   (void)WEB_GetProcessId (pt_METelectLoadInst, &t_tempProcId) ;
   (void)PHD_AddClient    (pt_PHDelectInst,      t_tempProcId) ;
-  // Subscribe the electricity meter minute-web-table to the minute bucket event
-  (void)WEB_GetProcessId (pt_TABelectMinInst,  &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMelectMinInst,   t_tempProcId) ;
-  // Subscribe the electricity meter hour-web-table to the hour bucket event
-  (void)WEB_GetProcessId (pt_TABelectHourInst, &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMelectHourInst,  t_tempProcId) ;
-  // Subscribe the electricity meter day-web-table to the day bucket event
-  (void)WEB_GetProcessId (pt_TABelectDayInst,  &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMelectDayInst,   t_tempProcId) ;
+  // Create the electricity meter minute-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABelectMinInst,
+                             pt_BMMelectMinInst,
+                             NOF_MINUTES,
+                             ELEC_MAX_PPU,
+                             0x0001,
+                             "Electricity - Minute Table",
+                             "Electricity consumption per minute",
+                             "kW/h") ;
+  // Create the electricity meter hour-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABelectHourInst,
+                             pt_BMMelectHourInst,
+                             NOF_HOUR_ROWS,
+                             ELEC_MAX_PPU,
+                             0x0002,
+                             "Electricity - Hour Table",
+                             "Electricity consumption per hour",
+                             "kW/h") ;
+  // Create the electricity meter day-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABelectDayInst,
+                             pt_BMMelectDayInst,
+                             NOF_DAYS,
+                             ELEC_MAX_PPU,
+                             0x0003,
+                             "Electricity - Day Table",
+                             "Electricity consumption per day",
+                             "kW/h") ;
 
   // Set up the gas meter
-  (void)initMeter (&pt_PHDgasInst, &pt_BMMgasMinInst, &pt_BMMgasHourInst, &pt_BMMgasDayInst, GAS_MAX_PPM) ;
+  (void)initMeter (&pt_PHDgasInst, &pt_BMMgasMinInst, &pt_BMMgasHourInst, &pt_BMMgasDayInst, GAS_CHANNEL, GAS_MAX_PPM, GAS_MIN_DEB_US, GAS_MAX_DEB_US, GAS_MAX_PPU) ;
   // Subscribe the gas meter to the load change event
   (void)WEB_GetProcessId (pt_METgasLoadInst,   &t_tempProcId) ;
   (void)PHD_AddClient    (pt_PHDgasInst,        t_tempProcId) ;
-  // Subscribe the gas meter minute-web-table to the minute bucket event
-  (void)WEB_GetProcessId (pt_TABgasMinInst,    &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMgasMinInst,     t_tempProcId) ;
-  // Subscribe the gas meter hour-web-table to the hour bucket event
-  (void)WEB_GetProcessId (pt_TABgasHourInst,   &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMgasHourInst,    t_tempProcId) ;
-  // Subscribe the gas meter day-web-table to the day bucket event
-  (void)WEB_GetProcessId (pt_TABgasDayInst,    &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMgasDayInst,     t_tempProcId) ;
+  // Create the gas meter minute-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABgasMinInst,
+                             pt_BMMgasMinInst,
+                             NOF_MINUTES,
+                             GAS_MAX_PPU,
+                             0x0011,
+                             "Gas - Minute Table",
+                             "Gas consumption per minute",
+                             "m<sup>3</sup>") ;
+  // Create the gas meter hour-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABgasHourInst,
+                             pt_BMMgasHourInst,
+                             NOF_HOUR_ROWS,
+                             GAS_MAX_PPU,
+                             0x0012,
+                             "Gas - Hour Table",
+                             "Gas consumption per hour",
+                             "m<sup>3</sup>") ;
+  // Create the gas meter day-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABgasDayInst,
+                             pt_BMMgasDayInst,
+                             NOF_DAYS,
+                             GAS_MAX_PPU,
+                             0x0013,
+                             "Gas - Day Table",
+                             "Gas consumption per day",
+                             "m<sup>3</sup>") ;
 
   // Set up the water meter
-  (void)initMeter (&pt_PHDwaterInst, &pt_BMMwaterMinInst, &pt_BMMwaterHourInst, &pt_BMMwaterDayInst, WATER_MAX_PPM) ;
+  (void)initMeter (&pt_PHDwaterInst, &pt_BMMwaterMinInst, &pt_BMMwaterHourInst, &pt_BMMwaterDayInst, WATER_CHANNEL, WATER_MAX_PPM, WATER_MIN_DEB_US, WATER_MAX_DEB_US, WATER_MAX_PPU) ;
   // Subscribe the water meter to the load change event
   (void)WEB_GetProcessId (pt_METwaterLoadInst, &t_tempProcId) ;
   (void)PHD_AddClient    (pt_PHDwaterInst,      t_tempProcId) ;
-  // Subscribe the water meter minute-web-table to the minute bucket event
-  (void)WEB_GetProcessId (pt_TABwaterMinInst,  &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMwaterMinInst,   t_tempProcId) ;
-  // Subscribe the water meter hour-web-table to the hour bucket event
-  (void)WEB_GetProcessId (pt_TABwaterHourInst, &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMwaterHourInst,  t_tempProcId) ;
-  // Subscribe the water meter day-web-table to the day bucket event
-  (void)WEB_GetProcessId (pt_TABwaterDayInst,  &t_tempProcId) ;
-  (void)BMM_AddClient    (pt_BMMwaterDayInst,   t_tempProcId) ;
+  // Create the water meter minute-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABwaterMinInst,
+                             pt_BMMwaterMinInst,
+                             NOF_MINUTES,
+                             WATER_MAX_PPU,
+                             0x0021,
+                             "Water - Minute Table",
+                             "Water consumption per minute",
+                             "m<sup>3</sup>") ;
+  // Create the water meter hour-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABwaterHourInst,
+                             pt_BMMwaterHourInst,
+                             NOF_HOUR_ROWS,
+                             WATER_MAX_PPU,
+                             0x0022,
+                             "Water - Hour Table",
+                             "Water consumption per hour",
+                             "m<sup>3</sup>") ;
+  // Create the water meter day-web-table, rendered from its buckets on request
+  (void)WEB_CreateLazyTable (&pt_TABwaterDayInst,
+                             pt_BMMwaterDayInst,
+                             NOF_DAYS,
+                             WATER_MAX_PPU,
+                             0x0023,
+                             "Water - Day Table",
+                             "Water consumption per day",
+                             "m<sup>3</sup>") ;
 
   // Create a process for the clock on the display
   t_clockProcess = KE_TaskCreate ( (procptr)clockProcess,
@@ -872,11 +901,8 @@ static PROCESS viewLoadProcess (char         const * const ps8_displayTemplate,
     // Wait for a measurement-change event
     pv_phdInstance = KE_MBoxReceive () ;
 
-    // Retrieve the new measurement data
-    PHD_GetPulsesPerMinute (pv_phdInstance, &u24_nrOfPulses) ;
-
-    // Extrapolate minute to an hour
-    u24_nrOfPulses *= 60 ;
+    // Retrieve the new measurement data, as pulses per hour
+    PHD_GetPulsesPerHour (pv_phdInstance, &u24_nrOfPulses) ;
 
     // Create the display string
     (void)xc_sprintf (as_displayText,
@@ -915,7 +941,8 @@ static PROCESS viewLogProcess (char           const * const ps8_displayTemplate,
 {
   void*               pv_bmmInstance ;
   unsigned short      u16_nrOfBuckets ;
-  BMM_bucket          t_bucket ;
+  unsigned int        u24_value ;
+  BMM_range_struct    t_range ;
   RTC_DateTime_struct t_timeStamp ;
   char                as_displayText[41] ;
   unsigned char       u8_index ;
@@ -938,10 +965,10 @@ static PROCESS viewLogProcess (char           const * const ps8_displayTemplate,
         *u16_logEntry = u16_nrOfBuckets - 1 ;
       }
 
-      // Retrieve the requested bucket
-      (void)BMM_GetBucketCont (pv_bmmInstance, (u16_nrOfBuckets - 1) - *u16_logEntry, &t_bucket) ;
+      // Retrieve the requested bucket, along with its timestamp
+      (void)BMM_GetBucketRange (pv_bmmInstance, (u16_nrOfBuckets - 1) - *u16_logEntry, 1, &u24_value, &t_range) ;
 
-      RTC_Seconds2Date (t_bucket.u32_timeStamp, &t_timeStamp) ;
+      RTC_Seconds2Date (t_range.u32_timeStamp, &t_timeStamp) ;
 
       (void)xc_sprintf (as_displayText,
                         ps8_displayTemplate,
@@ -952,8 +979,8 @@ static PROCESS viewLogProcess (char           const * const ps8_displayTemplate,
                         t_timeStamp.u8_hour,
                         t_timeStamp.u8_minute,
                         t_timeStamp.u8_second,
-                        ((t_bucket.u24_value * u24_unitsPerKPulses + 500) / 1000) / 1000,
-                        ((t_bucket.u24_value * u24_unitsPerKPulses + 500) / 1000) % 1000) ;
+                        ((u24_value * u24_unitsPerKPulses + 500) / 1000) / 1000,
+                        ((u24_value * u24_unitsPerKPulses + 500) / 1000) % 1000) ;
 
     }
     else
@@ -1021,7 +1048,11 @@ static void initMeter (PHD_handle     * const ppt_PhdInstance,
                        BMM_handle     * const ppt_BmmMinuteInstance,
                        BMM_handle     * const ppt_BmmHourInstance,
                        BMM_handle     * const ppt_BmmDayInstance,
-                       unsigned short   const u16_maxPulsesPerMinute)
+                       unsigned char    const u8_channelNr,
+                       unsigned short   const u16_maxPulsesPerMinute,
+                       unsigned long    const u32_minDebounce,
+                       unsigned long    const u32_maxDebounce,
+                       unsigned int     const u24_unitsPerKPulses)
 ////////////////////////////////////////////////////////////////////////////////
 // Function:       initMeter                                                  //
 //                 - Initialization sequence of one meter (to prevent tripple //
@@ -1030,70 +1061,64 @@ static void initMeter (PHD_handle     * const ppt_PhdInstance,
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
-  PID t_tempProcId = NULL ;
-
-  // Create the bucket memory for days
-  (void)BMM_Create          (ppt_BmmDayInstance, NOF_DAYS) ;
-
-  // Make the fill process fetch new pulses using 'BMM_GetPulses'
-  (void)BMM_SetMeteringFunc (*ppt_BmmDayInstance, &BMM_GetPulses) ;
-
-  // Retrieve the Pid of the fill process which will fill day-buckets
-  (void)BMM_GetMeteringProc (*ppt_BmmDayInstance, &t_tempProcId) ;
-
-
-  // Create the bucket memory for hours
-  (void)BMM_Create          (ppt_BmmHourInstance, NOF_HOURS) ;
-
-  // Notify the Pid of the fill process of day-buckets if new pulses are fetched
-  (void)BMM_SetSlaveProc    (*ppt_BmmHourInstance, t_tempProcId) ;
-
-  // Make the fill process fetch new pulses using 'BMM_GetPulses'
-  (void)BMM_SetMeteringFunc (*ppt_BmmHourInstance, &BMM_GetPulses) ;
-
-  // Retrieve the Pid of the fill process which will fill hour-buckets
-  (void)BMM_GetMeteringProc (*ppt_BmmHourInstance, &t_tempProcId) ;
-
-
-  // Create the bucket memory for minutes
-  (void)BMM_Create          (ppt_BmmMinuteInstance, NOF_MINUTES) ;
-
-  // Notify the Pid of the fill process of hour-buckets if new pulses are fetched
-  (void)BMM_SetSlaveProc    (*ppt_BmmMinuteInstance, t_tempProcId) ;
+  // Only minutes follow the RTC, the other tiers cascade from their parent
+  static BMM_tier_desc const at_tierDesc[NOF_TIERS] =
+  {
+    {e_minuteEvent,  NOF_MINUTES,  BMM_NO_PARENT},  // MINUTE_TIER
+    {e_quarterEvent, NOF_QUARTERS, MINUTE_TIER  },  // QUARTER_TIER
+    {e_hourEvent,    NOF_HOURS,    QUARTER_TIER },  // HOUR_TIER
+    {e_dayEvent,     NOF_DAYS,     HOUR_TIER    },  // DAY_TIER
+    {e_weekEvent,    NOF_WEEKS,    DAY_TIER     },  // WEEK_TIER
+    {e_monthEvent,   NOF_MONTHS,   DAY_TIER     },  // MONTH_TIER
+    {e_yearEvent,    NOF_YEARS,    MONTH_TIER   }   // YEAR_TIER
+  } ;
+
+  BMM_handle    pt_BmmInstance = NULL ;
+  PID           t_tempProcId   = NULL ;
+  unsigned long u32_bytes      = 0 ;
+
+  // Create one bucket memory holding all tiers
+  (void)BMM_Create          (&pt_BmmInstance, NOF_TIERS, at_tierDesc) ;
+
+  // Retrieve the tiers, for reading their buckets
+  (void)BMM_GetTier         (pt_BmmInstance, MINUTE_TIER, ppt_BmmMinuteInstance) ;
+  (void)BMM_GetTier         (pt_BmmInstance, HOUR_TIER,   ppt_BmmHourInstance) ;
+  (void)BMM_GetTier         (pt_BmmInstance, DAY_TIER,    ppt_BmmDayInstance) ;
 
   // Make the fill process fetch new pulses using 'PHD_GetPulses'
-  (void)BMM_SetMeteringFunc (*ppt_BmmMinuteInstance, &PHD_GetPulses) ;
-
-  // Retrieve the Pid of the fill process which will fill minute-buckets
-  (void)BMM_GetMeteringProc (*ppt_BmmMinuteInstance, &t_tempProcId) ;
+  (void)BMM_SetMeteringFunc (pt_BmmInstance, &PHD_GetPulses) ;
 
+  // Keep the peak and base load of each hour and day, as pulses per hour
+  (void)BMM_SetRateFunc     (pt_BmmInstance, &PHD_GetPulsesPerHour) ;
+  (void)BMM_SetStatistics   (pt_BmmInstance, HOUR_TIER) ;
+  (void)BMM_SetStatistics   (pt_BmmInstance, DAY_TIER) ;
 
-  // Create a pulse handler
-  (void)PHD_Create          (ppt_PhdInstance, u16_maxPulsesPerMinute) ;
-
-  // Notify the Pid of the fill process of minute-buckets if new pulses are fetched
-  (void)PHD_SetStorageClient(*ppt_PhdInstance, t_tempProcId) ;
+  // Keep the closed hours compressed, for long-term history
+  (void)BMM_SetArchive      (pt_BmmInstance, HOUR_TIER, NOF_ARCHIVE_BLOCKS) ;
 
+  // Let the minutes follow the RTC, now that the options are in place
+  (void)BMM_Start           (pt_BmmInstance) ;
 
-  // Retrieve the buckets bucket-change process ID
-  (void)BMM_GetBucketProc   (*ppt_BmmMinuteInstance, &t_tempProcId) ;
+  // Let the data pages read all tiers, the meter number being the channel
+  (void)WEB_SetDataSource   (u8_channelNr, pt_BmmInstance, u24_unitsPerKPulses) ;
 
-  // Add the bucket-change process as an RTC event client
-  (void)RTC_AddClient       (e_minuteEvent, t_tempProcId, NULL) ;
+  // Retrieve the Pid of the fill process which will fill all tiers
+  (void)BMM_GetMeteringProc (pt_BmmInstance, &t_tempProcId) ;
 
 
-  // Retrieve the buckets bucket-change process ID
-  (void)BMM_GetBucketProc   (*ppt_BmmHourInstance, &t_tempProcId) ;
+  // Claim a channel of the pulse handler
+  (void)PHD_Create          (ppt_PhdInstance, u8_channelNr, u16_maxPulsesPerMinute) ;
 
-  // Add the bucket-change process as an RTC event client
-  (void)RTC_AddClient       (e_hourEvent, t_tempProcId, NULL) ;
+  // Notify the Pid of the fill process if new pulses are fetched
+  (void)PHD_SetStorageClient(*ppt_PhdInstance, t_tempProcId) ;
 
+  // Let the debounce time follow the meter's pulse intervals, within its bounds
+  (void)PHD_SetAdaptiveDebounce (*ppt_PhdInstance, u32_minDebounce, u32_maxDebounce) ;
 
-  // Retrieve the buckets bucket-change process ID
-  (void)BMM_GetBucketProc   (*ppt_BmmDayInstance, &t_tempProcId) ;
 
-  // Add the bucket-change process as an RTC event client
-  (void)RTC_AddClient       (e_dayEvent, t_tempProcId, NULL) ;
+  // Report the memory in use, to size the retention to the RAM available
+  (void)BMM_GetMemoryUse    (pt_BmmInstance, &u32_bytes) ;
+  (void)xc_printf ("Meter %u: %u bytes of bucket memory.\n", u8_channelNr, (unsigned int)u32_bytes) ;
 
   return ;
 }
@@ -1110,9 +1135,13 @@ static void ISR_ElectPulse (void)
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
+  TMR_micro_struct t_pulseTime ;
+
   PB_DR   |= B0_MASK ;
 
-  (void)PHD_HandlePulse (pt_PHDelectInst) ;
+  TMR_SetMicroStampIsr (&t_pulseTime) ;
+  (void)TRC_Record        (pt_TRCinstance, ELEC_CHANNEL, &t_pulseTime) ;
+  (void)PHD_HandlePulseIsr(pt_PHDelectInst, &t_pulseTime) ;
 
   PB_DR   &= ~B0_MASK ;
 
@@ -1131,9 +1160,13 @@ static void ISR_GasPulse (void)
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
+  TMR_micro_struct t_pulseTime ;
+
   PB_DR   |= B1_MASK ;
 
-  (void)PHD_HandlePulse (pt_PHDgasInst) ;
+  TMR_SetMicroStampIsr (&t_pulseTime) ;
+  (void)TRC_Record        (pt_TRCinstance, GAS_CHANNEL, &t_pulseTime) ;
+  (void)PHD_HandlePulseIsr(pt_PHDgasInst, &t_pulseTime) ;
 
   PB_DR   &= ~B1_MASK ;
 
@@ -1152,9 +1185,13 @@ static void ISR_WaterPulse (void)
 //                 - Initial revision.                                        //
 ////////////////////////////////////////////////////////////////////////////////
 {
+  TMR_micro_struct t_pulseTime ;
+
   PB_DR   |= B2_MASK ;
 
-  (void)PHD_HandlePulse (pt_PHDwaterInst) ;
+  TMR_SetMicroStampIsr (&t_pulseTime) ;
+  (void)TRC_Record        (pt_TRCinstance, WATER_CHANNEL, &t_pulseTime) ;
+  (void)PHD_HandlePulseIsr(pt_PHDwaterInst, &t_pulseTime) ;
 
   PB_DR   &= ~B2_MASK ;
 